@@ -43,9 +43,11 @@ uint8_t* root_path = "/tmp";		// full path to some directory
 // for file I/O functions
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <dirent.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
 
 #define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
@@ -53,6 +55,10 @@ uint8_t* root_path = "/tmp";		// full path to some directory
 
 #include <GLFW/glfw3.h>
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 typedef struct dirent dirent;
 
 uint8_t show_program_info, show_about, enable_vsync;
@@ -62,6 +68,8 @@ uint8_t show_program_info, show_about, enable_vsync;
 #define SHOW_NEW_THREAD 0 /* print init PC and thread ID for any newly created threads */
 #define SHOW_SEGFAULT 0	/* print message at segfault */
 #define SHOW_SHADERS 0	/* print GLSL shaders */
+#define ASYNC_PIPELINES 1 /* translate the shaders of new rasterization pipelines on a worker thread, and let the driver link them in parallel if supported */
+#define SHOW_GL_STATE_STATS 0 /* print the number of GL state changes issued and skipped (redundant) every FPS counter update; requires SHOW_FPS */
 
 #define BUILD_VER 1	/* current build version */
 #define SLEEP_AT_SWAP 0	 /* force CPU sleep at buffer swap; only for testing */
@@ -73,6 +81,8 @@ const char* WINDOW_TITLE = "Piculet VM";
 
 uint32_t window_width = 500;
 uint32_t window_height = 340;
+uint32_t framebuffer_width = 500;	// size of the window's framebuffer in pixels; differs from the window size on HiDPI displays
+uint32_t framebuffer_height = 340;
 int32_t cursor_x = 0;
 int32_t cursor_y = 0;
 uint8_t mouse_buttons = 0;
@@ -87,6 +97,15 @@ uint8_t kbd_states[9];
 uint32_t max_texture_size = 1024;	// max texture dimensions
 uint8_t gl_finish;	// whether or not to call glFinish() after all threads have cycled; set back to 0 after all threads have finished a cycle
 uint8_t gl_swap;	// whether or not to swap the buffers after all threads have cycled; set back to 0 after all threads have finished a cycle
+uint8_t gl_sampler_objects;	// whether or not GL sampler objects are supported (GL 3.3 or ARB_sampler_objects); if not, sampler state is set on the textures themselves
+uint8_t gl_parallel_shader_compile;	// whether or not the driver compiles + links on its own threads (KHR/ARB_parallel_shader_compile)
+uint8_t gl_program_binaries;	// whether or not GL program binaries can be retrieved + loaded (GL 4.1 or ARB_get_program_binary with at least one binary format)
+uint8_t gl_sync_objects;	// whether or not GL sync objects are supported (GL 3.2 or ARB_sync); if not, texture upload buffers are always orphaned
+uint8_t gl_texture_storage;	// whether or not immutable texture storage is supported (GL 4.2 or ARB_texture_storage); if not, each texture level is defined on its own
+uint32_t gl_compressed_formats;	// bit n is set if GL supports compressed TBO format 14+n (see IS_COMPRESSED_TBO_FORMAT); the others are decoded on the CPU
+uint8_t gl_compute;	// whether or not compute shaders + shader storage blocks are supported (GL 4.3, or ARB_compute_shader and ARB_shader_storage_buffer_object); if not, dispatches do nothing
+uint64_t gl_driver_key;	// hash of the GL vendor, renderer, and version strings; program binaries are only valid for the driver that produced them
+uint8_t* program_cache_path = 0;	// directory to store linked program binaries in across sessions (-c option); 0 if disabled
 
 struct timespec start_tm;
 #define NS_PER_SEC 1000000000
@@ -94,7 +113,13 @@ struct timespec start_tm;
 uint8_t memory[SIZE_MAIN_MEM+SIZE_SYS_MEM];
 uint64_t mappings_low = HW_INFORMATION;	// the lowest address for current buffer mappings; starts at beginning of HW information and is subtracted as buffers are mapped
 
-typedef struct map_t { uint64_t address, size, privacy_key; } map_t;
+#define MAX_DIRTY_RANGES 8
+typedef struct map_t {
+	uint64_t address, size, privacy_key;
+	uint8_t* data;	// buffer data of the mapped object
+	uint64_t dirty[MAX_DIRTY_RANGES+1][2];	// sorted, disjoint [start, end) address ranges written to while mapped (one extra for merging)
+	uint32_t n_dirty;
+} map_t;
 map_t* mappings;			// mapping regions
 uint64_t n_mappings;		// number of mapping regions
 
@@ -109,7 +134,10 @@ uint64_t n_objects = 0;
 #define MAX_NUMBER_BOUND_SETS 4 /* maximum number of descriptor sets */
 uint32_t max_number_ubos = 100;		// maximum number of uniform buffers accessible by a pipeline
 uint32_t max_number_sbos = 100;		// maximum number of storage buffers accessible by a pipeline
+#define SBO_MAX_SIZE (128*1000000) /* 128 MB */
 uint32_t max_number_samplers = 8;	// maximum number of samplers accessible by a pipeline
+uint32_t max_local_work_size[4] = { 1024, 1024, 64, 1024 };	// max local work-group size X, Y, Z, and max product of the three
+uint32_t max_global_work_size[3] = { 65535, 65535, 65535 };	// max global work-group size X, Y, Z
 uint32_t max_number_images = 8;		// maximum number of images accessible by a pipeline
 uint32_t max_number_as = 0;			// maximum number of acceleration structures accessible by a pipeline (0; RT is unsupported currently)
 
@@ -187,6 +215,7 @@ typedef struct object_t object_t;
 #define SR_BIT_C 0x100000000000
 #define SR_BIT_V 0x80000000000
 #define SR_BIT_SEGFAULT 0x800000000000
+#define SR_BIT_CAPTURE 0x1000000000000	/* one of the extra bits; set while a display capture (instruction 118) hasn't reached main memory yet */
 
 typedef struct object_bindings_t {
 	uint64_t uniform_desc_binding;
@@ -218,6 +247,16 @@ typedef struct object_bindings_t {
 	uint64_t segtable_binding;
 } object_bindings_t;
 
+// file streams are accessed with pread/pwrite at the offsets given by instructions 64 and 65, so the FILE's position is never used; the file's size
+// is kept to range-check them, and is only read again once the VM may have shrunk a file (see file_size_epoch) or an access goes past it
+typedef struct file_stream_t {
+	FILE* file;
+	uint64_t size;		// size of the file when last read
+	uint64_t size_epoch;	// value of file_size_epoch when size was read
+} file_stream_t;
+
+uint64_t file_size_epoch = 1;	// incremented whenever a file may have been shrunk or rewritten by the VM, invalidating the sizes kept by all file streams
+
 typedef struct thread_t {
 	uint64_t id;
 	uint64_t* primary;
@@ -245,18 +284,27 @@ typedef struct thread_t {
 	uint64_t sleep_start_ns;	// time that the thread was put to sleep
 	uint64_t sleep_duration_ns;	// time that the thread was put to sleep for
 
+	uint64_t vid_data_wait;		// ID of the video data object being decoded that this thread waits for to copy a frame of it to memory (0 if none)
+	uint32_t vid_data_wait_frame;	// frame to copy once the decode finishes
+	uint64_t vid_data_wait_addr;	// address to copy the frame to
+	uint64_t video_stream_wait;	// ID of the video stream this thread waits for room in to append a frame to it (0 if none)
+	uint64_t video_stream_wait_addr;	// address of the frame to append
+	uint32_t n_pending_captures;	// display captures made by this thread not yet copied to main memory; SR_BIT_CAPTURE is set while nonzero
+
 	uint64_t segtable_id;
 
-	FILE* file_streams[65534];	// open file streams (ID 1-65535)
+	file_stream_t* file_streams[65534];	// open file streams (ID 1-65534)
 } thread_t;
 
 // create new mapping region in system memory with specified size and object privacy key, then return address
-uint64_t new_mapping(uint64_t privacy_key, uint64_t size) {
+uint64_t new_mapping(uint64_t privacy_key, uint64_t size, uint8_t* data) {
 	mappings_low -= size;
 	mappings = realloc(mappings, sizeof(map_t)*(n_mappings+1));
 	mappings[n_mappings].address = mappings_low;
 	mappings[n_mappings].size = size;
 	mappings[n_mappings].privacy_key = privacy_key;
+	mappings[n_mappings].data = data;
+	mappings[n_mappings].n_dirty = 0;
 	n_mappings++;
 	return mappings_low;
 }
@@ -318,7 +366,7 @@ uint8_t check_mapped_region(uint64_t privacy_key, uint64_t address, uint64_t siz
 
 void update_hwinfo() {
 	uint8_t* hwi = &memory[HW_INFORMATION];
-	*(uint32_t*)hwi = 0x180;	// hw support info; texture filtering + hw accel gfx
+	*(uint32_t*)hwi = 0x180 | gl_compute;	// hw support info; texture filtering + hw accel gfx (+ GPU computing)
 	hwi[4] = 0;		// 1 display
 	*(uint64_t*)(hwi+5) = HW_INFORMATION+500; // address to dimensions of each display
 	*(uint64_t*)(hwi+13) = 0; // address to 16-bit touch count for each display
@@ -352,13 +400,13 @@ void update_hwinfo() {
 	*(uint32_t*)(hwi+143) = 16; // num of audio occlusion geometry binding points per audio listener
 	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
 	*(uint32_t*)(hwi+147) = max_texture_size; // max texture size
-	*(uint32_t*)(hwi+151) = 1024; // max local work-group size X
-	*(uint32_t*)(hwi+155) = 1024; // max local work-group size Y
-	*(uint32_t*)(hwi+159) = 64; // max local work-group size Z
-	*(uint32_t*)(hwi+163) = 1024; // max local work-group size
-	*(uint32_t*)(hwi+167) = 65535; // max global work-group size X
-	*(uint32_t*)(hwi+171) = 65535; // max global work-group size Y
-	*(uint32_t*)(hwi+175) = 65535; // max global work-group size Z
+	*(uint32_t*)(hwi+151) = max_local_work_size[0]; // max local work-group size X
+	*(uint32_t*)(hwi+155) = max_local_work_size[1]; // max local work-group size Y
+	*(uint32_t*)(hwi+159) = max_local_work_size[2]; // max local work-group size Z
+	*(uint32_t*)(hwi+163) = max_local_work_size[3]; // max local work-group size
+	*(uint32_t*)(hwi+167) = max_global_work_size[0]; // max global work-group size X
+	*(uint32_t*)(hwi+171) = max_global_work_size[1]; // max global work-group size Y
+	*(uint32_t*)(hwi+175) = max_global_work_size[2]; // max global work-group size Z
 	*(uint32_t*)(hwi+179) = 0; // max RT recursion
 	*(uint32_t*)(hwi+183) = 0; // max geometries in BLAS
 	*(uint32_t*)(hwi+187) = 0; // max count of geom instances in TLAS
@@ -367,14 +415,22 @@ void update_hwinfo() {
 	*(uint64_t*)(hwi+196) = max_number_as; // max AS descriptors in a pipeline
 	*(uint64_t*)(hwi+204) = max_number_samplers;
 	*(uint64_t*)(hwi+212) = max_number_images;
+	GLint max_ubo_bindings, max_vertex_ubos, max_pixel_ubos; // each pipeline stage gets its own GL uniform buffer binding points
+	glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &max_ubo_bindings);
+	glGetIntegerv(GL_MAX_VERTEX_UNIFORM_BLOCKS, &max_vertex_ubos);
+	glGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_BLOCKS, &max_pixel_ubos);
+	max_number_ubos = max_ubo_bindings/2;
+	if(max_vertex_ubos < max_number_ubos) max_number_ubos = max_vertex_ubos;
+	if(max_pixel_ubos < max_number_ubos) max_number_ubos = max_pixel_ubos;
 	*(uint64_t*)(hwi+220) = max_number_ubos;
 	*(uint64_t*)(hwi+228) = max_number_sbos;
 	*(uint64_t*)(hwi+236) = 0; // address to supported audio formats
 	*(uint64_t*)(hwi+244) = HW_INFORMATION+900; // address to supported video/image formats
 	*(uint16_t*)(hwi+252) = 0; // max num of audio channels
+	*(uint32_t*)(hwi+254) = gl_compressed_formats; // compressed TBO formats stored compressed on the GPU (bit n for format 14+n); the others are decoded when uploaded
 
-	*(uint32_t*)(hwi+500) = window_width;
-	*(uint32_t*)(hwi+504) = window_height;
+	*(uint32_t*)(hwi+500) = framebuffer_width;	// display dimensions in pixels; the size of a display capture (instruction 118)
+	*(uint32_t*)(hwi+504) = framebuffer_height;
 	*(int32_t*)(hwi+600) = cursor_x;
 	*(int32_t*)(hwi+604) = cursor_y;
 	hwi[700] = mouse_buttons;
@@ -382,7 +438,50 @@ void update_hwinfo() {
 	*(int32_t*)(hwi+705) = scroll_y;
 	memmove(&hwi[800], &kbd_states, 9);
 
-	strcpy(&hwi[900], "png,jpg,jpeg");
+	strcpy(&hwi[900], "png,jpg,jpeg,gif,pvf");
+}
+
+// adds a range of addresses to the dirty ranges of a mapping, merging it with the ranges it overlaps or touches
+// past MAX_DIRTY_RANGES, the two closest ranges are merged; the gap between them is filled with the object's data first, since a write-only map
+// leaves it undefined and only the dirty ranges are written back at unmap
+void add_dirty_range(map_t* map, uint64_t start, uint64_t end) {
+	uint32_t i = 0;
+	while(i < map->n_dirty && map->dirty[i][1] < start) i++;	// first range that doesn't end before start
+	uint32_t j = i;
+	for(; j < map->n_dirty && map->dirty[j][0] <= end; j++) {	// ranges i..j-1 overlap or touch the new one
+		if(map->dirty[j][0] < start) start = map->dirty[j][0];
+		if(map->dirty[j][1] > end) end = map->dirty[j][1];
+	}
+	memmove(&map->dirty[i+1], &map->dirty[j], (map->n_dirty-j)*sizeof(map->dirty[0]));
+	map->dirty[i][0] = start;
+	map->dirty[i][1] = end;
+	map->n_dirty += 1 - (j-i);
+	if(map->n_dirty <= MAX_DIRTY_RANGES) return;
+	uint32_t closest = 0;
+	for(uint32_t k = 1; k < map->n_dirty-1; k++)
+		if(map->dirty[k+1][0] - map->dirty[k][1] < map->dirty[closest+1][0] - map->dirty[closest][1]) closest = k;
+	uint64_t gap_start = map->dirty[closest][1];
+	memcpy(&memory[gap_start], map->data + (gap_start - map->address), map->dirty[closest+1][0] - gap_start);
+	map->dirty[closest][1] = map->dirty[closest+1][1];
+	memmove(&map->dirty[closest+1], &map->dirty[closest+2], (map->n_dirty-closest-2)*sizeof(map->dirty[0]));
+	map->n_dirty--;
+}
+
+// same as check_mapped_region, but for writes; the range is added to the dirty ranges of the mapping (only those are written back at unmap)
+uint8_t check_mapped_write(uint64_t privacy_key, uint64_t address, uint64_t size) {
+	for(uint32_t i = 0; i < n_mappings; i++)
+		if(privacy_key == mappings[i].privacy_key && address >= mappings[i].address && address + size - 1 < mappings[i].address + mappings[i].size) {
+			add_dirty_range(&mappings[i], address, address + size);
+			return 1;
+		}
+	return 0;	// not part of mapped region
+}
+
+// returns the mapping region that starts at the specified address, or 0 if there isn't one
+map_t* get_mapping(uint64_t address) {
+	for(uint32_t i = 0; i < n_mappings; i++)
+		if(address == mappings[i].address) return &mappings[i];
+	return 0;
 }
 
 uint8_t check_sys_region(uint64_t privacy_key, uint64_t address, uint64_t size) {
@@ -426,6 +525,10 @@ uint64_t new_thread(uint64_t parent_id) {
 	thread->n_descendants = 0;
 	thread->detached = 0;
 	thread->joining = 0;
+	thread->vid_data_wait = 0;
+	thread->video_stream_wait = 0;
+	thread->n_pending_captures = 0;
+	memset(thread->file_streams, 0, sizeof(thread->file_streams));
 	thread->killed = 1;	// this is set to 0 at the next cycle of parent (the thread is created as killed in order to treat the thread as non-existent until then)
 	thread->sleep_start_ns = 0;
 	thread->sleep_duration_ns = 0;
@@ -493,6 +596,15 @@ uint8_t check_overflow64(int64_t a, int64_t b) {
 typedef struct sbo_t {
 	void* data;
 	uint64_t size;
+	GLuint gl_buffer;	// GL shader storage buffer holding data repacked to std430 (0 if not created)
+	uint64_t gl_size;	// std430 size of the GL buffer's data
+	uint64_t layout_key;	// the block layout key (see sbo_layout_key) the GL buffer was last packed for
+	struct definition_t* layout_defs;	// definitions + set/binding of the storage block the GL buffer was last packed for; used to unpack it
+	uint32_t n_layout_defs;
+	uint8_t layout_set;
+	uint32_t layout_binding;
+	uint8_t dirty;		// set when data changes; cleared once the GL buffer is repacked
+	uint8_t gpu_written;	// set when the GL buffer is bound for a compute dispatch; data is stale until read back (see read_back_sbo)
 } sbo_t;
 
 typedef struct desc_binding_t {
@@ -536,9 +648,28 @@ typedef struct cbo_t {          // command buffer structure
 } cbo_t;
 
 typedef struct definition_t definition_t;
+typedef struct pipeline_job_t pipeline_job_t;
+
+// GL state set by a rasterization pipeline, with enums already mapped; built once when the pipeline is created
+// laid out without padding so that blocks can be compared with memcmp
+typedef struct gl_raster_state_t {
+	uint64_t stencil_funcs[2];	// func, ref, and func mask for front and back faces (packed)
+	uint64_t stencil_ops[2];	// sfail, dpfail, and dppass ops for front and back faces (packed)
+	uint64_t blend_equations;	// RGB and alpha blend equations (packed)
+	uint64_t blend_funcs;		// src/dst RGB and src/dst alpha blend factors (packed)
+	GLint n_draw_buffers;
+	GLenum cull_face;
+	GLenum depth_func;
+	GLuint stencil_write_masks[2];
+	uint8_t cull_enabled;
+	uint8_t depth_mask;
+	uint8_t color_mask;		// RGBA bits w/ A at LSB
+	uint8_t blend_enabled;
+} gl_raster_state_t;
 
 typedef struct pipeline_t {
 	GLint gl_program;		// this pipeline's GL program
+	pipeline_job_t* job;	// creation work still in progress (shader translation or program linking); 0 once the pipeline is ready
 	uint64_t vao_id;			// the ID of the VAO object for this pipeline (rasterization pipeline only)
 
 	uint32_t dset_layout_ids[MAX_NUMBER_BOUND_SETS];	// IDs of descriptor set layout objects referenced for each set binding
@@ -553,6 +684,26 @@ typedef struct pipeline_t {
 	uint8_t* push_constant_data;
 	uint8_t n_push_constant_bytes;
 
+	// uniform blocks in the GL program; parallel arrays indexed by the GL uniform buffer binding point assigned to each block
+	uint8_t* ubo_block_sets;		// set number of each uniform block
+	uint32_t* ubo_block_bindings;	// binding number of each uniform block
+	uint8_t* ubo_block_stages;		// 0 = block is in the vertex/compute shader, 1 = block is in the pixel shader
+	uint64_t* ubo_block_keys;		// layout key of each uniform block (see ubo_layout_key)
+	uint64_t* ubo_block_sizes;		// std140 size of each uniform block in bytes
+	uint32_t n_ubo_blocks;
+
+	// texture units of the GL program's samplers; parallel arrays indexed by texture unit, one entry per sampler array element
+	uint8_t* sampler_unit_sets;			// set number of the sampler at each texture unit
+	uint32_t* sampler_unit_bindings;	// binding number of the sampler at each texture unit
+	uint16_t* sampler_unit_elements;	// sampler array element (descriptor index within the binding) at each texture unit
+	uint32_t n_sampler_units;
+
+	// storage blocks in the GL program (compute pipeline only); parallel arrays indexed by the GL shader storage buffer binding point assigned to each block
+	uint8_t* sbo_block_sets;		// set number of each storage block
+	uint32_t* sbo_block_bindings;	// binding number of each storage block
+	uint64_t* sbo_block_keys;		// layout key of each storage block (see sbo_layout_key)
+	uint32_t n_sbo_blocks;
+
 	/* RASTERIZATION PIPELINE STATES */
 
 	uint8_t culled_winding;	// 0=no culling, 1=cw, 2=ccw, 3=cw+ccw
@@ -581,27 +732,60 @@ typedef struct pipeline_t {
 	uint8_t alpha_blend_op;	// the alpha blending operation
 	uint8_t src_alpha_blend_fac;	// the source alpha blending factor
 	uint8_t dst_alpha_blend_fac;	// the destination alpha blending factor
+	gl_raster_state_t gl_state;	// the states above as GL state (see build_pipeline_gl_state)
 } pipeline_t;
 
-// add null-terminated string str2 to the end of null-terminated string str1 
-void str_add(char** str1, const char* str2) {
-	uint32_t len1 = strlen(*str1), len2 = strlen(str2);
-	*str1 = realloc(*str1, len1+len2+1);
-	memcpy(*str1 + len1, str2, len2);
-	(*str1)[len1+len2] = '\0';
-}
-
-// insert a null-terminated string str2 starting at index pos in null-terminated string str1
-void str_insert(char** str1, const char* str2, uint32_t pos) {
-	uint32_t len1 = strlen(*str1), len2 = strlen(str2);
-	*str1 = realloc(*str1, len1+len2+1);
-	memcpy(*str1 + pos + len2, *str1 + pos, len1-pos);
-	memcpy(*str1 + pos, str2, len2);
-	(*str1)[len1+len2] = '\0';
-}
-
-// add shader data type name to the end of a null-terminated string given type's number
-void str_add_type(char** str, uint8_t type) {
+// growable string used to build GLSL source; len excludes the null character, cap is the allocated size
+// appends grow the allocation geometrically so that building a shader is linear in its output size
+typedef struct str_t {
+	char* str;
+	uint32_t len;
+	uint32_t cap;
+} str_t;
+
+// initialize an empty string with room for cap characters (incl. null character)
+void str_init(str_t* str, uint32_t cap) {
+	if(cap < 16) cap = 16;
+	str->str = malloc(cap);
+	str->str[0] = '\0';
+	str->len = 0;
+	str->cap = cap;
+}
+
+// ensure there is room for n more characters past the end of the string (plus the null character)
+void str_reserve(str_t* str, uint32_t n) {
+	if(str->len + n + 1 <= str->cap) return;
+	uint32_t cap = str->cap ? str->cap : 16;
+	while(cap < str->len + n + 1) cap *= 2;
+	str->str = realloc(str->str, cap);
+	str->cap = cap;
+}
+
+// add len2 characters of str2 to the end of str1
+void str_add_n(str_t* str1, const char* str2, uint32_t len2) {
+	str_reserve(str1, len2);
+	memcpy(str1->str + str1->len, str2, len2);
+	str1->len += len2;
+	str1->str[str1->len] = '\0';
+}
+
+// add null-terminated string str2 to the end of str1
+void str_add(str_t* str1, const char* str2) {
+	str_add_n(str1, str2, strlen(str2));
+}
+
+// insert a null-terminated string str2 starting at index pos (an insertion point previously taken from str1->len) in str1
+void str_insert(str_t* str1, const char* str2, uint32_t pos) {
+	uint32_t len2 = strlen(str2);
+	if(pos > str1->len) return;
+	str_reserve(str1, len2);
+	memmove(str1->str + pos + len2, str1->str + pos, str1->len - pos + 1);	// move the tail incl. null character
+	memcpy(str1->str + pos, str2, len2);
+	str1->len += len2;
+}
+
+// add shader data type name to the end of a string given type's number
+void str_add_type(str_t* str, uint8_t type) {
 	switch(type) {
 		case 0: str_add(str, "vec2"); break;
 		case 1: str_add(str, "vec3"); break;
@@ -630,32 +814,27 @@ void str_add_type(char** str, uint8_t type) {
 	}
 }
 
-// add an unsigned integer to the end of a null-terminated string
-void str_add_ui(char** str, uint32_t x) {
-	uint32_t str_size = 0;
-	uint32_t n_digits = (x/10)+1;	// this is how much to expand the length of the string by
-	for(uint32_t i = 0; i < 1000; i++) { str_size++; if((*str)[i] == '\0') break; }
-	*str = realloc(*str, str_size+n_digits);
-	sprintf(*str+str_size-1, "%u", x);
+// add an unsigned integer to the end of a string
+void str_add_ui(str_t* str, uint32_t x) {
+	char istring[12];
+	str_add_n(str, istring, sprintf(istring, "%u", x));
 }
 
-void str_add_i(char** str, int32_t x) {
-	uint32_t str_size = 0;
-	uint32_t n_digits = (abs(x)/10)+1;	// this is how much to expand the length of the string by
-	if(x<0) n_digits++;
-	for(uint32_t i = 0; i < 1000; i++) { str_size++; if((*str)[i] == '\0') break; }
-	*str = realloc(*str, str_size+n_digits);
-	sprintf(*str+str_size-1, "%i", x);
+void str_add_i(str_t* str, int32_t x) {
+	char istring[12];
+	str_add_n(str, istring, sprintf(istring, "%i", x));
 }
 
-void str_add_f(char** str, float x) {
-	char fstring[32];
-	sprintf(fstring, "%f", x);
-	str_add(str, fstring);
+// add a float literal; enough digits are written for the value to round-trip exactly
+void str_add_f(str_t* str, float x) {
+	char fstring[64];
+	int len = snprintf(fstring, sizeof(fstring), "%.9g", x);
+	if(!strpbrk(fstring, ".ein")) fstring[len++] = '.', fstring[len++] = '0';	// keep integral values float literals
+	str_add_n(str, fstring, len);
 }
 
-// shorthand to add the .x, .y, .z, or .w for a vector to the end of a null-terminated string
-void str_add_vec_idx(char** str, uint32_t idx) {
+// shorthand to add the .x, .y, .z, or .w for a vector to the end of a string
+void str_add_vec_idx(str_t* str, uint32_t idx) {
 	switch(idx) {
 		case 0: str_add(str, ".x"); break;
 		case 1: str_add(str, ".y"); break;
@@ -664,8 +843,8 @@ void str_add_vec_idx(char** str, uint32_t idx) {
 	}
 }
 
-// shorthand to add the [col][row] for a matrix to the end of a null-terminated string
-void str_add_mat_idx(char** str, uint8_t width, uint8_t height, uint32_t idx) {
+// shorthand to add the [col][row] for a matrix to the end of a string
+void str_add_mat_idx(str_t* str, uint8_t width, uint8_t height, uint32_t idx) {
 	str_add(str, "[");
 	str_add_ui(str, idx/height);
 	str_add(str, "][");
@@ -673,12 +852,10 @@ void str_add_mat_idx(char** str, uint8_t width, uint8_t height, uint32_t idx) {
 	str_add(str, "]");
 }
 
-// shorthand to add the loop counter that corresponds to the shader's scope_level to the end of a null-terminated string
-void str_add_iterator(char** str, uint8_t scope_level) {
+// shorthand to add the loop counter that corresponds to the shader's scope_level to the end of a string
+void str_add_iterator(str_t* str, uint8_t scope_level) {
 	if(!scope_level || scope_level > 8) return;
-	char x[2]; x[1] = '\0';
-	x[0] = "ijklmnop"[scope_level-1];
-	str_add(str, (const char*)&x);
+	str_add_n(str, &"ijklmnop"[scope_level-1], 1);
 }
 
 #define VAR_DEF_BIT 0x1
@@ -712,6 +889,8 @@ typedef struct shader_data_t {
 
 	definition_t* defs;
 	uint32_t n_defs;
+
+	uint8_t no_vertex_shader;	// pixel shader translated without its vertex shader (--translate-shader); inputs aren't matched to vertex outputs
 } shader_data_t;
 
 // add a set+binding pair to shader data (type; 0=uniform, 1=storage, 2=sampler, 3=image, 4=AS)
@@ -772,6 +951,7 @@ struct definition_t {
 	uint8_t set;			// uniform block set number
 	uint32_t binding;		// uniform block binding number
 	func_def_t* func_def;	// pointer to function defined under this identifier
+	uint8_t used;			// whether or not any kept instruction reads this identifier; unread uniforms are not uploaded
 };
 
 // created for each defined function; information about parameters
@@ -784,35 +964,201 @@ struct func_def_t {
 		// 21=sampler, 22=isampler, 23=usampler, 24=image, 25=acceleration structure)
 };
 
+// range of the GLSL output holding one variable or uniform declaration
+typedef struct decl_span_t {
+	uint32_t start;
+	uint32_t end;
+	uint32_t n_reads;	// how many times the identifier is read by instructions that are kept
+	uint16_t id;
+	uint16_t pad;		// for uniform block members, how many vec4s replace the member if it is never read (keeps the block layout); 0 removes it
+} decl_span_t;
+
+// range of the GLSL output holding one instruction whose only effect is writing to a variable with a removable declaration
+typedef struct stmt_span_t {
+	uint32_t start;
+	uint32_t end;
+	uint32_t dest;		// 1 + the index in decls of the variable written
+	uint32_t reads;		// index in stmt_reads of the declarations read by the instruction
+	uint32_t n_reads;
+	uint8_t removed;
+} stmt_span_t;
+
+// identifier table used while translating a shader
+// identifiers are unique across all definition types, so each 16-bit identifier maps directly to at most one definition
+typedef struct def_table_t {
+	definition_t* defs;	// all identifier definitions, in order of definition
+	uint32_t n_defs;
+	uint32_t cap;			// allocated number of definitions
+	uint32_t* index;		// 65536 entries; for each identifier, 1 + its index in defs, or 0 if it is not defined
+	uint32_t scope_start;	// value of n_defs when the current function scope was pushed
+	uint32_t* decl;			// for each definition, 1 + the index of its removable declaration in decls, or 0 if it has none
+	decl_span_t* decls;		// GLSL declarations that are removed after translation if their identifier is never read
+	uint32_t n_decls;
+	uint32_t decls_cap;
+	stmt_span_t* stmts;		// instructions that are removed after translation along with the variable they write to
+	uint32_t n_stmts;
+	uint32_t stmts_cap;
+	uint32_t* stmt_reads;	// 1 + the index in decls of each read made by the instructions in stmts
+	uint32_t n_stmt_reads;
+	uint32_t stmt_reads_cap;
+	uint32_t stmt_start;	// GLSL offset where the current instruction's output starts
+	uint32_t stmt_dest;		// 1 + the index in decls of the variable the current instruction only writes to, or 0
+	uint32_t stmt_first_read;	// n_stmt_reads when the current instruction started
+} def_table_t;
+
 // check if a specified identifier exists
 // filter is OR'd together bits; everthing to search for
 // returns 0 if the identifier does not exist, address to the existing definition_t otherwise
-definition_t* check_identifier_existence(uint16_t id, definition_t* defs, uint32_t n_defs, uint32_t filter) {
-	if(defs)
-		for(uint32_t i = 0; i < n_defs; i++) if(defs[i].def_type & filter && defs[i].id == id) return &defs[i];
+// a found identifier is counted as read by the current instruction
+definition_t* check_identifier_existence(uint16_t id, def_table_t* table, uint32_t filter) {
+	uint32_t i = table->index[id];
+	if(i && table->defs[i-1].def_type & filter) {
+		uint32_t decl = table->decl[i-1];
+		if(decl) {
+			table->decls[decl-1].n_reads++;
+			if(table->n_stmt_reads == table->stmt_reads_cap) {
+				table->stmt_reads_cap = table->stmt_reads_cap ? table->stmt_reads_cap*2 : 256;
+				table->stmt_reads = realloc(table->stmt_reads, sizeof(uint32_t)*table->stmt_reads_cap);
+			}
+			table->stmt_reads[table->n_stmt_reads++] = decl;
+		}
+		return &table->defs[i-1];
+	}
 	return 0;
 }
 
 // shorthand for check_identifier_existence; check all definition types but allows to filter out (exclude) some 
-definition_t* check_identifier_existence_excl(uint16_t id, definition_t* defs, uint32_t n_defs, uint32_t excl_filter) {
-	return check_identifier_existence(id,defs,n_defs,ALL_DEF_BIT & (~excl_filter));
+definition_t* check_identifier_existence_excl(uint16_t id, def_table_t* table, uint32_t excl_filter) {
+	return check_identifier_existence(id,table,ALL_DEF_BIT & (~excl_filter));
+}
+
+// like check_identifier_existence_excl, for the output of an instruction that has no effect other than writing to it
+// the identifier is not counted as read; if its declaration is removable, so is the instruction
+definition_t* check_dest_identifier_excl(uint16_t id, def_table_t* table, uint32_t excl_filter) {
+	uint32_t i = table->index[id];
+	if(!i || !(table->defs[i-1].def_type & ALL_DEF_BIT & (~excl_filter))) return 0;
+	if(table->decl[i-1] && !table->decls[table->decl[i-1]-1].pad) table->stmt_dest = table->decl[i-1];
+	return &table->defs[i-1];
 }
 
 // defines a new identifier
 // pushes its data structure to the back of defs array
-void add_definition(definition_t** defs, uint32_t* n_defs, uint16_t id, uint8_t def_type, uint8_t data_type, uint16_t elcount,
+void add_definition(def_table_t* table, uint16_t id, uint8_t def_type, uint8_t data_type, uint16_t elcount,
 	uint16_t location_id, uint8_t within_block, uint8_t set, uint32_t binding, func_def_t* func_def) {
-	*defs = realloc(*defs, sizeof(definition_t)*((*n_defs)+1));
-	(*defs)[*n_defs].id = id;
-	(*defs)[*n_defs].def_type = def_type;
-	(*defs)[*n_defs].data_type = data_type;
-	(*defs)[*n_defs].elcount = elcount;
-	(*defs)[*n_defs].location_id = location_id;
-	(*defs)[*n_defs].within_block = within_block;
-	(*defs)[*n_defs].set = set;
-	(*defs)[*n_defs].binding = binding;
-	(*defs)[*n_defs].func_def = func_def;
-	(*n_defs)++;
+	if(table->n_defs == table->cap) {
+		table->cap = table->cap ? table->cap*2 : 64;
+		table->defs = realloc(table->defs, sizeof(definition_t)*table->cap);
+		table->decl = realloc(table->decl, sizeof(uint32_t)*table->cap);
+	}
+	table->decl[table->n_defs] = 0;
+	definition_t* def = &table->defs[table->n_defs];
+	def->id = id;
+	def->def_type = def_type;
+	def->data_type = data_type;
+	def->elcount = elcount;
+	def->location_id = location_id;
+	def->within_block = within_block;
+	def->set = set;
+	def->binding = binding;
+	def->func_def = func_def;
+	def->used = 0;
+	table->index[id] = ++table->n_defs;
+}
+
+// record GLSL output start..end as the declaration of the most recently added definition
+// pad is the number of vec4s left in its place if it is never read, or 0 to remove it
+void add_decl_span(def_table_t* table, uint32_t start, uint32_t end, uint16_t pad) {
+	if(table->n_decls == table->decls_cap) {
+		table->decls_cap = table->decls_cap ? table->decls_cap*2 : 64;
+		table->decls = realloc(table->decls, sizeof(decl_span_t)*table->decls_cap);
+	}
+	table->decls[table->n_decls] = (decl_span_t){ start, end, 0, table->defs[table->n_defs-1].id, pad };
+	table->decl[table->n_defs-1] = ++table->n_decls;
+}
+
+// end the output of the current instruction at pos and start the next one there
+// if the instruction only wrote to a removable variable, it is kept as a stmt_span_t; otherwise its reads are final
+void next_stmt_span(def_table_t* table, uint32_t pos) {
+	uint32_t dest = table->stmt_dest, n = table->stmt_first_read;
+	if(dest) {
+		for(uint32_t i = table->stmt_first_read; i < table->n_stmt_reads; i++) {
+			if(table->stmt_reads[i] == dest) table->decls[dest-1].n_reads--;	// a variable read only to update itself (x = x + 1) is still unread
+			else table->stmt_reads[n++] = table->stmt_reads[i];
+		}
+		if(table->n_stmts == table->stmts_cap) {
+			table->stmts_cap = table->stmts_cap ? table->stmts_cap*2 : 64;
+			table->stmts = realloc(table->stmts, sizeof(stmt_span_t)*table->stmts_cap);
+		}
+		table->stmts[table->n_stmts++] = (stmt_span_t){ table->stmt_start, pos, dest, table->stmt_first_read, n - table->stmt_first_read, 0 };
+	}
+	table->n_stmt_reads = n;
+	table->stmt_start = pos;
+	table->stmt_dest = 0;
+	table->stmt_first_read = n;
+}
+
+// start a function scope; identifiers defined after this are removed by def_scope_pop
+void def_scope_push(def_table_t* table) {
+	table->scope_start = table->n_defs;
+}
+
+// leave a function scope, forgetting the identifiers local to it
+void def_scope_pop(def_table_t* table) {
+	while(table->n_defs > table->scope_start) {
+		definition_t* def = &table->defs[--table->n_defs];
+		table->index[def->id] = 0;
+	}
+}
+
+// remove the declarations of variables and uniforms that are never read from the GLSL, along with the instructions that only write to them
+// uniform block members are replaced with padding instead; returns the new position of the output offset 'pos'
+uint32_t remove_unused_decls(def_table_t* table, str_t* glsl, uint32_t pos) {
+	uint8_t changed = 1;
+	while(changed) {	// removing an instruction can leave what it read unread
+		changed = 0;
+		for(uint32_t i = 0; i < table->n_stmts; i++) {
+			stmt_span_t* stmt = &table->stmts[i];
+			if(stmt->removed || table->decls[stmt->dest-1].n_reads) continue;
+			for(uint32_t r = 0; r < stmt->n_reads; r++)
+				table->decls[table->stmt_reads[stmt->reads+r]-1].n_reads--;
+			stmt->removed = changed = 1;
+		}
+	}
+	for(uint32_t i = 0; i < table->n_defs; i++)
+		table->defs[i].used = !table->decl[i] || table->decls[table->decl[i]-1].n_reads;
+
+	str_t out;
+	str_init(&out, glsl->len + 1);
+	uint32_t read = 0, new_pos = pos, d = 0, s = 0;
+	uint8_t found_pos = 0;
+	while(d < table->n_decls || s < table->n_stmts) {	// both span lists are in output order and never overlap
+		uint32_t start, end;
+		decl_span_t* decl = 0;
+		if(s == table->n_stmts || (d < table->n_decls && table->decls[d].start < table->stmts[s].start)) {
+			decl = &table->decls[d++];
+			if(decl->n_reads) continue;
+			start = decl->start, end = decl->end;
+		} else {
+			if(!table->stmts[s].removed) { s++; continue; }
+			start = table->stmts[s].start, end = table->stmts[s].end;
+			s++;
+		}
+		if(!found_pos && start >= pos) new_pos = out.len + pos - read, found_pos = 1;
+		str_add_n(&out, glsl->str + read, start - read);
+		read = end;
+		if(decl && decl->pad) {
+			str_add(&out, "vec4 _");
+			str_add_ui(&out, decl->id);
+			str_add(&out, "[");
+			str_add_ui(&out, decl->pad);
+			str_add(&out, "];\n");
+		}
+	}
+	if(!found_pos) new_pos = out.len + pos - read;
+	str_add_n(&out, glsl->str + read, glsl->len - read);
+	free(glsl->str);
+	*glsl = out;
+	return new_pos;
 }
 
 // returns 1 if the definition type specified by def_type can be an array, and 0 otherwise
@@ -822,7 +1168,7 @@ uint8_t check_def_type_array(uint32_t def_type) {
 
 // given a type, add typecast to higher precision as required (uint/int/float required is stated in types)
 // bitwise OR together the results from check_type for 'types'
-void str_add_typecast(char** str, uint8_t full_vector, uint8_t n_vector_elements, uint8_t types) {
+void str_add_typecast(str_t* str, uint8_t full_vector, uint8_t n_vector_elements, uint8_t types) {
 	if(!full_vector) {	// if not a full vector, then dealing with a scalar
 		if(types == 0) str_add(str, "uint(");
 		if(types == 1) str_add(str, "int(");
@@ -856,17 +1202,32 @@ uint8_t base_type(uint8_t type) {
 	else return 2;
 }
 
-void str_add_constant(char** str, uint32_t constant, uint8_t type) {
+void str_add_constant(str_t* str, uint32_t constant, uint8_t type) {
 	if(type == 0) {
-		str_add(str, "uint(");
 		str_add_ui(str, constant);
-		str_add(str, ")");
+		str_add(str, "u");
 	}
 	if(type == 1) str_add_i(str, *(int32_t*)&constant);
 	if(type  > 1) str_add_f(str, *(float*)&constant);
 }
 
-void str_add_operation(char** str, uint8_t operation) {
+// add a constant of base type 'type' converted to base type 'cast_type', wrapped in parentheses
+// the conversion is folded into the literal where it is exact; float to int/uint is left to a GLSL typecast
+void str_add_constant_cast(str_t* str, uint32_t constant, uint8_t type, uint8_t cast_type) {
+	if(type > 1 && cast_type < 2) {
+		str_add_typecast(str, 0, 0, cast_type);
+		str_add_constant(str, constant, type);
+		str_add(str, ")");
+		return;
+	}
+	str_add(str, "(");
+	if(cast_type > 1 && type == 0) str_add_f(str, (float)constant);
+	else if(cast_type > 1 && type == 1) str_add_f(str, (float)*(int32_t*)&constant);
+	else str_add_constant(str, constant, cast_type);	// same type, or int <-> uint which keeps the bits
+	str_add(str, ")");
+}
+
+void str_add_operation(str_t* str, uint8_t operation) {
 	switch(operation) {
 		case 0x0: str_add(str, " + "); break;
 		case 0x1: str_add(str, " * "); break;
@@ -914,21 +1275,27 @@ int32_t read_array_idx(uint16_t* array_index, uint16_t* identifier, uint16_t* mu
 
 // reads the common form of {identifier | index} without the 8 bits for vector/matrix element; puts its data into newly defined variables, returns if invalid
 // opcode is assumed to be at the identifier, and will be shifted forward to the address after the index if fail
-#define READ_ID(n,exclude_filter) definition_t *def_ptr##n; \
+#define READ_ID(n,exclude_filter) READ_ID_LOOKUP(n,exclude_filter,check_identifier_existence_excl)
+
+// READ_ID for the output of an instruction that only writes to it; the identifier is not counted as read
+#define READ_DEST_ID(n,exclude_filter) READ_ID_LOOKUP(n,exclude_filter,check_dest_identifier_excl)
+
+// implementation for READ_ID and READ_DEST_ID; lookup is the function used to find the identifier's definition
+#define READ_ID_LOOKUP(n,exclude_filter,lookup) definition_t *def_ptr##n; \
 	uint16_t id##n = READ(opcode,2); \
-	if(!(def_ptr##n=check_identifier_existence_excl(id##n,defs,n_defs,exclude_filter))) return 1; /* identifier does not exist */ \
+	if(!(def_ptr##n=lookup(id##n,table,exclude_filter))) return 1; /* identifier does not exist */ \
 	uint8_t is_arr##n = 0, type##n = def_ptr##n->data_type, elcount##n = def_ptr##n->elcount; \
 	is_arr##n = check_def_type_array(def_ptr##n->def_type); \
 	uint16_t idx_id##n, multiplier##n; \
 	int32_t offset##n, arr_idx##n = is_arr##n ? read_array_idx((uint16_t*)(opcode+2), &idx_id##n, &multiplier##n, &offset##n, end) : 0; \
 	if(is_arr##n && arr_idx##n < IDX_TYPE_INSTANCE) return 1; \
-	if(arr_idx##n >= 0 && arr_idx##n > elcount##n) return 1; /* using constant as index and the index does not exist */ \
-	if(arr_idx##n == IDX_TYPE_LOOP && (level_status[scope_level-1]!=2||level_iterations[scope_level-1]-1>elcount##n)) return 1; /* using current loop iteration and this level is not in loop/has too many iterations*/ \
+	if(arr_idx##n >= 0 && arr_idx##n > elcount##n && def_ptr##n->elcount) return 1; /* using constant as index and the index does not exist (unsized storage arrays aren't checked) */ \
+	if(arr_idx##n == IDX_TYPE_LOOP && (level_status[scope_level-1]!=2||(level_iterations[scope_level-1]-1>elcount##n && def_ptr##n->elcount))) return 1; /* using current loop iteration and this level is not in loop/has too many iterations*/ \
 	if(arr_idx##n == IDX_TYPE_VAR && (shader_type != 0 || def_ptr##n->def_type != UNIF_DEF_BIT)) return 1; /* using uint variable as index and not vertex shader with uniform arrays */ \
-	if(arr_idx##n == IDX_TYPE_VAR && !check_identifier_existence(idx_id##n,defs,n_defs,VAR_DEF_BIT)) return 1; \
-	if(arr_idx##n == IDX_TYPE_VAR && check_identifier_existence(idx_id##n,defs,n_defs,VAR_DEF_BIT)->elcount != 1) return 1; \
-	if(arr_idx##n == IDX_TYPE_UNIFORM && !check_identifier_existence(idx_id##n,defs,n_defs,UNIF_DEF_BIT)) return 1; \
-	if(arr_idx##n == IDX_TYPE_UNIFORM && check_identifier_existence(idx_id##n,defs,n_defs,UNIF_DEF_BIT)->elcount != 1) return 1; \
+	if(arr_idx##n == IDX_TYPE_VAR && !check_identifier_existence(idx_id##n,table,VAR_DEF_BIT)) return 1; \
+	if(arr_idx##n == IDX_TYPE_VAR && check_identifier_existence(idx_id##n,table,VAR_DEF_BIT)->elcount != 1) return 1; \
+	if(arr_idx##n == IDX_TYPE_UNIFORM && !check_identifier_existence(idx_id##n,table,UNIF_DEF_BIT)) return 1; \
+	if(arr_idx##n == IDX_TYPE_UNIFORM && check_identifier_existence(idx_id##n,table,UNIF_DEF_BIT)->elcount != 1) return 1; \
 	if(arr_idx##n == IDX_TYPE_INSTANCE && shader_type != 0) return 1; /* instance ID can only be used as index in vertex shaders */ \
 	opcode += 2; \
 	if(is_arr##n && arr_idx##n >= 0) opcode += 2;	/* array index provided by constant index */ \
@@ -941,14 +1308,16 @@ int32_t read_array_idx(uint16_t* array_index, uint16_t* identifier, uint16_t* mu
 // opcode is assumed to be at the beginning of the id
 #define READ_ID_WITH_MATVEC_ELEMENT(n,exclude_filter) READ_ID(n,exclude_filter);\
 	uint8_t matvec_idx##n = type##n<18 ? READ(opcode,1) : 0; if(type##n<18) opcode++; /* matrix/vector element will follow array index if type < 18 (is matrix or vector) */
+#define READ_DEST_ID_WITH_MATVEC_ELEMENT(n,exclude_filter) READ_DEST_ID(n,exclude_filter);\
+	uint8_t matvec_idx##n = type##n<18 ? READ(opcode,1) : 0; if(type##n<18) opcode++;
 
 // used to add index [] to shader; n should be the same as in READ_ID
 #define ADD_IDX(n) { \
-	if(is_arr##n) add_idx(&glsl_shader->src, idx_id##n, arr_idx##n, multiplier##n, offset##n, scope_level); \
+	if(is_arr##n) add_idx(glsl, idx_id##n, arr_idx##n, multiplier##n, offset##n, scope_level); \
 }
 
 // implementation for ADD_IDX(n) macro
-void add_idx(char** str, uint16_t idx_id, int32_t arr_idx, uint16_t multiplier, int32_t offset, uint8_t scope_level) {
+void add_idx(str_t* str, uint16_t idx_id, int32_t arr_idx, uint16_t multiplier, int32_t offset, uint8_t scope_level) {
 	str_add(str, "["); \
 	if(arr_idx >= 0) str_add_ui(str, arr_idx);
 	else if(arr_idx == IDX_TYPE_LOOP) str_add_iterator(str, scope_level-1);
@@ -972,8 +1341,8 @@ void add_idx(char** str, uint16_t idx_id, int32_t arr_idx, uint16_t multiplier,
 	str_add(str, "]");
 }
 
-// returns 1 on fail, returns 0 and fills glsl_shader on success
-uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_t* glsl_shader, shader_data_t* shader_data) {
+// translate shader bytecode to GLSL, appending the result to glsl; returns 1 on fail, 0 on success
+uint8_t translate_shader(uint8_t* src, uint32_t length, uint8_t shader_type, str_t* glsl, def_table_t* table, shader_data_t* shader_data) {
 	if(length == 0) return 1;
 	// shader_type: 0=vertex, 1=pixel, 2=compute, 3=other (RT shader; unsupported + bytecode exclusive to RT shaders will be treated as invalid)
 
@@ -981,17 +1350,14 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 	uint8_t err = 0;	// checked at the beginning of instruction processing loop
 	#define READ(ptr,n_bytes) (ptr+n_bytes-1 > end ? (err=1) : loadval(ptr,n_bytes))	/* shorthand to read a value from the shader safely */
 	// check if identifier exists, return 1 if it does
-	#define CHECK_ID_DEFINED(id) if(check_identifier_existence(id,defs,n_defs,ALL_DEF_BIT)) return 1
+	#define CHECK_ID_DEFINED(id) if(check_identifier_existence(id,table,ALL_DEF_BIT)) return 1
 	#define MAT_WIDTH(type) (((type-9)/3)+2)		/* gets the matrix width given a matrix type # */
 	#define MAT_HEIGHT(type) (((type-9)%3)+2)	/* gets the matrix height given a matrix type # */
 	#define MAT_SIZE(type) (MAT_WIDTH(type)*MAT_HEIGHT(type))	/* gets the number of matrix elements given a matrix type */
 	#define VEC_SIZE(type) ((type%3)+2)	/* gets the number of vector elements given a vector type */
 
-	// previously globally defined identifiers, their element counts, and their types
-	// there are functions, uniforms, variables, in/out attributes, ray attributes, and incoming ray attributes
-	definition_t* defs = 0;	// array of all defined identifiers + their information
-	uint32_t n_defs = 0;			// total number of identifier definitions
-	uint32_t n_local_defs = 0;	// number of variables defined within a function; remove this number from back of definitions array when the function is exited
+	// previously defined identifiers (functions, uniforms, variables, in/out attributes, ray attributes, and incoming ray attributes) are in table;
+	// variables local to a function are pushed as a scope at the function opener and popped when the function is exited
 
 	// scope information
 	uint8_t scope_type = 0;			// current scope type (0=global, 1=main func, 2=func, 3=uniform block, 4=push constant block, 5=storage block, 6=ray payload block, 
@@ -1014,11 +1380,27 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 
 	uint32_t entry_point = 0, modified_frag_depth = 0;	// used for inserting gl_FragDepth = gl_FragCoord.z; when needed
 
-	str_add(&glsl_shader->src, "#version 330 core\n");
+	if(shader_type == 2) {	// compute shaders start with the X, Y, Z of the local work-group dimensions
+		if(length < 12) return 1;
+		uint32_t local_size[3] = { loadval(src,4), loadval(src+4,4), loadval(src+8,4) };
+		for(uint32_t i = 0; i < 3; i++)
+			if(!local_size[i] || local_size[i] > max_local_work_size[i]) return 1;
+		if((uint64_t)local_size[0]*local_size[1]*local_size[2] > max_local_work_size[3]) return 1;
+		str_add(glsl, "#version 430 core\nlayout(local_size_x = ");
+		str_add_ui(glsl, local_size[0]);
+		str_add(glsl, ", local_size_y = ");
+		str_add_ui(glsl, local_size[1]);
+		str_add(glsl, ", local_size_z = ");
+		str_add_ui(glsl, local_size[2]);
+		str_add(glsl, ") in;\n");
+		src += 12;
+		length -= 12;
+	} else str_add(glsl, "#version 330 core\n");
 	uint8_t* opcode = src;
 	uint8_t* end = src+length-1;
 	while(opcode <= end) {
 		if(err) return 1;	// there was an error loading a value for last instruction processed (a value read previously exceeded end of the shader)
+		next_stmt_span(table, glsl->len);
 		uint8_t op_byte = *opcode;
 		if(*opcode >= 0x00 && *opcode <= 0x03) {	// in/out attribute definition
 			if(shader_type == 2 || shader_type == 3) return 1;	// attributes can't be defined in compute or RT shaders
@@ -1033,43 +1415,43 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				if(check_location_existence(shader_data,location_id)) return 1;
 				add_location(shader_data,location_id);
 			}
-			if(op_byte == 0x00) add_definition(&defs, &n_defs, id, IN_ATTR_DEF_BIT, type, 0, location_id, 0, 0, 0, 0);
-			else add_definition(&defs, &n_defs, id, OUT_ATTR_DEF_BIT, type, 0, location_id, 0, 0, 0, 0);
+			if(op_byte == 0x00) add_definition(table, id, IN_ATTR_DEF_BIT, type, 0, location_id, 0, 0, 0, 0);
+			else add_definition(table, id, OUT_ATTR_DEF_BIT, type, 0, location_id, 0, 0, 0, 0);
 			if((shader_type == 0 && op_byte == 0) || (shader_type == 1 && op_byte != 0)) {	// vertex inputs + pixel outputs have location IDs
-				str_add(&glsl_shader->src, "layout(location = ");
-				str_add_ui(&glsl_shader->src, location_id);
-				str_add(&glsl_shader->src, ") ");
+				str_add(glsl, "layout(location = ");
+				str_add_ui(glsl, location_id);
+				str_add(glsl, ") ");
 			}
 			if(shader_type == 1 && op_byte == 0x00) { // pixel shader input definition
 				uint8_t found_matching_output = 0;
 				for(uint32_t i = 0; i < shader_data->n_vertex_outputs; i++) {
 					if(shader_data->vertex_output_ids[i] == id) {
 						switch(shader_data->vertex_output_modes[i]) {
-							case 1: str_add(&glsl_shader->src, "flat "); break;
-							case 2: str_add(&glsl_shader->src, "smooth "); break;
-							case 3: str_add(&glsl_shader->src, "noperspective "); break;
+							case 1: str_add(glsl, "flat "); break;
+							case 2: str_add(glsl, "smooth "); break;
+							case 3: str_add(glsl, "noperspective "); break;
 						}
 						found_matching_output = 1;
 						break;
 					}
 				}
-				if(!found_matching_output) return 1;
+				if(!found_matching_output && !shader_data->no_vertex_shader) return 1;
 				add_pixel_input(shader_data, id, type);
 			}
-			if(op_byte == 0x00) str_add(&glsl_shader->src, "in ");
+			if(op_byte == 0x00) str_add(glsl, "in ");
 			else if(shader_type == 0) {
 				if(op_byte != 0x01 && base_type(type) != 2) return 1; // int vertex output must be defined as flat
 				switch(op_byte) {
-					case 0x01: str_add(&glsl_shader->src, "flat out "); break;
-					case 0x02: str_add(&glsl_shader->src, "smooth out "); break;
-					case 0x03: str_add(&glsl_shader->src, "noperspective out "); break;
+					case 0x01: str_add(glsl, "flat out "); break;
+					case 0x02: str_add(glsl, "smooth out "); break;
+					case 0x03: str_add(glsl, "noperspective out "); break;
 				}
 				add_vertex_output(shader_data, id, type, op_byte);	// add vertex shader attribute output to shader_data ('mode' is = op_byte)
-			} else if(op_byte > 0x00) str_add(&glsl_shader->src, "out ");
-			str_add_type(&glsl_shader->src, type);
-			str_add(&glsl_shader->src, " _");
-			str_add_ui(&glsl_shader->src, id);
-			str_add(&glsl_shader->src, ";\n");
+			} else if(op_byte > 0x00) str_add(glsl, "out ");
+			str_add_type(glsl, type);
+			str_add(glsl, " _");
+			str_add_ui(glsl, id);
+			str_add(glsl, ";\n");
 			if((shader_type == 0 && op_byte == 0) || (shader_type == 1 && op_byte != 0)) opcode += 6; // move to next instruction
 			else opcode += 4;	// move to next instruction (no location ID)
 		} else if(*opcode == 0x04) {	// uniform definition
@@ -1088,36 +1470,41 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			else if(type > 25) return 1;
 			else if(elcount == 0) return 1;
 			CHECK_ID_DEFINED(id);	// make sure the identifier isn't already defined
-			if(scope_type == 3) add_definition(&defs, &n_defs, id, UNIF_DEF_BIT, type, elcount, 0, 1, shader_data->sets[shader_data->n_set_binding_pairs-1], shader_data->bindings[shader_data->n_set_binding_pairs-1], 0);
+			if(scope_type == 3) add_definition(table, id, UNIF_DEF_BIT, type, elcount, 0, 1, shader_data->sets[shader_data->n_set_binding_pairs-1], shader_data->bindings[shader_data->n_set_binding_pairs-1], 0);
 			else {
 				shader_data->n_push_constant_bytes += 4*(type < 9 ? VEC_SIZE(type) : 1)*(type >= 9 && type < 18 ? MAT_SIZE(type) : 1);
-				add_definition(&defs, &n_defs, id, UNIF_DEF_BIT, type, elcount, 1, 1, 0, 0, 0);
+				add_definition(table, id, UNIF_DEF_BIT, type, elcount, 1, 1, 0, 0, 0);
 			}
-			str_add(&glsl_shader->src, "uniform "); // the VM currently does not support uniform blocks; otherwise this would not be required except for w/ samplers/images
-			str_add_type(&glsl_shader->src, type);
-			str_add(&glsl_shader->src, " _");
-			str_add_ui(&glsl_shader->src, id);
-			str_add(&glsl_shader->src, "[");
-			str_add_ui(&glsl_shader->src, elcount);
-			str_add(&glsl_shader->src, "]");
-			str_add(&glsl_shader->src, ";\n");
+			uint32_t decl_start = glsl->len;
+			if(scope_type == 4 || type >= 21) str_add(glsl, "uniform "); // push constants and sampler/image/AS uniforms are not defined within a GLSL uniform block
+			str_add_type(glsl, type);
+			str_add(glsl, " _");
+			str_add_ui(glsl, id);
+			str_add(glsl, "[");
+			str_add_ui(glsl, elcount);
+			str_add(glsl, "]");
+			str_add(glsl, ";\n");
+			if(scope_type == 4 || (type >= 21 && type <= 23)) add_decl_span(table, decl_start, glsl->len, 0);
+			else if(type < 21) add_decl_span(table, decl_start, glsl->len, elcount*(type >= 9 && type <= 17 ? MAT_WIDTH(type) : 1)); // std140 gives every element and matrix column of a block member 16 bytes
 			opcode += 6;	// move to next instruction
 		} else if(*opcode == 0x05) {	// variable definition
 			if((scope_type > 2 && scope_type != 5) || scope_level > 1) return 1; // variables can only be defined globally, at level 0/1, or in a storage block
 			uint16_t id = READ(opcode+2,2);
 			uint16_t elcount = READ(opcode+4,2);
 			uint8_t type = READ(opcode+1,1);
-			if(elcount == 0 && !(scope_type == 5 && READ(opcode+6,1) != 0x08)) return 1; // can only define unsized variable as last variable in a storage block
+			if(elcount == 0 && !(scope_type == 5 && READ(opcode+6,1) == 0x08)) return 1; // can only define unsized variable as last variable in a storage block
 			if(type > 20) return 1;	// can't define sampler variable (21, 22, 23), image variable (24), or AS variable (25); > 25 is invalid
 			CHECK_ID_DEFINED(id);	// make sure the identifier isn't already defined
-			add_definition(&defs, &n_defs, id, VAR_DEF_BIT, type, elcount, 0, 0, 0, 0, 0);
-			if(scope_level == 1) n_local_defs++;	// if at level 1 of a function, this variable definition is a local variable
-			str_add_type(&glsl_shader->src, type);
-			str_add(&glsl_shader->src, " _");
-			str_add_ui(&glsl_shader->src, id);
-			str_add(&glsl_shader->src, "[");
-			str_add_ui(&glsl_shader->src, elcount);
-			str_add(&glsl_shader->src, "];\n");
+			if(scope_type == 5) add_definition(table, id, VAR_DEF_BIT, type, elcount, 0, 1, shader_data->sets[shader_data->n_set_binding_pairs-1], shader_data->bindings[shader_data->n_set_binding_pairs-1], 0);
+			else add_definition(table, id, VAR_DEF_BIT, type, elcount, 0, 0, 0, 0, 0);
+			uint32_t decl_start = glsl->len;
+			str_add_type(glsl, type);
+			str_add(glsl, " _");
+			str_add_ui(glsl, id);
+			str_add(glsl, "[");
+			if(elcount) str_add_ui(glsl, elcount);	// an unsized storage array gets its length from the size of the SBO
+			str_add(glsl, "];\n");
+			if(scope_type != 5) add_decl_span(table, decl_start, glsl->len, 0); // members of storage blocks are kept for the block layout
 			opcode += 6;
 		} else if(*opcode == 0x06) {	// ray attribute definition
 			if(shader_type != 3) return 1;	// ray attributes can only be defined in RT shaders
@@ -1128,8 +1515,8 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(elcount == 0) return 1;
 			if(type > 20) return 1;	// can't define sampler ray attrib (21, 22, 23), image ray attrib (24), or AS ray attrib (25); > 25 is invalid
 			CHECK_ID_DEFINED(id);	// make sure the identifier isn't already defined
-			if(scope_type == 6) add_definition(&defs, &n_defs, id, RAY_ATTR_DEF_BIT, type, elcount, shader_data->locations[shader_data->n_locations-1], 0, 0, 0, 0);
-			if(scope_type == 7)	add_definition(&defs, &n_defs, id, INCOMING_RAY_ATTR_DEF_BIT, type, elcount, shader_data->locations[shader_data->n_locations-1], 0, 0, 0, 0);
+			if(scope_type == 6) add_definition(table, id, RAY_ATTR_DEF_BIT, type, elcount, shader_data->locations[shader_data->n_locations-1], 0, 0, 0, 0);
+			if(scope_type == 7)	add_definition(table, id, INCOMING_RAY_ATTR_DEF_BIT, type, elcount, shader_data->locations[shader_data->n_locations-1], 0, 0, 0, 0);
 			opcode += 6;
 		} else if(*opcode == 0x07) {	// uniform block opener
 			if(scope_type != 0) return 1;	// can only open uniform block in global scope
@@ -1143,24 +1530,21 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			else if(READ(opcode+7,1) == 25) add_set_binding(shader_data,set,binding,4); // uniform def. after opener is an AS
 			else add_set_binding(shader_data,set,binding,0);
 			scope_type = 3;
-			// the VM currently does not support uniform buffers; so they are not added to the GLSL
-			/*str_add(&glsl_shader->src, "layout(std140) uniform _");
-			str_add_ui(&glsl_shader->src, set);
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, binding);
-			str_add(&glsl_shader->src, " {\n");*/
+			if(READ(opcode+7,1) < 21) { // uniform data is placed in a std140 GL uniform block named _set_binding_shadertype (see create_pipeline)
+				str_add(glsl, "layout(std140) uniform _");
+				str_add_ui(glsl, set);
+				str_add(glsl, "_");
+				str_add_ui(glsl, binding);
+				str_add(glsl, "_");
+				str_add_ui(glsl, shader_type);
+				str_add(glsl, " {\n");
+			}
 			opcode += 6;
 		} else if(*opcode == 0x08) {	// block/function/conditional/loop closer
 			if(scope_type == 1 && scope_level < 2) return 1;	// in main function + not in loop/conditional
 			if(scope_type == 2 && scope_level < 2) {	// in function + not in loop/conditional; closing a function
 				scope_type = 0;
-				// remove n_local_defs definitions from the back of definitions array
-				if(n_defs-n_local_defs > 0) { defs = realloc(defs, (n_defs-n_local_defs)*sizeof(definition_t)); }
-				else {
-					if(n_defs) free(defs);
-					defs = 0; n_defs = 0;
-				}
-				n_local_defs = 0;
+				def_scope_pop(table);	// remove the function's local variables
 			}
 			if((scope_type == 1 || scope_type == 2) && scope_level >= 2) {	// if in function + present in loop/conditional
 				if(level_status[scope_level-1] == 1) // this level is in conditional, unset allow_if_extension if elif or else opcode does not follow
@@ -1169,10 +1553,12 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				level_iterations[scope_level-1] = 0;
 				scope_level--;	// go back down a level
 			}
-			if(scope_type != 3 && scope_type != 4) { // the VM currently unravels uniform/push blocks; so no need to add } to the GLSL if closing a uniform/push block
-				str_add(&glsl_shader->src, "}");
-				if(scope_type >= 3 && scope_type <= 6) str_add(&glsl_shader->src, ";\n");	// close block
-				else str_add(&glsl_shader->src, "\n");
+			if(scope_type == 3 && shader_data->set_binding_types[shader_data->n_set_binding_pairs-1] == 0)
+				str_add(glsl, "};\n");	// close GL uniform block
+			else if(scope_type != 3 && scope_type != 4) { // the VM unravels push blocks and sampler/image/AS blocks; so no need to add } to the GLSL if closing one
+				str_add(glsl, "}");
+				if(scope_type >= 3 && scope_type <= 6) str_add(glsl, ";\n");	// close block
+				else str_add(glsl, "\n");
 			}
 			if(scope_type >= 3 && scope_type <= 7) { scope_type = 0; scope_level = 0; }
 			opcode++;
@@ -1192,6 +1578,13 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(check_set_binding_existence(shader_data,set,binding)) return 1;
 			add_set_binding(shader_data,set,binding,1);
 			scope_type = 5;
+			str_add(glsl, "layout(std430) buffer _");	// storage variables are placed in a std430 GL shader storage block named _set_binding_shadertype (see create_pipeline)
+			str_add_ui(glsl, set);
+			str_add(glsl, "_");
+			str_add_ui(glsl, binding);
+			str_add(glsl, "_");
+			str_add_ui(glsl, shader_type);
+			str_add(glsl, " {\n");
 			opcode += 6;
 		} else if(*opcode == 0x0B || *opcode == 0x0C) {	// ray payload or incoming ray payload opener
 			if(scope_type != 0) return 1;	// can only open ray payload block in global scope
@@ -1209,15 +1602,15 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			uint8_t* p = opcode + 3;	// pointer to first parameter in list or function opener
 			uint16_t id = READ(opcode+1,2);
 			CHECK_ID_DEFINED(id);
-			add_definition(&defs, &n_defs, id, FUNC_DEF_BIT, 0, 0, 0, 0, 0, 0, calloc(1,sizeof(func_def_t)));
-			func_def_t* func_def = check_identifier_existence(id,defs,n_defs,FUNC_DEF_BIT)->func_def;
+			add_definition(table, id, FUNC_DEF_BIT, 0, 0, 0, 0, 0, 0, calloc(1,sizeof(func_def_t)));
+			func_def_t* func_def = check_identifier_existence(id,table,FUNC_DEF_BIT)->func_def;
 			func_def->param_ids = 0;
 			func_def->param_elcounts = 0;
 			func_def->param_types = 0;
 			func_def->n_params = 0;
-			str_add(&glsl_shader->src, "void _");
-			str_add_ui(&glsl_shader->src, id);
-			str_add(&glsl_shader->src, "(");
+			str_add(glsl, "void _");
+			str_add_ui(glsl, id);
+			str_add(glsl, "(");
 			// store all information on parameters; parameter definitions shouldn't do anything except ensure they're a part of a function definition
 			while(1) {
 				if(READ(p,1) < 0x0E || READ(p,1) > 0x11) return 1;	// neither a parameter or function opener
@@ -1236,35 +1629,36 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 					func_def->param_ids[func_def->n_params] = param_id;
 					func_def->param_elcounts[func_def->n_params] = param_elcount;
 					func_def->param_types[func_def->n_params] = param_type;
-					if(func_def->n_params > 0) str_add(&glsl_shader->src, ", ");
+					if(func_def->n_params > 0) str_add(glsl, ", ");
 					func_def->n_params++;
 					switch(READ(p,1)) {
-						case 0x0F: str_add(&glsl_shader->src, "in "); break;
-						case 0x10: str_add(&glsl_shader->src, "out "); break;
-						case 0x11: str_add(&glsl_shader->src, "inout "); break;
+						case 0x0F: str_add(glsl, "in "); break;
+						case 0x10: str_add(glsl, "out "); break;
+						case 0x11: str_add(glsl, "inout "); break;
 					}
-					str_add_type(&glsl_shader->src, param_type);
-					str_add(&glsl_shader->src, " _");
-					str_add_ui(&glsl_shader->src, param_id);
-					str_add(&glsl_shader->src, "[");
-					str_add_ui(&glsl_shader->src, param_elcount);
-					str_add(&glsl_shader->src, "]");
+					str_add_type(glsl, param_type);
+					str_add(glsl, " _");
+					str_add_ui(glsl, param_id);
+					str_add(glsl, "[");
+					str_add_ui(glsl, param_elcount);
+					str_add(glsl, "]");
 					p += 6;
 				}
 			}
-			str_add(&glsl_shader->src, ") ");
+			str_add(glsl, ") ");
 			scope_type = 8;
 			opcode += p-opcode;
 		} else if(*opcode == 0x0E) {	// function/conditional/loop opener
 			if(scope_type == 8) {	// function opener if part of function definition
 				scope_type = 2;
 				scope_level = 1;
+				def_scope_push(table);
 				opcode++;
 			}
 			else if(level_status[scope_level-1])	// loop or conditional opener if this level's conditional status is non-zero
 				opcode++;
 			else return 1;
-			str_add(&glsl_shader->src, "{\n");
+			str_add(glsl, "{\n");
 		} else if(*opcode >= 0x0F && *opcode <= 0x11) {	// parameter definition
 			if(scope_type != 8) return 1;	// not part of func definition
 			opcode += 6;
@@ -1272,74 +1666,93 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(scope_type != 1)	return 1;	// a function call can only be present in the main function
 			uint16_t func_id = READ(opcode+1,2);
 			definition_t* def_ptr;
-			if((def_ptr = check_identifier_existence(func_id,defs,n_defs,FUNC_DEF_BIT)) == 0) return 1;	// function does not exist
+			if((def_ptr = check_identifier_existence(func_id,table,FUNC_DEF_BIT)) == 0) return 1;	// function does not exist
 			func_def_t* f = def_ptr->func_def;
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, func_id);
-			str_add(&glsl_shader->src, "(");
+			str_add(glsl, "_");
+			str_add_ui(glsl, func_id);
+			str_add(glsl, "(");
 			// ensure that all arguments (variables) required are present and compatible with the parameters
 			uint32_t p = 0;
 			def_ptr = 0;
 			for(p = 0; p < f->n_params; p++) {
 				if(opcode+3+p*2 > end) return 1;
-				def_ptr = check_identifier_existence(READ(opcode+3+p*2,2),defs,n_defs,VAR_DEF_BIT);
+				def_ptr = check_identifier_existence(READ(opcode+3+p*2,2),table,VAR_DEF_BIT);
 				if(!def_ptr) return 1;
 				else if(f->param_elcounts[p] != def_ptr->elcount || f->param_types[p] != def_ptr->data_type) return 1;
-				if(p > 0) str_add(&glsl_shader->src, ", ");
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, def_ptr->id);
+				if(p > 0) str_add(glsl, ", ");
+				str_add(glsl, "_");
+				str_add_ui(glsl, def_ptr->id);
 			}
-			str_add(&glsl_shader->src, ");\n");
+			str_add(glsl, ");\n");
 			opcode += 3+p*2;
 		} else if(*opcode == 0x13) {	// return from function
 			if(scope_type != 1 && scope_type != 2) return 1;	// must only be present within a function
-			str_add(&glsl_shader->src, "return;\n");
+			str_add(glsl, "return;\n");
+			opcode++;
+		} else if(*opcode == 0x71) {	// barrier
+			if(shader_type != 2) return 1;	// barriers can only be present in compute shaders
+			if(scope_type != 1 || scope_level != 1) return 1;	// can only be on level 1 of the main function
+			str_add(glsl, "memoryBarrier();\nbarrier();\n");	// writes before the barrier are visible to the whole work-group after it
 			opcode++;
+		} else if(*opcode == 0x72) {	// get compute invocation info
+			if(shader_type != 2) return 1;	// this can only be present in compute shaders
+			if(scope_type != 1 && scope_type != 2) return 1;	// must be in a function
+			uint8_t info = READ(opcode+1,1);
+			if(info > 2) return 1;
+			opcode += 2;
+			READ_DEST_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT);
+			if(type != 7) return 1;	// must be uvec3
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
+			ADD_IDX();
+			if(info == 0) str_add(glsl, " = gl_NumWorkGroups;\n");
+			else if(info == 1) str_add(glsl, " = gl_WorkGroupID;\n");
+			else str_add(glsl, " = gl_LocalInvocationID;\n");
 		} else if(*opcode == 0x73) {
 			if(scope_type != 1 && scope_type != 2) return 1;        // must only be present within a function
 			if(shader_type != 1) return 1;  // discard can only be present within pixel shaders
-			str_add(&glsl_shader->src, "discard;\n");
+			str_add(glsl, "discard;\n");
 			opcode++;
 		} else if(*opcode == 0x14) {	// open the main function
 			if(scope_type != 0) return 1;	// must only be present within global scope
 			scope_type = 1;
 			scope_level = 1;
-			str_add(&glsl_shader->src, "void main() {\n");
-			entry_point = strlen(glsl_shader->src);
+			str_add(glsl, "void main() {\n");
+			entry_point = glsl->len;	// insertion point for the gl_FragDepth write
 			opcode++;
 		} else if(*opcode >= 0x15 && *opcode <= 0x27) {	// vector operations
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			if(type >= 9) return 1;	// not one of the vector types
 			if(op_byte == 0x15 && type >= 6) return 1;	// can't use with uvec*
 			if(op_byte == 0x16 && type >= 6) return 1;	// can't use with uvec*
 			if(op_byte >= 0x17 && type >= 3) return 1;	// can't use with uvec*, ivec*
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, " = ");
+			str_add(glsl, " = ");
 			switch(op_byte) {
-				case 0x15: str_add(&glsl_shader->src, "-");			 break; case 0x16: str_add(&glsl_shader->src, "abs(");	break;
-				case 0x17: str_add(&glsl_shader->src, "normalize("); break; case 0x18: str_add(&glsl_shader->src, "floor(");break;
-				case 0x19: str_add(&glsl_shader->src, "ceil(");		 break;	case 0x1A: str_add(&glsl_shader->src, "tan(");	break;
-				case 0x1B: str_add(&glsl_shader->src, "sin(");	 	 break;	case 0x1C: str_add(&glsl_shader->src, "cos(");	break;
-				case 0x1D: str_add(&glsl_shader->src, "atan(");  	 break;	case 0x1E: str_add(&glsl_shader->src, "asin("); break;
-				case 0x1F: str_add(&glsl_shader->src, "acos(");  	 break;	case 0x20: str_add(&glsl_shader->src, "tanh("); break;
-				case 0x21: str_add(&glsl_shader->src, "sinh(");  	 break;	case 0x22: str_add(&glsl_shader->src, "cosh("); break;
-				case 0x23: str_add(&glsl_shader->src, "atanh("); 	 break;	case 0x24: str_add(&glsl_shader->src, "asinh(");break;
-				case 0x25: str_add(&glsl_shader->src, "acosh("); 	 break;	case 0x26: str_add(&glsl_shader->src, "log(");	break;
-				case 0x27: str_add(&glsl_shader->src, "log2(");  	 break;
+				case 0x15: str_add(glsl, "-");			 break; case 0x16: str_add(glsl, "abs(");	break;
+				case 0x17: str_add(glsl, "normalize("); break; case 0x18: str_add(glsl, "floor(");break;
+				case 0x19: str_add(glsl, "ceil(");		 break;	case 0x1A: str_add(glsl, "tan(");	break;
+				case 0x1B: str_add(glsl, "sin(");	 	 break;	case 0x1C: str_add(glsl, "cos(");	break;
+				case 0x1D: str_add(glsl, "atan(");  	 break;	case 0x1E: str_add(glsl, "asin("); break;
+				case 0x1F: str_add(glsl, "acos(");  	 break;	case 0x20: str_add(glsl, "tanh("); break;
+				case 0x21: str_add(glsl, "sinh(");  	 break;	case 0x22: str_add(glsl, "cosh("); break;
+				case 0x23: str_add(glsl, "atanh("); 	 break;	case 0x24: str_add(glsl, "asinh(");break;
+				case 0x25: str_add(glsl, "acosh("); 	 break;	case 0x26: str_add(glsl, "log(");	break;
+				case 0x27: str_add(glsl, "log2(");  	 break;
 			}
-			str_add(&glsl_shader->src, "_"); 
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_"); 
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			if(op_byte > 0x15) str_add(&glsl_shader->src, ")");
-			str_add(&glsl_shader->src, ";\n");
+			if(op_byte > 0x15) str_add(glsl, ")");
+			str_add(glsl, ";\n");
 		} else if(*opcode >= 0x28 && *opcode <= 0x2A) {	// matrix operations
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID(2,FUNC_DEF_BIT);
 			if(type1 < 9 || type1 > 18 || type2 < 9 || type2 > 17) return 1; // make sure the types of input+ouput are not invalid
 			switch(op_byte) {
@@ -1347,23 +1760,23 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				case 0x29: if(type1 != 18) return 1; break; // determinant; output must be float
 				case 0x2A: if(type1 == 18 || MAT_WIDTH(type1) != MAT_HEIGHT(type2) || MAT_HEIGHT(type1) != MAT_WIDTH(type2)) return 1; break; // transpose
 			}
-			str_add(&glsl_shader->src, "_"); 
-			str_add_ui(&glsl_shader->src, id1);
+			str_add(glsl, "_"); 
+			str_add_ui(glsl, id1);
 			ADD_IDX(1);
-			str_add(&glsl_shader->src, " = ");
+			str_add(glsl, " = ");
 			switch(op_byte) {
-				case 0x28: str_add(&glsl_shader->src, "inverse("); break;
-				case 0x29: str_add(&glsl_shader->src, "determinant("); break;
-				case 0x2A: str_add(&glsl_shader->src, "transpose("); break;
+				case 0x28: str_add(glsl, "inverse("); break;
+				case 0x29: str_add(glsl, "determinant("); break;
+				case 0x2A: str_add(glsl, "transpose("); break;
 			}
-			str_add(&glsl_shader->src, "_"); 
-			str_add_ui(&glsl_shader->src, id2);
+			str_add(glsl, "_"); 
+			str_add_ui(glsl, id2);
 			ADD_IDX(2);
-			str_add(&glsl_shader->src, ");\n"); 
+			str_add(glsl, ");\n"); 
 		} else if(*opcode >= 0x2B && *opcode <= 0x2F) {	// id1 = id2 op id3
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID_WITH_MATVEC_ELEMENT(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID_WITH_MATVEC_ELEMENT(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID_WITH_MATVEC_ELEMENT(2,FUNC_DEF_BIT);
 			READ_ID_WITH_MATVEC_ELEMENT(3,FUNC_DEF_BIT);
 			if(type2 > 20 || type3 > 20) return 1;
@@ -1383,53 +1796,53 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(!(type2 < 9 && matvec_idx2 >= VEC_SIZE(type2)) && type1 < 9 && matvec_idx1 >= VEC_SIZE(type1)) {	// left operand not full vec but output is	
 				// vec = scalar op scalar is not legal in GLSL, so add a result = scalar op scalar line BEFORE assigning anything to the vector
 				uint8_t result_type = base_type(type1);
-				if(result_type == 0) str_add(&glsl_shader->src, "uint ");
-				if(result_type == 1) str_add(&glsl_shader->src, "int ");
-				if(result_type  > 1) str_add(&glsl_shader->src, "float ");
-				str_add(&glsl_shader->src, "result");
-				str_add_ui(&glsl_shader->src, n_result_scalars);
-				str_add(&glsl_shader->src, " = ");
-				if(result_type == 0) str_add(&glsl_shader->src, "uint(");
-				if(result_type == 1) str_add(&glsl_shader->src, "int(");
-				if(result_type  > 1) str_add(&glsl_shader->src, "float(");
+				if(result_type == 0) str_add(glsl, "uint ");
+				if(result_type == 1) str_add(glsl, "int ");
+				if(result_type  > 1) str_add(glsl, "float ");
+				str_add(glsl, "result");
+				str_add_ui(glsl, n_result_scalars);
+				str_add(glsl, " = ");
+				if(result_type == 0) str_add(glsl, "uint(");
+				if(result_type == 1) str_add(glsl, "int(");
+				if(result_type  > 1) str_add(glsl, "float(");
 				// below, insert operations on the scalars into the result# = type(...)
 				if(op_byte == 0x2F) {
-					str_add(&glsl_shader->src, "pow(");
+					str_add(glsl, "pow(");
 					types = 2; // the scalars passed as argument to GLSL's pow() must be cast to float
 				}
-				str_add_typecast(&glsl_shader->src, 0, 0, types);
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id2);
+				str_add_typecast(glsl, 0, 0, types);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id2);
 				ADD_IDX(2);
-				if(type2 < 9) str_add_vec_idx(&glsl_shader->src, matvec_idx2);	// left operand vector element
-				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
-				str_add(&glsl_shader->src, ")");
-				str_add_operation(&glsl_shader->src, op_byte-0x2B);
-				str_add_typecast(&glsl_shader->src, 0, 0, types);
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id3);
+				if(type2 < 9) str_add_vec_idx(glsl, matvec_idx2);	// left operand vector element
+				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
+				str_add(glsl, ")");
+				str_add_operation(glsl, op_byte-0x2B);
+				str_add_typecast(glsl, 0, 0, types);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id3);
 				ADD_IDX(3);
-				if(type3 < 9) str_add_vec_idx(&glsl_shader->src, matvec_idx3);	// right operand vector element
-				if(type3 >= 9 && type3 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type3), MAT_HEIGHT(type3), matvec_idx3); // right operand matrix element
-				if(op_byte == 0x2F) str_add(&glsl_shader->src, ")");
-				str_add(&glsl_shader->src, "));\n");
+				if(type3 < 9) str_add_vec_idx(glsl, matvec_idx3);	// right operand vector element
+				if(type3 >= 9 && type3 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type3), MAT_HEIGHT(type3), matvec_idx3); // right operand matrix element
+				if(op_byte == 0x2F) str_add(glsl, ")");
+				str_add(glsl, "));\n");
 			}		
 			if(!(type2 < 9 && matvec_idx2 >= VEC_SIZE(type2)) && type1 < 9 && matvec_idx1 >= VEC_SIZE(type1)) {	// left operand not full vec but output is
 				// vec = scalar op scalar is not legal in GLSL, so add vec = vec(result,result,...) (result has been defined on the line prior to the current)
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id1);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id1);
 				ADD_IDX(1);
-				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(&glsl_shader->src, matvec_idx1);	// output to specific vector element
-				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
-				str_add(&glsl_shader->src, " = ");
-				str_add_type(&glsl_shader->src, type1);
-				str_add(&glsl_shader->src, "(");
+				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(glsl, matvec_idx1);	// output to specific vector element
+				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
+				str_add(glsl, " = ");
+				str_add_type(glsl, type1);
+				str_add(glsl, "(");
 				for(uint32_t i = 0; i < VEC_SIZE(type1); i++) {
-					str_add(&glsl_shader->src, "result");
-					str_add_ui(&glsl_shader->src, n_result_scalars);
-					if(i != VEC_SIZE(type1)-1) str_add(&glsl_shader->src, ", ");
+					str_add(glsl, "result");
+					str_add_ui(glsl, n_result_scalars);
+					if(i != VEC_SIZE(type1)-1) str_add(glsl, ", ");
 				}
-				str_add(&glsl_shader->src, ");\n");
+				str_add(glsl, ");\n");
 				n_result_scalars++;
 				continue;
 			}
@@ -1444,40 +1857,40 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				loop_count = VEC_SIZE(type1);
 			}
 			for(uint32_t i = 0; i < loop_count; i++) {
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id1);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id1);
 				ADD_IDX(1);
-				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(&glsl_shader->src, matvec_idx1);	// output to specific vector element
-				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
-				str_add(&glsl_shader->src, " = ");
-				str_add_typecast(&glsl_shader->src, type1<9 && matvec_idx1 >= VEC_SIZE(type1), VEC_SIZE(type1), base_type(type1));
+				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(glsl, matvec_idx1);	// output to specific vector element
+				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
+				str_add(glsl, " = ");
+				str_add_typecast(glsl, type1<9 && matvec_idx1 >= VEC_SIZE(type1), VEC_SIZE(type1), base_type(type1));
 				if(op_byte == 0x2F) {
-					str_add(&glsl_shader->src, "pow(");
+					str_add(glsl, "pow(");
 					types = 2; // the 2 vectors passed as argument to GLSL's pow() must be cast to float vectors (pow(vector,scalar) was translated above)
 				}
-				str_add_typecast(&glsl_shader->src, type2<9 && matvec_idx2 >= VEC_SIZE(type2), VEC_SIZE(type2), types);
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id2);
+				str_add_typecast(glsl, type2<9 && matvec_idx2 >= VEC_SIZE(type2), VEC_SIZE(type2), types);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id2);
 				ADD_IDX(2);
-				if(type2 < 9 && matvec_idx2 < VEC_SIZE(type2)) str_add_vec_idx(&glsl_shader->src, matvec_idx2);	// left operand vector element
-				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
-				str_add(&glsl_shader->src, ")");
-				str_add_operation(&glsl_shader->src, op_byte-0x2B);
-				str_add_typecast(&glsl_shader->src, type3<9 && matvec_idx3 >= VEC_SIZE(type3), VEC_SIZE(type3), types);
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id3);
+				if(type2 < 9 && matvec_idx2 < VEC_SIZE(type2)) str_add_vec_idx(glsl, matvec_idx2);	// left operand vector element
+				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
+				str_add(glsl, ")");
+				str_add_operation(glsl, op_byte-0x2B);
+				str_add_typecast(glsl, type3<9 && matvec_idx3 >= VEC_SIZE(type3), VEC_SIZE(type3), types);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id3);
 				ADD_IDX(3);
-				if(type3 < 9 && matvec_idx3 < VEC_SIZE(type3)) str_add_vec_idx(&glsl_shader->src, matvec_idx3);	// right operand vector element
-				if(type3 >= 9 && type3 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type3), MAT_HEIGHT(type3), matvec_idx3); // right operand matrix element
-				str_add(&glsl_shader->src, "))");
-				if(op_byte == 0x2F) str_add(&glsl_shader->src, ")");
-				str_add(&glsl_shader->src, ";\n");
+				if(type3 < 9 && matvec_idx3 < VEC_SIZE(type3)) str_add_vec_idx(glsl, matvec_idx3);	// right operand vector element
+				if(type3 >= 9 && type3 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type3), MAT_HEIGHT(type3), matvec_idx3); // right operand matrix element
+				str_add(glsl, "))");
+				if(op_byte == 0x2F) str_add(glsl, ")");
+				str_add(glsl, ";\n");
 				if(loop_count > 1) matvec_idx1++, matvec_idx2++;
 			}
 		} else if(*opcode >= 0x30 && *opcode <= 0x39) { // id1 = id2 op constant
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID_WITH_MATVEC_ELEMENT(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID_WITH_MATVEC_ELEMENT(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID_WITH_MATVEC_ELEMENT(2,FUNC_DEF_BIT);
 			uint32_t constant = READ(opcode,4);
 			opcode += 4;
@@ -1496,58 +1909,54 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(!(type2 < 9 && matvec_idx2 >= VEC_SIZE(type2)) && type1 < 9 && matvec_idx1 >= VEC_SIZE(type1)) {	// left operand not full vec but output is	
 				// vec = scalar op scalar is not legal in GLSL, so add a result = scalar op scalar line BEFORE assigning anything to the vector
 				uint8_t result_type = base_type(type1);
-				if(result_type == 0) str_add(&glsl_shader->src, "uint ");
-				if(result_type == 1) str_add(&glsl_shader->src, "int ");
-				if(result_type  > 1) str_add(&glsl_shader->src, "float ");
-				str_add(&glsl_shader->src, "result");
-				str_add_ui(&glsl_shader->src, n_result_scalars);
-				str_add(&glsl_shader->src, " = ");
-				if(result_type == 0) str_add(&glsl_shader->src, "uint(");
-				if(result_type == 1) str_add(&glsl_shader->src, "int(");
-				if(result_type  > 1) str_add(&glsl_shader->src, "float(");
+				if(result_type == 0) str_add(glsl, "uint ");
+				if(result_type == 1) str_add(glsl, "int ");
+				if(result_type  > 1) str_add(glsl, "float ");
+				str_add(glsl, "result");
+				str_add_ui(glsl, n_result_scalars);
+				str_add(glsl, " = ");
+				if(result_type == 0) str_add(glsl, "uint(");
+				if(result_type == 1) str_add(glsl, "int(");
+				if(result_type  > 1) str_add(glsl, "float(");
 				// below, insert operations on the scalars into the result# = type(...)
 				if(op_byte == 0x34 || op_byte == 0x39) {
-					str_add(&glsl_shader->src, "pow(");
+					str_add(glsl, "pow(");
 					types = 2; // the scalars passed as argument to GLSL's pow() must be cast to float
 				}
 				if(op_byte >= 0x35) {
-					str_add_typecast(&glsl_shader->src, 0, 0, types);
-					str_add_constant(&glsl_shader->src, constant, base_type(type2));
-					str_add(&glsl_shader->src, ")");
-					str_add_operation(&glsl_shader->src, op_byte-0x35);
+					str_add_constant_cast(glsl, constant, base_type(type2), types);
+					str_add_operation(glsl, op_byte-0x35);
 				}
-				str_add_typecast(&glsl_shader->src, 0, 0, types);
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id2);
+				str_add_typecast(glsl, 0, 0, types);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id2);
 				ADD_IDX(2);
-				if(type2 < 9) str_add_vec_idx(&glsl_shader->src, matvec_idx2);	// left operand vector element
-				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
-				str_add(&glsl_shader->src, ")");
+				if(type2 < 9) str_add_vec_idx(glsl, matvec_idx2);	// left operand vector element
+				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
+				str_add(glsl, ")");
 				if(op_byte <= 0x34) {
-					str_add_operation(&glsl_shader->src, op_byte-0x30);
-					str_add_typecast(&glsl_shader->src, 0, 0, types);
-					str_add_constant(&glsl_shader->src, constant, base_type(type2));
-					str_add(&glsl_shader->src, ")");
+					str_add_operation(glsl, op_byte-0x30);
+					str_add_constant_cast(glsl, constant, base_type(type2), types);
 				}
-				if(op_byte == 0x34 || op_byte == 0x39) str_add(&glsl_shader->src, ")");
-				str_add(&glsl_shader->src, ");\n");
+				if(op_byte == 0x34 || op_byte == 0x39) str_add(glsl, ")");
+				str_add(glsl, ");\n");
 			}		
 			if(!(type2 < 9 && matvec_idx2 >= VEC_SIZE(type2)) && type1 < 9 && matvec_idx1 >= VEC_SIZE(type1)) {	// left operand not full vec but output is
 				// vec = scalar op scalar is not legal in GLSL, so add vec = vec(result,result,...) (result has been defined on the line prior to the current)
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id1);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id1);
 				ADD_IDX(1);
-				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(&glsl_shader->src, matvec_idx1);	// output to specific vector element
-				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
-				str_add(&glsl_shader->src, " = ");
-				str_add_type(&glsl_shader->src, type1);
-				str_add(&glsl_shader->src, "(");
+				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(glsl, matvec_idx1);	// output to specific vector element
+				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
+				str_add(glsl, " = ");
+				str_add_type(glsl, type1);
+				str_add(glsl, "(");
 				for(uint32_t i = 0; i < VEC_SIZE(type1); i++) {
-					str_add(&glsl_shader->src, "result");
-					str_add_ui(&glsl_shader->src, n_result_scalars);
-					if(i != VEC_SIZE(type1)-1) str_add(&glsl_shader->src, ", ");
+					str_add(glsl, "result");
+					str_add_ui(glsl, n_result_scalars);
+					if(i != VEC_SIZE(type1)-1) str_add(glsl, ", ");
 				}
-				str_add(&glsl_shader->src, ");\n");
+				str_add(glsl, ");\n");
 				n_result_scalars++;
 				continue;
 			}
@@ -1561,79 +1970,75 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				loop_count = VEC_SIZE(type1);
 			}
 			for(uint32_t i = 0; i < loop_count; i++) {
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id1);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id1);
 				ADD_IDX(1);
-				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(&glsl_shader->src, matvec_idx1);	// output to specific vector element
-				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
-				str_add(&glsl_shader->src, " = ");
+				if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(glsl, matvec_idx1);	// output to specific vector element
+				if(type1 >= 9 && type1 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
+				str_add(glsl, " = ");
 					
-				str_add_typecast(&glsl_shader->src, type1<9 && matvec_idx1 >= VEC_SIZE(type1), VEC_SIZE(type1), base_type(type1));
+				str_add_typecast(glsl, type1<9 && matvec_idx1 >= VEC_SIZE(type1), VEC_SIZE(type1), base_type(type1));
 				if(op_byte == 0x34 || op_byte == 0x39) {
-					str_add(&glsl_shader->src, "pow(");
+					str_add(glsl, "pow(");
 					types = 2; // the 2 vectors passed as argument to GLSL's pow() must be cast to float vectors (pow(vector,scalar) was translated above)
 				}
 				if(op_byte >= 0x35) {
-					str_add_typecast(&glsl_shader->src, 0, 0, types);
-					str_add_constant(&glsl_shader->src, constant, base_type(type2));
-					str_add(&glsl_shader->src, ")");
-					str_add_operation(&glsl_shader->src, op_byte-0x35);
+					str_add_constant_cast(glsl, constant, base_type(type2), types);
+					str_add_operation(glsl, op_byte-0x35);
 				}
-				str_add_typecast(&glsl_shader->src, type2<9 && matvec_idx2 >= VEC_SIZE(type2), VEC_SIZE(type2), types);
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id2);
+				str_add_typecast(glsl, type2<9 && matvec_idx2 >= VEC_SIZE(type2), VEC_SIZE(type2), types);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id2);
 				ADD_IDX(2);
-				if(type2 < 9 && matvec_idx2 < VEC_SIZE(type2)) str_add_vec_idx(&glsl_shader->src, matvec_idx2);	// left operand vector element
-				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
-				str_add(&glsl_shader->src, ")");
+				if(type2 < 9 && matvec_idx2 < VEC_SIZE(type2)) str_add_vec_idx(glsl, matvec_idx2);	// left operand vector element
+				if(type2 >= 9 && type2 <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // left operand matrix element
+				str_add(glsl, ")");
 				if(op_byte <= 0x34) {
-					str_add_operation(&glsl_shader->src, op_byte-0x30);
-					str_add_typecast(&glsl_shader->src, 0, 0, types);
-					str_add_constant(&glsl_shader->src, constant, base_type(type2));
-					str_add(&glsl_shader->src, ")");
+					str_add_operation(glsl, op_byte-0x30);
+					str_add_constant_cast(glsl, constant, base_type(type2), types);
 				}
-				if(op_byte == 0x34 || op_byte == 0x39) str_add(&glsl_shader->src, ")");
-				str_add(&glsl_shader->src, ");\n");
+				if(op_byte == 0x34 || op_byte == 0x39) str_add(glsl, ")");
+				str_add(glsl, ");\n");
 				if(loop_count > 1) matvec_idx1++, matvec_idx2++;
 			}
 		} else if(*opcode >= 0x3A && *opcode <= 0x4C) { // scalar operations
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID_WITH_MATVEC_ELEMENT(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID_WITH_MATVEC_ELEMENT(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			if(type < 9 && matvec_idx > VEC_SIZE(type)-1) return 1; // vector, but vector element does not exist
 			if(type >= 9 && type <= 17 && matvec_idx > MAT_SIZE(type)-1) return 1; // matrix, but matrix element does not exist
 			if(base_type(type) == 0) return 1; // there are no scalar operations for unsigned int scalars
 			if(base_type(type) != 2 && op_byte > 0x3B) return 1; // scalar operations w/ opcode > 0x3B can only be performed on float scalars 
 
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			if(type < 9) str_add_vec_idx(&glsl_shader->src, matvec_idx);	// vector element
-			if(type >= 9 && type <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type), MAT_HEIGHT(type), matvec_idx); // matrix element
-			str_add(&glsl_shader->src, " = ");
+			if(type < 9) str_add_vec_idx(glsl, matvec_idx);	// vector element
+			if(type >= 9 && type <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type), MAT_HEIGHT(type), matvec_idx); // matrix element
+			str_add(glsl, " = ");
 			switch(op_byte) {
-				case 0x3A: str_add(&glsl_shader->src, "-");			break; case 0x3B: str_add(&glsl_shader->src, "abs(");	break;
-				case 0x3C: str_add(&glsl_shader->src, "1./"); 		break; case 0x3D: str_add(&glsl_shader->src, "floor(");	break;
-				case 0x3E: str_add(&glsl_shader->src, "ceil(");		break; case 0x3F: str_add(&glsl_shader->src, "tan(");	break;
-				case 0x40: str_add(&glsl_shader->src, "sin(");	 	break; case 0x41: str_add(&glsl_shader->src, "cos(");	break;
-				case 0x42: str_add(&glsl_shader->src, "atan(");  	break; case 0x43: str_add(&glsl_shader->src, "asin(");	break;
-				case 0x44: str_add(&glsl_shader->src, "acos(");  	break; case 0x45: str_add(&glsl_shader->src, "tanh(");	break;
-				case 0x46: str_add(&glsl_shader->src, "sinh(");  	break; case 0x47: str_add(&glsl_shader->src, "cosh(");	break;
-				case 0x48: str_add(&glsl_shader->src, "atanh("); 	break; case 0x49: str_add(&glsl_shader->src, "asinh(");	break;
-				case 0x4A: str_add(&glsl_shader->src, "acosh("); 	break; case 0x4B: str_add(&glsl_shader->src, "log(");	break;
-				case 0x4C: str_add(&glsl_shader->src, "log2(");  	break;
+				case 0x3A: str_add(glsl, "-");			break; case 0x3B: str_add(glsl, "abs(");	break;
+				case 0x3C: str_add(glsl, "1./"); 		break; case 0x3D: str_add(glsl, "floor(");	break;
+				case 0x3E: str_add(glsl, "ceil(");		break; case 0x3F: str_add(glsl, "tan(");	break;
+				case 0x40: str_add(glsl, "sin(");	 	break; case 0x41: str_add(glsl, "cos(");	break;
+				case 0x42: str_add(glsl, "atan(");  	break; case 0x43: str_add(glsl, "asin(");	break;
+				case 0x44: str_add(glsl, "acos(");  	break; case 0x45: str_add(glsl, "tanh(");	break;
+				case 0x46: str_add(glsl, "sinh(");  	break; case 0x47: str_add(glsl, "cosh(");	break;
+				case 0x48: str_add(glsl, "atanh("); 	break; case 0x49: str_add(glsl, "asinh(");	break;
+				case 0x4A: str_add(glsl, "acosh("); 	break; case 0x4B: str_add(glsl, "log(");	break;
+				case 0x4C: str_add(glsl, "log2(");  	break;
 			}
-			str_add(&glsl_shader->src, "_"); 
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_"); 
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			if(type < 9) str_add_vec_idx(&glsl_shader->src, matvec_idx);	// vector element
-			if(type >= 9 && type <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type), MAT_HEIGHT(type), matvec_idx); // matrix element
-			if(op_byte != 0x3A && op_byte != 0x3C) str_add(&glsl_shader->src, ")");
-			str_add(&glsl_shader->src, ";\n");
+			if(type < 9) str_add_vec_idx(glsl, matvec_idx);	// vector element
+			if(type >= 9 && type <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type), MAT_HEIGHT(type), matvec_idx); // matrix element
+			if(op_byte != 0x3A && op_byte != 0x3C) str_add(glsl, ")");
+			str_add(glsl, ";\n");
 		} else if(*opcode == 0x4D || *opcode == 0x4E) { // vector-vector operations
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID(2,FUNC_DEF_BIT);
 			READ_ID(3,FUNC_DEF_BIT);
 			// vector-vector cross must all be 3 component float vectors; dot can be float vectors, with output of type float (scalar)
@@ -1643,46 +2048,46 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				if(type1 != 18 || type2 > 2 || type3 > 2) return 1; // output not float or any operands not a float vector
 				if(type2 != type3) return 1; // operands are vectors of different sizes
 			}
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id1);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id1);
 			ADD_IDX(1);
-			str_add(&glsl_shader->src, " = ");
+			str_add(glsl, " = ");
 			switch(op_byte) {
-				case 0x4D: str_add(&glsl_shader->src, "dot("); break;
-				case 0x4E: str_add(&glsl_shader->src, "cross("); break;
+				case 0x4D: str_add(glsl, "dot("); break;
+				case 0x4E: str_add(glsl, "cross("); break;
 			}
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id2);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id2);
 			ADD_IDX(2);
-			str_add(&glsl_shader->src, ", _");
-			str_add_ui(&glsl_shader->src, id3);
+			str_add(glsl, ", _");
+			str_add_ui(glsl, id3);
 			ADD_IDX(3);
-			str_add(&glsl_shader->src, ");\n");
+			str_add(glsl, ");\n");
 		} else if(*opcode == 0x4F) { // matrix-vector multiplication
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID(2,FUNC_DEF_BIT);
 			READ_ID(3,FUNC_DEF_BIT);
 			// vector-matrix mult. right operand must be float vector with size = height of left operand matrix, and output must be float vector with = size too
 			if(type1 > 2 || type1 != type3) return 1; // output or right operand not float vector/not of same size
 			if(type2 < 9 || type2 > 17) return 1; // left operand not a matrix
 			if(VEC_SIZE(type1) != MAT_HEIGHT(type2)) return 1; // vectors not same size as height of matrix
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id1);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id1);
 			ADD_IDX(1);
-			str_add(&glsl_shader->src, " = ");
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id2);
+			str_add(glsl, " = ");
+			str_add(glsl, "_");
+			str_add_ui(glsl, id2);
 			ADD_IDX(2);
-			str_add(&glsl_shader->src, " * _");
-			str_add_ui(&glsl_shader->src, id3);
+			str_add(glsl, " * _");
+			str_add_ui(glsl, id3);
 			ADD_IDX(3);
-			str_add(&glsl_shader->src, ";\n");
+			str_add(glsl, ";\n");
 		} else if(*opcode == 0x50) { // matrix-matrix multiplication
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID(2,FUNC_DEF_BIT);
 			READ_ID(3,FUNC_DEF_BIT);
 			// matrix-matrix mult. left operand width must be = height of right operand
@@ -1690,64 +2095,64 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(type1 < 9 || type1 > 17 || type2 < 9 || type2 > 17 || type3 < 9 || type3 > 17) return 1;
 			if(MAT_WIDTH(type2) != MAT_HEIGHT(type3)) return 1; // mult. is undefined
 			if(MAT_HEIGHT(type1) != MAT_HEIGHT(type2) || MAT_WIDTH(type1) != MAT_WIDTH(type3)) return 1; // mult. is undefined
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id1);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id1);
 			ADD_IDX(1);
-			str_add(&glsl_shader->src, " = ");
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id2);
+			str_add(glsl, " = ");
+			str_add(glsl, "_");
+			str_add_ui(glsl, id2);
 			ADD_IDX(2);
-			str_add(&glsl_shader->src, " * _");
-			str_add_ui(&glsl_shader->src, id3);
+			str_add(glsl, " * _");
+			str_add_ui(glsl, id3);
 			ADD_IDX(3);
-			str_add(&glsl_shader->src, ";\n");
+			str_add(glsl, ";\n");
 		} else if(*opcode == 0x51) { // vector swizzle
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			uint8_t swizzle_pattern = READ(opcode,1);
 			opcode++;
 			if(type >= 9) return 1; // not a vector type
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, " = ");
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, " = ");
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, ".");
+			str_add(glsl, ".");
 			for(uint32_t i = 0; i < VEC_SIZE(type); i++) {
 				uint8_t component = (swizzle_pattern&(3<<(i*2))) >> (i*2); // 0-3
 				if(component > VEC_SIZE(type)-1) return 1; // component not in vector 
 				switch(component) {
-					case 0: str_add(&glsl_shader->src, "x"); break;
-					case 1: str_add(&glsl_shader->src, "y"); break;
-					case 2: str_add(&glsl_shader->src, "z"); break;
-					case 3: str_add(&glsl_shader->src, "w"); break;
+					case 0: str_add(glsl, "x"); break;
+					case 1: str_add(glsl, "y"); break;
+					case 2: str_add(glsl, "z"); break;
+					case 3: str_add(glsl, "w"); break;
 				}
 			}
-			str_add(&glsl_shader->src, ";\n");
+			str_add(glsl, ";\n");
 		} else if(*opcode == 0x52) { // assignment of constant
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID_WITH_MATVEC_ELEMENT(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID_WITH_MATVEC_ELEMENT(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			uint32_t constant = READ(opcode,4);
 			opcode += 4;
 			if(type >= 9 && type <= 17 && matvec_idx > MAT_SIZE(type)-1) return 1; // matrix element must exist
 			if(type < 9 && matvec_idx > VEC_SIZE(type)-1) return 1; // vector element must exist
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			if(type < 9) str_add_vec_idx(&glsl_shader->src, matvec_idx);	// output to specific vector element
-			if(type >= 9 && type <= 17) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type), MAT_HEIGHT(type), matvec_idx); // output to specific matrix element
-			str_add(&glsl_shader->src, " = ");
-			str_add_constant(&glsl_shader->src, constant, base_type(type));
-			str_add(&glsl_shader->src, ";\n");
+			if(type < 9) str_add_vec_idx(glsl, matvec_idx);	// output to specific vector element
+			if(type >= 9 && type <= 17) str_add_mat_idx(glsl, MAT_WIDTH(type), MAT_HEIGHT(type), matvec_idx); // output to specific matrix element
+			str_add(glsl, " = ");
+			str_add_constant(glsl, constant, base_type(type));
+			str_add(glsl, ";\n");
 		} else if(*opcode == 0x53) { // assignment of an array of constants
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
 			if(READ(opcode+2,2) == 65535) return 1;
-			READ_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|OUT_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only, and out attrib non-array; exclude in search
+			READ_DEST_ID(,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|OUT_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only, and out attrib non-array; exclude in search
 			if(type <= 17) return 1; // cannot be matrix or vector
 			uint16_t start = arr_idx;
 			uint8_t val_count = READ(opcode,1)+1;
@@ -1759,17 +2164,17 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 				opcode += 4;
 			}
 			for(uint32_t i = 0; i < val_count; i++) {
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id);
 				ADD_IDX();
-				str_add(&glsl_shader->src, " = ");
-				str_add_constant(&glsl_shader->src, values[i], base_type(type));
-				str_add(&glsl_shader->src, ";\n");
+				str_add(glsl, " = ");
+				str_add_constant(glsl, values[i], base_type(type));
+				str_add(glsl, ";\n");
 			}
 		} else if(*opcode == 0x54) { // id1 = id2
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
-			READ_ID_WITH_MATVEC_ELEMENT(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID_WITH_MATVEC_ELEMENT(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID_WITH_MATVEC_ELEMENT(2,FUNC_DEF_BIT);
 			if(type2 > 20) return 1;
 			if(type1 >= 9 && type1 <= 17 && matvec_idx1 > MAT_SIZE(type1)-1) // left operand is full matrix; right operand must be as well
@@ -1781,51 +2186,51 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(type2 < 9 && matvec_idx2 > VEC_SIZE(type2)-1)	// right operand is full vec; left operand must be as well
 				if(type1 >= 9 || matvec_idx1 <= VEC_SIZE(type1)-1 || VEC_SIZE(type1) != VEC_SIZE(type2)) return 1;	// left operand not a full vec of same size
 
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id1);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id1);
 			ADD_IDX(1);
-			if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(&glsl_shader->src, matvec_idx1);
-			if(type1 >= 9 && type1 <= 17 && matvec_idx1 < MAT_SIZE(type1)) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1);
-			str_add(&glsl_shader->src, " = ");
-			str_add_typecast(&glsl_shader->src, type1<9 && matvec_idx1 >= VEC_SIZE(type1), VEC_SIZE(type1), base_type(type1));
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id2);
+			if(type1 < 9 && matvec_idx1 < VEC_SIZE(type1)) str_add_vec_idx(glsl, matvec_idx1);
+			if(type1 >= 9 && type1 <= 17 && matvec_idx1 < MAT_SIZE(type1)) str_add_mat_idx(glsl, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1);
+			str_add(glsl, " = ");
+			str_add_typecast(glsl, type1<9 && matvec_idx1 >= VEC_SIZE(type1), VEC_SIZE(type1), base_type(type1));
+			str_add(glsl, "_");
+			str_add_ui(glsl, id2);
 			ADD_IDX(2);
-			if(type2 < 9 && matvec_idx2 < VEC_SIZE(type2)) str_add_vec_idx(&glsl_shader->src, matvec_idx2);
-			if(type2 >= 9 && type2 <= 17 && matvec_idx1 < MAT_SIZE(type2)) str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2);
-			str_add(&glsl_shader->src, ");\n");
+			if(type2 < 9 && matvec_idx2 < VEC_SIZE(type2)) str_add_vec_idx(glsl, matvec_idx2);
+			if(type2 >= 9 && type2 <= 17 && matvec_idx1 < MAT_SIZE(type2)) str_add_mat_idx(glsl, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2);
+			str_add(glsl, ");\n");
 		} else if(*opcode == 0x55) { // vertex position output
 			if(shader_type != 0) return 1; // this can only be present in vertex shader
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
 			READ_ID(,FUNC_DEF_BIT);
 			if(type != 2) return 1; // must be vec4
-			str_add(&glsl_shader->src, "gl_Position = vec4(");
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "gl_Position = vec4(");
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, ".x, -_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, ".x, -_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, ".y, _");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, ".y, _");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, ".z, _");			// NDC depth is in range [0,1] but will be adjusted to OpenGL's [-1,1] range
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, ".z, _");			// NDC depth is in range [0,1] but will be adjusted to OpenGL's [-1,1] range
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, ".w);\n");
-			str_add(&glsl_shader->src, "gl_Position.z = ((gl_Position.z/gl_Position.w)*2-1)*gl_Position.w;\n");
+			str_add(glsl, ".w);\n");
+			str_add(glsl, "gl_Position.z = ((gl_Position.z/gl_Position.w)*2-1)*gl_Position.w;\n");
 		} else if(*opcode == 0x56) { // depth output
 			if(shader_type != 1) return 1; // this can only be present in pixel shader
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
 			READ_ID(,FUNC_DEF_BIT);
 			if(type != 18) return 1; // must be float
-			str_add(&glsl_shader->src, "gl_FragDepth = ");
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "gl_FragDepth = ");
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			str_add(&glsl_shader->src, ";\n");
+			str_add(glsl, ";\n");
 			modified_frag_depth = 1;
 		} else if(*opcode == 0x57) { // instance ID getter
 			if(shader_type != 0) return 1; // this can only be present in vertex shader
@@ -1833,18 +2238,18 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			opcode++;
 			READ_ID(,FUNC_DEF_BIT);
 			if(type != 19 && type != 20) return 1; // must be int or uint
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id);
 			ADD_IDX();
-			if(type == 19) str_add(&glsl_shader->src, "= gl_InstanceID;\n");
-			else str_add(&glsl_shader->src, "= uint(gl_InstanceID);\n");
+			if(type == 19) str_add(glsl, "= gl_InstanceID;\n");
+			else str_add(glsl, "= uint(gl_InstanceID);\n");
 		} else if(*opcode == 0x58); // image read
 		else if(*opcode == 0x59); // image write
 		else if(*opcode == 0x5A); // image dimensions
 		else if(*opcode >= 0x5B && *opcode <= 0x5D) { // sample using explicit LOD (0x5B), auto LOD (0x5C), or texel coords (0x5D)
 			if(*opcode == 0x5C && (shader_type != 1 || scope_type != 1 || scope_level != 1)) return 1; // can only be on level 1 of pixel shader's main function
 			opcode++;
-			READ_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(1,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID(2,ALL_DEF_BIT&(~UNIF_DEF_BIT)); // must be uniform
 			READ_ID(3,FUNC_DEF_BIT);
 			READ_ID_WITH_MATVEC_ELEMENT(4,FUNC_DEF_BIT);
@@ -1857,63 +2262,63 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(arr_idx2 == IDX_TYPE_LOOP) it_count = level_iterations[scope_level-1];	// if in loop
 			for(uint32_t i = 0; i < it_count; i++) {
 				if(arr_idx2 == IDX_TYPE_LOOP) {
-					str_add(&glsl_shader->src, "if(");
-					str_add_iterator(&glsl_shader->src, scope_level-1);
-					str_add(&glsl_shader->src, " == ");
-					str_add_ui(&glsl_shader->src, i);
-					str_add(&glsl_shader->src, ") ");
+					str_add(glsl, "if(");
+					str_add_iterator(glsl, scope_level-1);
+					str_add(glsl, " == ");
+					str_add_ui(glsl, i);
+					str_add(glsl, ") ");
 				}
-				str_add(&glsl_shader->src, "_");
-				str_add_ui(&glsl_shader->src, id1);
+				str_add(glsl, "_");
+				str_add_ui(glsl, id1);
 				ADD_IDX(1);
-				if(op_byte == 0x5B)			str_add(&glsl_shader->src, " = textureLod(_");
-				else if(op_byte == 0x5C)	str_add(&glsl_shader->src, " = texture(_");
-				else if(op_byte == 0x5D)	str_add(&glsl_shader->src, " = texelFetch(_");
-				str_add_ui(&glsl_shader->src, id2);
+				if(op_byte == 0x5B)			str_add(glsl, " = textureLod(_");
+				else if(op_byte == 0x5C)	str_add(glsl, " = texture(_");
+				else if(op_byte == 0x5D)	str_add(glsl, " = texelFetch(_");
+				str_add_ui(glsl, id2);
 				if(arr_idx2 != IDX_TYPE_LOOP) {
 					ADD_IDX(2);
 				} else {
-					str_add(&glsl_shader->src, "[");
-					str_add_ui(&glsl_shader->src, i);
-					str_add(&glsl_shader->src, "]");
+					str_add(glsl, "[");
+					str_add_ui(glsl, i);
+					str_add(glsl, "]");
 				}
-				str_add(&glsl_shader->src, ",_");
-				str_add_ui(&glsl_shader->src, id3);
+				str_add(glsl, ",_");
+				str_add_ui(glsl, id3);
 				ADD_IDX(3);
-				if(op_byte == 0x5D) str_add(&glsl_shader->src, ",int(_");	// GLSL doesn't implicitly convert uint to int
-				else str_add(&glsl_shader->src, ",_");
-				str_add_ui(&glsl_shader->src, id4);
+				if(op_byte == 0x5D) str_add(glsl, ",int(_");	// GLSL doesn't implicitly convert uint to int
+				else str_add(glsl, ",_");
+				str_add_ui(glsl, id4);
 				ADD_IDX(4);
 				if(type4 < 9) { // vector
 					if(matvec_idx4 > VEC_SIZE(type4)-1) return 1; // vector element must exist
-					str_add_vec_idx(&glsl_shader->src, matvec_idx4);	// output to specific vector element
+					str_add_vec_idx(glsl, matvec_idx4);	// output to specific vector element
 				} else if(type4 <= 17) { // matrix
 					if(matvec_idx4 > MAT_SIZE(type4)-1) return 1; // matrix element must exist
-					str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type4), MAT_HEIGHT(type4), matvec_idx4); // output to specific matrix element
+					str_add_mat_idx(glsl, MAT_WIDTH(type4), MAT_HEIGHT(type4), matvec_idx4); // output to specific matrix element
 				}
-				if(op_byte == 0x5D) str_add(&glsl_shader->src, "));\n");
-				else str_add(&glsl_shader->src, ");\n");
+				if(op_byte == 0x5D) str_add(glsl, "));\n");
+				else str_add(glsl, ");\n");
 			}
 		} else if(*opcode == 0x5E) { // texture dimensions
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
 			opcode++;
 			READ_ID(1,ALL_DEF_BIT&(~UNIF_DEF_BIT)); // must be uniform
-			READ_ID(2,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
+			READ_DEST_ID(2,UNIF_DEF_BIT|IN_ATTR_DEF_BIT|FUNC_DEF_BIT); // uniform + in attrib read-only; exclude in search
 			READ_ID(3,FUNC_DEF_BIT);
 			if(type1 < 21 || type1 > 23) return 1;	// first id must be a sampler type
 			if(type2 != 3) return 1;	// second id must be ivec2
 			if(type3 != 19) return 1;	// third id must be int
 
-			str_add(&glsl_shader->src, "_");
-			str_add_ui(&glsl_shader->src, id2);
+			str_add(glsl, "_");
+			str_add_ui(glsl, id2);
 			ADD_IDX(2);
-			str_add(&glsl_shader->src, " = textureSize(_");
-			str_add_ui(&glsl_shader->src, id1);
+			str_add(glsl, " = textureSize(_");
+			str_add_ui(glsl, id1);
 			ADD_IDX(1);
-			str_add(&glsl_shader->src, ", _");
-			str_add_ui(&glsl_shader->src, id3);
+			str_add(glsl, ", _");
+			str_add_ui(glsl, id3);
 			ADD_IDX(3);
-			str_add(&glsl_shader->src, ");\n");
+			str_add(glsl, ");\n");
 		} else if(*opcode >= 0x5F && *opcode <= 0x61) {	// if, else-if, or else
 			if((scope_type != 1 && scope_type != 2) || scope_level == 0) return 1; // must be in a function
 			if(scope_level == 8) return 1;	// can't open a conditional on level 8
@@ -1922,14 +2327,14 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(*opcode == 0x5F) level_allow_if_extension[scope_level-1] = 1;	// if opcode; enable if extensions for this level
 			if(*opcode == 0x61) level_allow_if_extension[scope_level-1] = 0;	// else opcode; disable if extensions for this level
 			level_status[scope_level-1] = 1;	// set level to conditional status
-			if(*opcode == 0x5F) str_add(&glsl_shader->src, "if(");
-			else if(*opcode == 0x60) str_add(&glsl_shader->src, "else if(");
-			else if(*opcode == 0x61) str_add(&glsl_shader->src, "else ");
+			if(*opcode == 0x5F) str_add(glsl, "if(");
+			else if(*opcode == 0x60) str_add(glsl, "else if(");
+			else if(*opcode == 0x61) str_add(glsl, "else ");
 			uint8_t branch_type = *opcode;
 			opcode++;
 			while(opcode <= end) {
 				if(*opcode == 0xE) {	// open conditional body (end of condition list)
-					if(branch_type != 0x61) str_add(&glsl_shader->src, ") ");
+					if(branch_type != 0x61) str_add(glsl, ") ");
 					break;
 				} else if(branch_type == 0x61) return 1;			// else shouldn't have a conditions list
 				else {		// value cond value
@@ -1976,55 +2381,55 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 					if(is_id_2) types = base_type(type2);
 					if(is_id_1 && is_id_2) types = base_type(type1) | base_type(type2);
 
-					str_add_typecast(&glsl_shader->src, 0, 0, types);
+					str_add_typecast(glsl, 0, 0, types);
 					if(is_id_1) {
-						str_add(&glsl_shader->src, "_");
-						str_add_ui(&glsl_shader->src, id1);
+						str_add(glsl, "_");
+						str_add_ui(glsl, id1);
 						ADD_IDX(1);
 						if(type1 < 9) { // vector
 							if(matvec_idx1 > VEC_SIZE(type1)-1) return 1; // vector element must exist
-							str_add_vec_idx(&glsl_shader->src, matvec_idx1);	// output to specific vector element
+							str_add_vec_idx(glsl, matvec_idx1);	// output to specific vector element
 						} else if(type1 <= 17) { // matrix
 							if(matvec_idx1 > MAT_SIZE(type1)-1) return 1; // matrix element must exist
-							str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
+							str_add_mat_idx(glsl, MAT_WIDTH(type1), MAT_HEIGHT(type1), matvec_idx1); // output to specific matrix element
 						}
 					} else {
-						if(types == 0) str_add_ui(&glsl_shader->src, *(uint32_t*)&constant_1);
-						else if(types == 1) str_add_i(&glsl_shader->src, *(int32_t*)&constant_1);
-						else str_add_f(&glsl_shader->src, *(float*)&constant_1);
+						if(types == 0) str_add_ui(glsl, *(uint32_t*)&constant_1);
+						else if(types == 1) str_add_i(glsl, *(int32_t*)&constant_1);
+						else str_add_f(glsl, *(float*)&constant_1);
 					}
-					str_add(&glsl_shader->src, ")");
+					str_add(glsl, ")");
 
 					switch(cond_op) {
-						case 0x62: str_add(&glsl_shader->src, " > "); break;
-						case 0x63: str_add(&glsl_shader->src, " < "); break;
-						case 0x64: str_add(&glsl_shader->src, " <= "); break;
-						case 0x65: str_add(&glsl_shader->src, " >= "); break;
-						case 0x66: str_add(&glsl_shader->src, " == "); break;
-						case 0x67: str_add(&glsl_shader->src, " != "); break;
+						case 0x62: str_add(glsl, " > "); break;
+						case 0x63: str_add(glsl, " < "); break;
+						case 0x64: str_add(glsl, " <= "); break;
+						case 0x65: str_add(glsl, " >= "); break;
+						case 0x66: str_add(glsl, " == "); break;
+						case 0x67: str_add(glsl, " != "); break;
 					}
 
-					str_add_typecast(&glsl_shader->src, 0, 0, types);
+					str_add_typecast(glsl, 0, 0, types);
 					if(is_id_2) {
-						str_add(&glsl_shader->src, "_");
-						str_add_ui(&glsl_shader->src, id2);
+						str_add(glsl, "_");
+						str_add_ui(glsl, id2);
 						ADD_IDX(2);
 						if(type2 < 9) { // vector
 							if(matvec_idx2 > VEC_SIZE(type2)-1) return 1; // vector element must exist
-							str_add_vec_idx(&glsl_shader->src, matvec_idx2);	// output to specific vector element
+							str_add_vec_idx(glsl, matvec_idx2);	// output to specific vector element
 						} else if(type2 <= 17) { // matrix
 							if(matvec_idx2 > MAT_SIZE(type2)-1) return 1; // matrix element must exist
-							str_add_mat_idx(&glsl_shader->src, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // output to specific matrix element
+							str_add_mat_idx(glsl, MAT_WIDTH(type2), MAT_HEIGHT(type2), matvec_idx2); // output to specific matrix element
 						}
 					} else {
-						if(types == 0) str_add_ui(&glsl_shader->src, *(uint32_t*)&constant_2);
-						else if(types == 1) str_add_i(&glsl_shader->src, *(int32_t*)&constant_2);
-						else str_add_f(&glsl_shader->src, *(float*)&constant_2);
+						if(types == 0) str_add_ui(glsl, *(uint32_t*)&constant_2);
+						else if(types == 1) str_add_i(glsl, *(int32_t*)&constant_2);
+						else str_add_f(glsl, *(float*)&constant_2);
 					}
-					str_add(&glsl_shader->src, ")");
+					str_add(glsl, ")");
 				}
-				if(*opcode == 0x68) str_add(&glsl_shader->src, " || "), opcode++;
-				if(*opcode == 0x69) str_add(&glsl_shader->src, " && "), opcode++;
+				if(*opcode == 0x68) str_add(glsl, " || "), opcode++;
+				if(*opcode == 0x69) str_add(glsl, " && "), opcode++;
 			}
 		} else if(*opcode == 0x6A) { // loop
 			if(scope_type != 1 && scope_type != 2) return 1; // must be in a function
@@ -2034,15 +2439,15 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 			if(READ(opcode+3,1) != 0x0E) return 1;	// missing loop opener
 			opcode += 3;
 
-			str_add(&glsl_shader->src, "for(int ");
-			str_add_iterator(&glsl_shader->src, scope_level);
-			str_add(&glsl_shader->src, " = 0; ");
-			str_add_iterator(&glsl_shader->src, scope_level);
-			str_add(&glsl_shader->src, " < ");
-			str_add_ui(&glsl_shader->src, it_count);
-			str_add(&glsl_shader->src, "; ");
-			str_add_iterator(&glsl_shader->src, scope_level);
-			str_add(&glsl_shader->src, "++)\n");
+			str_add(glsl, "for(int ");
+			str_add_iterator(glsl, scope_level);
+			str_add(glsl, " = 0; ");
+			str_add_iterator(glsl, scope_level);
+			str_add(glsl, " < ");
+			str_add_ui(glsl, it_count);
+			str_add(glsl, "; ");
+			str_add_iterator(glsl, scope_level);
+			str_add(glsl, "++)\n");
 
 			level_status[scope_level] = 2;	// set level's status to in loop
 			level_iterations[scope_level] = it_count;	// set level's iteration count
@@ -2051,73 +2456,575 @@ uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_
 	}
 	// by the end of the shader, scope_level and scope_type must both be 1, or else the shader contains unclosed functions or contains no main function
 	if(scope_level != 1 || scope_type != 1) return 1;
-	str_add(&glsl_shader->src, "}\n");	// close off the main function
+	next_stmt_span(table, glsl->len);
+	str_add(glsl, "}\n");	// close off the main function
+	entry_point = remove_unused_decls(table, glsl, entry_point);
 	if(modified_frag_depth && shader_type == 1)
-		str_insert(&glsl_shader->src, "gl_FragDepth = gl_FragCoord.z;\n", entry_point);		// if a shader contains gl_FragDepth = ..., it must write to the value in all cases
+		str_insert(glsl, "gl_FragDepth = gl_FragCoord.z;\n", entry_point);		// if a shader contains gl_FragDepth = ..., it must write to the value in all cases
 
-	shader_data->defs = defs;
-	shader_data->n_defs = n_defs;
+	shader_data->defs = table->defs;
+	shader_data->n_defs = table->n_defs;
 
 	return 0;
 }
 
+// returns 1 on fail, returns 0 and fills glsl_shader on success
+uint8_t build_shader(uint8_t* src, uint32_t length, uint8_t shader_type, shader_t* glsl_shader, shader_data_t* shader_data) {
+	str_t glsl;
+	str_init(&glsl, 4096 + length*8);	// rough guess at the GLSL size to avoid most regrowth
+	def_table_t table = {0};
+	table.index = calloc(65536, sizeof(uint32_t));
+	uint8_t fail = translate_shader(src, length, shader_type, &glsl, &table, shader_data);
+	free(table.index);
+	free(table.decl);
+	free(table.decls);
+	free(table.stmts);
+	free(table.stmt_reads);
+	if(fail) {
+		free(table.defs);
+		free(glsl.str);
+		return 1;
+	}
+	free(glsl_shader->src);
+	glsl_shader->src = glsl.str;
+	glsl_shader->size = glsl.len + 1;
+	return 0;
+}
+
+// shadow copy of GL state; state changes made through it are skipped if they wouldn't change anything
+// any GL state changed without going through it must be forgotten with gl_state_invalidate()
+#define MAX_CACHED_TEXTURE_UNITS 32
+typedef struct gl_state_t {
+	GLuint program;
+	GLuint vao;
+	GLuint framebuffer;
+	GLuint active_texture;	// active texture unit (0-based)
+	GLuint textures[MAX_CACHED_TEXTURE_UNITS];	// texture bound to GL_TEXTURE_2D at each texture unit
+	GLuint samplers[MAX_CACHED_TEXTURE_UNITS];	// sampler object bound to each texture unit
+	uint8_t depth_test_enabled;
+	GLenum front_face;
+	gl_raster_state_t raster;	// state set by rasterization pipelines; n_draw_buffers is the number set for the bound framebuffer
+} gl_state_t;
+
+gl_state_t gl_state;
+uint64_t gl_calls_issued, gl_calls_skipped;	// number of state changes issued to GL and skipped by the shadow state
+
+// forget all shadowed GL state; the next change of each state is always issued
+void gl_state_invalidate() { memset(&gl_state, 0xFF, sizeof(gl_state_t)); }
+
+// updates a shadowed GL state, returns nonzero if the value differs from the shadowed one (the GL call should be made)
+#define GL_STATE_CHANGED(state, value) (gl_state.state != (value) ? (gl_state.state = (value), ++gl_calls_issued) : (gl_calls_skipped++, 0))
+
+void gl_use_program(GLuint program) { if(GL_STATE_CHANGED(program, program)) glUseProgram(program); }
+void gl_bind_vertex_array(GLuint vao) { if(GL_STATE_CHANGED(vao, vao)) glBindVertexArray(vao); }
+void gl_active_texture(GLuint unit) { if(GL_STATE_CHANGED(active_texture, unit)) glActiveTexture(GL_TEXTURE0+unit); }
+
+void gl_bind_framebuffer(GLuint framebuffer) {
+	if(GL_STATE_CHANGED(framebuffer, framebuffer)) {
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		gl_state.raster.n_draw_buffers = -1;	// draw buffers are framebuffer state
+	}
+}
+
+// binds a texture to GL_TEXTURE_2D of a texture unit; the texture unit is left active only if the binding changed
+void gl_bind_texture(GLuint unit, GLuint texture) {
+	if(unit >= MAX_CACHED_TEXTURE_UNITS) {
+		gl_active_texture(unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		gl_calls_issued++;
+	} else if(GL_STATE_CHANGED(textures[unit], texture)) {
+		gl_active_texture(unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+}
+
+void gl_bind_sampler(GLuint unit, GLuint sampler) {
+	if(unit >= MAX_CACHED_TEXTURE_UNITS) { glBindSampler(unit, sampler); gl_calls_issued++; }
+	else if(GL_STATE_CHANGED(samplers[unit], sampler)) glBindSampler(unit, sampler);
+}
+
+// GL sampler objects for each combination of sampler descriptor min filter, mag filter, S mode, and T mode; created when first used
+GLuint gl_samplers[6][2][3][3];
+
+// returns the GL sampler object for a sampler descriptor's filtering and wrapping modes (must be in range)
+GLuint get_gl_sampler(uint8_t min_filter, uint8_t mag_filter, uint8_t s_mode, uint8_t t_mode) {
+	GLuint* sampler = &gl_samplers[min_filter][mag_filter][s_mode][t_mode];
+	if(*sampler) return *sampler;
+	GLint min_filters[6] = { GL_NEAREST, GL_LINEAR, GL_NEAREST_MIPMAP_NEAREST, GL_LINEAR_MIPMAP_NEAREST, GL_NEAREST_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR };
+	GLint mag_filters[2] = { GL_NEAREST, GL_LINEAR };
+	GLint modes[3] = { GL_CLAMP_TO_EDGE, GL_MIRRORED_REPEAT, GL_REPEAT };
+	glGenSamplers(1, sampler);
+	glSamplerParameteri(*sampler, GL_TEXTURE_MIN_FILTER, min_filters[min_filter]);
+	glSamplerParameteri(*sampler, GL_TEXTURE_MAG_FILTER, mag_filters[mag_filter]);
+	glSamplerParameteri(*sampler, GL_TEXTURE_WRAP_S, modes[s_mode]);
+	glSamplerParameteri(*sampler, GL_TEXTURE_WRAP_T, modes[t_mode]);
+	return *sampler;
+}
+
 typedef struct tbo_t {
 	GLint gl_buffer;	// the ID of the GL texture object
 	uint32_t n_levels;	// how many levels have already been uploaded to
-	uint32_t* level_widths; // width of each level
-	uint32_t* level_heights; // height of each level
+	uint32_t n_chain_levels;	// number of levels in the mip chain of level 0 (down to 1x1); 0 before level 0 is uploaded to
+	uint32_t* level_widths; // width of each level in the chain
+	uint32_t* level_heights; // height of each level in the chain
+	uint8_t immutable;	// the GL texture's storage for the whole chain was allocated with glTexStorage2D; its level dimensions can't change
 	uint8_t format;		// the format for this TBO
+	GLint tex_params[4];	// min filter, mag filter, wrap S, wrap T last set on the GL texture (0 if never set); only used without sampler objects
 } tbo_t;
 
-// uploads to a texture level of a TBO, if possible
-void upload_texture(tbo_t* tbo, uint32_t level, uint32_t width, uint32_t height, void* data) {
-	if(width > max_texture_size || height > max_texture_size) return;
-	glBindTexture(GL_TEXTURE_2D, tbo->gl_buffer);
+// texture uploads are staged in a ring of GL pixel unpack buffers, so that the driver does the texture update asynchronously instead of copying the data first
+// a buffer is written without synchronization once the fence placed after its last upload has signaled; otherwise (or without sync objects) its storage
+// is invalidated, and the driver gives it new storage instead of waiting on the GPU
+#define UPLOAD_RING_SIZE 4
+typedef struct upload_buffer_t {
+	GLuint gl_buffer;
+	uint64_t size;	// allocated size of the GL buffer
+	GLsync fence;	// signaled once GL has consumed the last upload from the buffer; 0 if there is none pending (or no sync objects)
+} upload_buffer_t;
+
+upload_buffer_t upload_ring[UPLOAD_RING_SIZE];
+uint32_t upload_ring_next = 0;	// index of the next buffer in the ring to use
+
+// maps the next buffer in the upload ring to write n_bytes of texture data; it is left bound to GL_PIXEL_UNPACK_BUFFER
+// returns 0 if the buffer couldn't be mapped (nothing is left bound in that case)
+uint8_t* map_upload_buffer(uint64_t n_bytes) {
+	upload_buffer_t* buffer = &upload_ring[upload_ring_next];
+	if(!buffer->gl_buffer) glGenBuffers(1, &buffer->gl_buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->gl_buffer);
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;	// GL may still be reading the buffer; let the driver give it new storage
+	if(buffer->fence) {
+		GLenum status = glClientWaitSync(buffer->fence, 0, 0);	// poll; never wait
+		if(status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+		glDeleteSync(buffer->fence);
+		buffer->fence = 0;
+	}
+	if(n_bytes > buffer->size) {	// grow the buffer to the largest upload made through it
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, n_bytes, 0, GL_STREAM_DRAW);
+		buffer->size = n_bytes;
+	}
+	uint8_t* data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, n_bytes, access);
+	if(!data) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return data;
+}
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	if(level == tbo->n_levels) {	// next level specified; glTexImage2D
-		tbo->level_widths = realloc(tbo->level_widths, sizeof(uint32_t)*(tbo->n_levels+1));
-		tbo->level_heights = realloc(tbo->level_heights, sizeof(uint32_t)*(tbo->n_levels+1));
-		tbo->level_widths[tbo->n_levels] = width;
-		tbo->level_heights[tbo->n_levels] = height;
-		tbo->n_levels++;
-		switch(tbo->format) {
-			case 0: glTexImage2D(GL_TEXTURE_2D, level, GL_R8I, width, height, 0, GL_RED, GL_BYTE, data); break;
-			case 1: glTexImage2D(GL_TEXTURE_2D, level, GL_R8UI, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data); break;
-			case 2: glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, data); break;
-			case 3: glTexImage2D(GL_TEXTURE_2D, level, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data); break;
-			case 4: glTexImage2D(GL_TEXTURE_2D, level, GL_RG8I, width, height, 0, GL_RG, GL_BYTE, data); break;
-			case 5: glTexImage2D(GL_TEXTURE_2D, level, GL_RG8UI, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, data); break;
-			case 6: glTexImage2D(GL_TEXTURE_2D, level, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, data); break;
-			case 7: glTexImage2D(GL_TEXTURE_2D, level, GL_RG8, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, data); break;
-			case 8: glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8I, width, height, 0, GL_RGBA, GL_BYTE, data); break;
-			case 9: glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8UI, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data); break;
-			case 10: glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, data); break;
-			case 11: glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data); break;
-			case 12: glTexImage2D(GL_TEXTURE_2D, level, GL_DEPTH_COMPONENT32F, width, height, 0, GL_RED, GL_FLOAT, data); break;
-			case 13: glTexImage2D(GL_TEXTURE_2D, level, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, data); break;
+// releases the buffer returned by map_upload_buffer once the texture update reading from it has been issued, and moves on to the next buffer in the ring
+void release_upload_buffer() {
+	upload_buffer_t* buffer = &upload_ring[upload_ring_next];
+	if(gl_sync_objects) buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);	// other texture updates (e.g. of FBO attachments) must not read from the buffer
+	upload_ring_next = (upload_ring_next+1) % UPLOAD_RING_SIZE;
+}
+
+// unmaps the buffer returned by map_upload_buffer, leaving it bound for the texture update reading from it; returns 0 if its contents were lost
+// while mapped, in which case the buffer is released (see release_upload_buffer)
+uint8_t unmap_upload_buffer() {
+	if(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE) return 1;
+	release_upload_buffer();
+	return 0;
+}
+
+// block-compressed TBO formats (14-21): BC1, BC2, BC3, BC4, BC5, BC7, ETC2 RGB8, and ETC2 RGBA8 (EAC alpha), made of 4x4 texel blocks
+// each is uploaded compressed if GL supports it (bit format-14 of gl_compressed_formats); otherwise it's decoded to RGBA8 on the CPU
+#define N_TBO_FORMATS 22
+#define IS_COMPRESSED_TBO_FORMAT(format) ((format) >= 14)
+#define IS_DECODED_TBO_FORMAT(format) (IS_COMPRESSED_TBO_FORMAT(format) && !((gl_compressed_formats >> ((format)-14)) & 1))
+
+// size of a block of a compressed TBO format, in bytes
+uint32_t compressed_block_size(uint8_t format) { return format == 14 || format == 17 || format == 20 ? 8 : 16; }
+
+// size of the data for a width x height region of a texture of a TBO format, in bytes
+uint64_t tbo_data_size(uint8_t format, uint32_t width, uint32_t height) {
+	if(IS_COMPRESSED_TBO_FORMAT(format)) return (uint64_t)((width+3)/4)*((height+3)/4)*compressed_block_size(format);
+	uint32_t bpp;
+	switch(format) {
+		case 0: case 1: case 3: bpp = 1; break;
+		case 4: case 5: case 7: bpp = 2; break;
+		case 6:  bpp = 8; break;
+		case 10: bpp = 16; break;
+		default: bpp = 4; break;
+	}
+	return (uint64_t)bpp*width*height;
+}
+
+// the decoders below write the 16 texels of a block to an array of 8-bit RGBA texels, row by row
+
+// decodes the color endpoints + indices of a BC1, BC2, or BC3 block; BC2 and BC3 blocks always have 4 colors
+void decode_bc1_block(uint8_t* block, uint8_t* texels, uint8_t four_colors) {
+	uint16_t endpoints[2] = { block[0] | block[1] << 8, block[2] | block[3] << 8 };
+	uint8_t colors[4][4];
+	for(uint32_t i = 0; i < 2; i++) {
+		uint32_t r = endpoints[i] >> 11, g = (endpoints[i] >> 5) & 63, b = endpoints[i] & 31;
+		colors[i][0] = r << 3 | r >> 2;
+		colors[i][1] = g << 2 | g >> 4;
+		colors[i][2] = b << 3 | b >> 2;
+		colors[i][3] = 255;
+	}
+	for(uint32_t c = 0; c < 3; c++) {
+		if(four_colors || endpoints[0] > endpoints[1]) {
+			colors[2][c] = (2*colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2*colors[1][c]) / 3;
+		} else {
+			colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = 0;
+		}
+	}
+	colors[2][3] = 255;
+	colors[3][3] = four_colors || endpoints[0] > endpoints[1] ? 255 : 0;	// transparent black in 3 color blocks
+	uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+	for(uint32_t i = 0; i < 16; i++)
+		memcpy(texels+i*4, colors[(indices >> 2*i) & 3], 4);
+}
+
+// decodes an 8-bit channel block (BC3 alpha, BC4, BC5) to every 4th byte of texels
+void decode_bc4_block(uint8_t* block, uint8_t* texels) {
+	uint8_t values[8] = { block[0], block[1] };
+	if(block[0] > block[1])
+		for(uint32_t i = 2; i < 8; i++) values[i] = ((8-i)*block[0] + (i-1)*block[1]) / 7;
+	else {
+		for(uint32_t i = 2; i < 6; i++) values[i] = ((6-i)*block[0] + (i-1)*block[1]) / 5;
+		values[6] = 0;
+		values[7] = 255;
+	}
+	uint64_t indices = 0;
+	for(uint32_t i = 0; i < 6; i++) indices |= (uint64_t)block[2+i] << 8*i;
+	for(uint32_t i = 0; i < 16; i++)
+		texels[i*4] = values[(indices >> 3*i) & 7];
+}
+
+// BC7 partitions of texels into subsets (2 subsets: 1 bit per texel, 3 subsets: 2 bits per texel), and the texels that are the anchors of the subsets after the first
+const uint16_t bc7_partitions2[64] = {
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22 };
+const uint32_t bc7_partitions3[64] = {
+	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+	0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+	0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+	0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+	0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+	0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254 };
+const uint8_t bc7_anchors2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15 };
+const uint8_t bc7_anchors3[2][64] = {
+	{ 3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+	  8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3 },
+	{ 15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, 15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+	  15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8 } };
+
+// reads a field of a BC7 block, whose fields are packed from the least significant bit of the first byte
+uint32_t read_block_bits(uint8_t* block, uint32_t* bit, uint32_t n_bits) {
+	uint32_t value = 0;
+	for(uint32_t i = 0; i < n_bits; i++, (*bit)++)
+		value |= ((block[*bit >> 3] >> (*bit & 7)) & 1) << i;
+	return value;
+}
+
+void decode_bc7_block(uint8_t* block, uint8_t* texels) {
+	// for each mode: subsets, partition bits, rotation bits, index selection bits, color bits, alpha bits, p-bits per endpoint, p-bits per subset, index bits, secondary index bits
+	static const uint8_t modes[8][10] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 }, { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 }, { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 }, { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 }, { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 }, { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 }, { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 } };
+	static const uint8_t weights2[4] = { 0, 21, 43, 64 };
+	static const uint8_t weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	static const uint8_t weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	uint32_t mode = 0;
+	while(mode < 8 && !(block[0] & (1 << mode))) mode++;
+	if(mode == 8) { memset(texels, 0, 64); return; }	// reserved mode; transparent black
+	const uint8_t* m = modes[mode];
+	uint32_t n_subsets = m[0];
+	uint32_t bit = mode+1;
+	uint32_t partition = read_block_bits(block, &bit, m[1]);
+	uint32_t rotation = read_block_bits(block, &bit, m[2]);
+	uint32_t index_selection = read_block_bits(block, &bit, m[3]);
+
+	uint8_t endpoints[6][4];	// 2 per subset
+	for(uint32_t c = 0; c < 3; c++)
+		for(uint32_t e = 0; e < n_subsets*2; e++) endpoints[e][c] = read_block_bits(block, &bit, m[4]);
+	for(uint32_t e = 0; e < n_subsets*2; e++) endpoints[e][3] = m[5] ? read_block_bits(block, &bit, m[5]) : 255;
+	uint32_t color_bits = m[4], alpha_bits = m[5];
+	if(m[6] || m[7]) {	// p-bits are the LSB of each channel of an endpoint
+		for(uint32_t e = 0; e < n_subsets*2; e++) {
+			if(m[7] && e % 2) continue;
+			uint32_t p = read_block_bits(block, &bit, 1);
+			for(uint32_t i = e; i < e + (m[7] ? 2 : 1); i++)
+				for(uint32_t c = 0; c < 4; c++)
+					if(c < 3 || alpha_bits) endpoints[i][c] = endpoints[i][c] << 1 | p;
+		}
+		color_bits++;
+		if(alpha_bits) alpha_bits++;
+	}
+	for(uint32_t e = 0; e < n_subsets*2; e++) {	// expand to 8 bits by replicating the high bits
+		for(uint32_t c = 0; c < 3; c++) endpoints[e][c] = endpoints[e][c] << (8-color_bits) | endpoints[e][c] >> (2*color_bits-8);
+		if(alpha_bits) endpoints[e][3] = endpoints[e][3] << (8-alpha_bits) | endpoints[e][3] >> (2*alpha_bits-8);
+	}
+
+	uint8_t subsets[16];
+	for(uint32_t i = 0; i < 16; i++)
+		subsets[i] = n_subsets == 1 ? 0 : n_subsets == 2 ? (bc7_partitions2[partition] >> i) & 1 : (bc7_partitions3[partition] >> 2*i) & 3;
+	uint8_t indices[2][16];	// anchor texels have their index's MSB left out (it's 0)
+	for(uint32_t i = 0; i < 16; i++) {
+		uint8_t anchor = i == 0 || (n_subsets == 2 && i == bc7_anchors2[partition])
+			|| (n_subsets == 3 && (i == bc7_anchors3[0][partition] || i == bc7_anchors3[1][partition]));
+		indices[0][i] = read_block_bits(block, &bit, m[8] - anchor);
+	}
+	if(m[9])
+		for(uint32_t i = 0; i < 16; i++) indices[1][i] = read_block_bits(block, &bit, m[9] - (i == 0));
+
+	// color and alpha are interpolated with the same indices, unless the mode has secondary indices
+	uint32_t color_set = m[9] ? index_selection : 0, alpha_set = m[9] ? !index_selection : 0;
+	uint32_t color_index_bits = color_set ? m[9] : m[8], alpha_index_bits = alpha_set ? m[9] : m[8];
+	const uint8_t* color_weights = color_index_bits == 2 ? weights2 : color_index_bits == 3 ? weights3 : weights4;
+	const uint8_t* alpha_weights = alpha_index_bits == 2 ? weights2 : alpha_index_bits == 3 ? weights3 : weights4;
+	for(uint32_t i = 0; i < 16; i++) {
+		uint8_t* e0 = endpoints[subsets[i]*2];
+		uint8_t* e1 = endpoints[subsets[i]*2+1];
+		uint8_t* texel = texels+i*4;
+		uint32_t w = color_weights[indices[color_set][i]];
+		for(uint32_t c = 0; c < 3; c++) texel[c] = ((64-w)*e0[c] + w*e1[c] + 32) >> 6;
+		w = alpha_weights[indices[alpha_set][i]];
+		texel[3] = ((64-w)*e0[3] + w*e1[3] + 32) >> 6;
+		if(rotation) {	// alpha was swapped with a color channel
+			uint8_t a = texel[3];
+			texel[3] = texel[rotation-1];
+			texel[rotation-1] = a;
+		}
+	}
+}
+
+uint8_t clamp_u8(int32_t value) { return value < 0 ? 0 : value > 255 ? 255 : value; }
+
+// decodes an ETC2 RGB block; its fields are packed from the most significant bit of the first byte, and texel indices are numbered column by column
+void decode_etc2_block(uint8_t* block, uint8_t* texels) {
+	static const int32_t modifiers[8][4] = { { 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+		{ 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 } };
+	static const int32_t distances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+	uint64_t bits = 0;
+	for(uint32_t i = 0; i < 8; i++) bits = bits << 8 | block[i];
+	#define ETC_BITS(high, n) ((int32_t)(bits >> ((high)-(n)+1)) & ((1 << (n))-1))
+
+	int32_t bases[2][3];	// base colors of the 2 sub-blocks (individual/differential modes)
+	int32_t paint[4][3];	// paint colors (T/H modes)
+	uint8_t mode = 0;	// 0: individual/differential, 1: T, 2: H, 3: planar
+	if(!ETC_BITS(33, 1)) {	// individual mode; 2 4-bit base colors
+		for(uint32_t c = 0; c < 3; c++) {
+			bases[0][c] = ETC_BITS(63-8*c, 4) * 17;
+			bases[1][c] = ETC_BITS(59-8*c, 4) * 17;
+		}
+	} else {	// differential mode; a 5-bit base color and a 3-bit signed difference, unless a channel overflows (selects the T, H, or planar mode)
+		for(uint32_t c = 0; c < 3 && !mode; c++) {
+			int32_t base = ETC_BITS(63-8*c, 5), second = base + ((ETC_BITS(58-8*c, 3) ^ 4) - 4);
+			if(second < 0 || second > 31) mode = c+1;
+			bases[0][c] = base << 3 | base >> 2;
+			bases[1][c] = second << 3 | second >> 2;
+		}
+	}
+
+	if(mode == 1 || mode == 2) {
+		int32_t colors[2][3];
+		if(mode == 1) {
+			colors[0][0] = ETC_BITS(60, 2) << 2 | ETC_BITS(57, 2); colors[0][1] = ETC_BITS(55, 4); colors[0][2] = ETC_BITS(51, 4);
+			colors[1][0] = ETC_BITS(47, 4); colors[1][1] = ETC_BITS(43, 4); colors[1][2] = ETC_BITS(39, 4);
+		} else {
+			colors[0][0] = ETC_BITS(62, 4); colors[0][1] = ETC_BITS(58, 3) << 1 | ETC_BITS(52, 1); colors[0][2] = ETC_BITS(51, 1) << 3 | ETC_BITS(49, 3);
+			colors[1][0] = ETC_BITS(46, 4); colors[1][1] = ETC_BITS(42, 4); colors[1][2] = ETC_BITS(38, 4);
+		}
+		int32_t distance = mode == 1 ? distances[ETC_BITS(35, 2) << 1 | ETC_BITS(32, 1)]
+			: distances[ETC_BITS(34, 1) << 2 | ETC_BITS(32, 1) << 1
+				| ((colors[0][0] << 8 | colors[0][1] << 4 | colors[0][2]) >= (colors[1][0] << 8 | colors[1][1] << 4 | colors[1][2]))];
+		for(uint32_t c = 0; c < 3; c++) {
+			colors[0][c] *= 17;
+			colors[1][c] *= 17;
+			if(mode == 1) {
+				paint[0][c] = colors[0][c]; paint[1][c] = colors[1][c] + distance; paint[2][c] = colors[1][c]; paint[3][c] = colors[1][c] - distance;
+			} else {
+				paint[0][c] = colors[0][c] + distance; paint[1][c] = colors[0][c] - distance; paint[2][c] = colors[1][c] + distance; paint[3][c] = colors[1][c] - distance;
+			}
 		}
-	} else if(level < tbo->n_levels) {	// level exists; glTexSubImage2D
+	} else if(mode == 3) {	// planar mode; colors at the origin, right, and bottom of the block are interpolated
+		int32_t o[3] = { ETC_BITS(62, 6), ETC_BITS(56, 1) << 6 | ETC_BITS(54, 6), ETC_BITS(48, 1) << 5 | ETC_BITS(44, 2) << 3 | ETC_BITS(41, 3) };
+		int32_t h[3] = { ETC_BITS(38, 5) << 1 | ETC_BITS(32, 1), ETC_BITS(31, 7), ETC_BITS(24, 6) };
+		int32_t v[3] = { ETC_BITS(18, 6), ETC_BITS(12, 7), ETC_BITS(5, 6) };
+		for(uint32_t c = 0; c < 3; c++) {
+			uint32_t n_bits = c == 1 ? 7 : 6;
+			o[c] = o[c] << (8-n_bits) | o[c] >> (2*n_bits-8);
+			h[c] = h[c] << (8-n_bits) | h[c] >> (2*n_bits-8);
+			v[c] = v[c] << (8-n_bits) | v[c] >> (2*n_bits-8);
+		}
+		for(int32_t y = 0; y < 4; y++)
+			for(int32_t x = 0; x < 4; x++) {
+				uint8_t* texel = texels+(y*4+x)*4;
+				for(uint32_t c = 0; c < 3; c++) texel[c] = clamp_u8((x*(h[c]-o[c]) + y*(v[c]-o[c]) + 4*o[c] + 2) >> 2);
+				texel[3] = 255;
+			}
+		return;
+	}
+
+	int32_t codewords[2] = { ETC_BITS(39, 3), ETC_BITS(36, 3) };
+	uint8_t flip = ETC_BITS(32, 1);
+	for(uint32_t x = 0; x < 4; x++)
+		for(uint32_t y = 0; y < 4; y++) {
+			uint32_t p = x*4+y;
+			uint32_t index = ((bits >> (p+16)) & 1) << 1 | ((bits >> p) & 1);
+			uint8_t* texel = texels+(y*4+x)*4;
+			uint32_t sub_block = flip ? y >= 2 : x >= 2;
+			for(uint32_t c = 0; c < 3; c++)
+				texel[c] = clamp_u8(mode ? paint[index][c] : bases[sub_block][c] + modifiers[codewords[sub_block]][index]);
+			texel[3] = 255;
+		}
+	#undef ETC_BITS
+}
+
+// decodes an EAC alpha block (ETC2 RGBA8) to every 4th byte of texels
+void decode_eac_block(uint8_t* block, uint8_t* texels) {
+	static const int32_t modifiers[16][8] = {
+		{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 }, { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 }, { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 }, { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 }, { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 } };
+	uint64_t bits = 0;
+	for(uint32_t i = 0; i < 8; i++) bits = bits << 8 | block[i];
+	int32_t base = block[0], multiplier = block[1] >> 4;
+	const int32_t* table = modifiers[block[1] & 15];
+	for(uint32_t p = 0; p < 16; p++)	// texel indices are numbered column by column
+		texels[((p%4)*4+p/4)*4] = clamp_u8(base + table[(bits >> (45-3*p)) & 7] * multiplier);
+}
+
+// decodes width x height texels of a compressed TBO format to 8-bit RGBA, rows from top to bottom
+void decode_compressed_texture(uint8_t format, uint32_t width, uint32_t height, uint8_t* blocks, uint8_t* texels) {
+	uint32_t block_size = compressed_block_size(format);
+	uint32_t blocks_x = (width+3)/4;
+	uint8_t block_texels[64];
+	for(uint32_t by = 0; by < (height+3)/4; by++)
+		for(uint32_t bx = 0; bx < blocks_x; bx++) {
+			uint8_t* block = blocks + ((uint64_t)by*blocks_x + bx)*block_size;
+			switch(format) {
+				case 14: decode_bc1_block(block, block_texels, 0); break;
+				case 15:
+					decode_bc1_block(block+8, block_texels, 1);
+					for(uint32_t i = 0; i < 16; i++) block_texels[i*4+3] = ((block[i/2] >> 4*(i%2)) & 15) * 17;
+					break;
+				case 16: decode_bc1_block(block+8, block_texels, 1); decode_bc4_block(block, block_texels+3); break;
+				case 17: case 18:	// red (+ green) channels; blue is 0 and alpha is 255, like sampling the GL formats
+					for(uint32_t i = 0; i < 64; i++) block_texels[i] = i%4 == 3 ? 255 : 0;
+					decode_bc4_block(block, block_texels);
+					if(format == 18) decode_bc4_block(block+8, block_texels+1);
+					break;
+				case 19: decode_bc7_block(block, block_texels); break;
+				case 20: decode_etc2_block(block, block_texels); break;
+				case 21: decode_etc2_block(block+8, block_texels); decode_eac_block(block, block_texels+3); break;
+			}
+			for(uint32_t y = 0; y < 4 && by*4+y < height; y++) {	// copy the part of the block within the texture
+				uint32_t n_texels = width-bx*4 < 4 ? width-bx*4 : 4;
+				memcpy(texels + ((uint64_t)(by*4+y)*width + bx*4)*4, block_texels+y*16, n_texels*4);
+			}
+		}
+}
+
+// sets a TBO's level dimensions to the mip chain of a width x height level 0, each level half the size of the one before it (minimum of 1) down to 1x1
+void set_tbo_level_chain(tbo_t* tbo, uint32_t width, uint32_t height) {
+	uint32_t n_chain_levels = 1;
+	for(uint32_t size = width > height ? width : height; size > 1; size /= 2) n_chain_levels++;
+	if(n_chain_levels != tbo->n_chain_levels) {
+		tbo->level_widths = realloc(tbo->level_widths, sizeof(uint32_t)*n_chain_levels);
+		tbo->level_heights = realloc(tbo->level_heights, sizeof(uint32_t)*n_chain_levels);
+		tbo->n_chain_levels = n_chain_levels;
+	}
+	for(uint32_t level = 0; level < n_chain_levels; level++) {
 		tbo->level_widths[level] = width;
 		tbo->level_heights[level] = height;
-		switch(tbo->format) {
-			case 0: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RED, GL_BYTE, data); break;
-			case 1: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, data); break;
-			case 2: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RED, GL_FLOAT, data); break;
-			case 3: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, data); break;
-			case 4: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RG, GL_BYTE, data); break;
-			case 5: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RG, GL_UNSIGNED_BYTE, data); break;
-			case 6: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RG, GL_FLOAT, data); break;
-			case 7: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RG, GL_UNSIGNED_BYTE, data); break;
-			case 8: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_BYTE, data); break;
-			case 9: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data); break;
-			case 10: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_FLOAT, data); break;
-			case 11: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data); break;
-			case 12: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RED, GL_FLOAT, data); break;
-			case 13: glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, data); break;
+		width = width > 1 ? width/2 : 1;
+		height = height > 1 ? height/2 : 1;
+	}
+}
+
+// uploads to a texture level of a TBO, or to the rectangle at x, y of an existing level if sub_rect is set, if possible
+// a whole level upload to the next level (the level after the last one uploaded to), or with different dimensions, (re)defines the level
+// (re)defining level 0 allocates storage for its whole mip chain (immutable if supported); the levels after it must be uploaded to again
+// with immutable storage, the levels after level 0 can only be defined with their dimensions in the chain
+// rectangles of compressed formats must be aligned to blocks, except where they reach the right or bottom edge of the level
+// data is either a pointer to the texels, or an offset into the buffer bound to GL_PIXEL_UNPACK_BUFFER (not for formats decoded on the CPU)
+// returns 0 if nothing was uploaded
+uint8_t upload_texture(tbo_t* tbo, uint32_t level, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t sub_rect, void* data) {
+	if(width > max_texture_size || height > max_texture_size) return 0;
+	if(level > tbo->n_levels || (level && level >= tbo->n_chain_levels)) return 0;
+	if(sub_rect && (level == tbo->n_levels || (uint64_t)x+width > tbo->level_widths[level] || (uint64_t)y+height > tbo->level_heights[level])) return 0;
+	if(!sub_rect) x = y = 0;
+	if(tbo->format >= N_TBO_FORMATS) return 0;
+	if(IS_COMPRESSED_TBO_FORMAT(tbo->format) && sub_rect && (x%4 || y%4 || (width%4 && x+width != tbo->level_widths[level]) || (height%4 && y+height != tbo->level_heights[level])))
+		return 0;
+	uint8_t define_level = !sub_rect && (level == tbo->n_levels || tbo->level_widths[level] != width || tbo->level_heights[level] != height);
+	if(define_level && level && tbo->immutable && (tbo->level_widths[level] != width || tbo->level_heights[level] != height)) return 0;
+
+	// internal format, format, and type of each TBO format
+	static const GLenum internal_formats[14] = { GL_R8I, GL_R8UI, GL_R32F, GL_R8, GL_RG8I, GL_RG8UI, GL_RG32F, GL_RG8,
+		GL_RGBA8I, GL_RGBA8UI, GL_RGBA32F, GL_RGBA8, GL_DEPTH_COMPONENT32F, GL_DEPTH24_STENCIL8 };
+	static const GLenum formats[14] = { GL_RED_INTEGER, GL_RED_INTEGER, GL_RED, GL_RED, GL_RG_INTEGER, GL_RG_INTEGER, GL_RG, GL_RG,
+		GL_RGBA_INTEGER, GL_RGBA_INTEGER, GL_RGBA, GL_RGBA, GL_DEPTH_COMPONENT, GL_DEPTH_STENCIL };
+	static const GLenum types[14] = { GL_BYTE, GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_BYTE,
+		GL_BYTE, GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_INT_24_8 };
+	static const GLenum compressed_formats[8] = { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+		GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_RGBA_BPTC_UNORM, GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC };
+	GLenum internal_format = GL_RGBA8, format = GL_RGBA, type = GL_UNSIGNED_BYTE;	// formats decoded on the CPU are uploaded as RGBA8
+	uint64_t compressed_size = 0;	// size of the data if it's uploaded compressed
+	uint8_t* decoded = 0;
+	if(!IS_COMPRESSED_TBO_FORMAT(tbo->format)) {
+		internal_format = internal_formats[tbo->format];
+		format = formats[tbo->format];
+		type = types[tbo->format];
+	} else if(!IS_DECODED_TBO_FORMAT(tbo->format)) {
+		internal_format = compressed_formats[tbo->format-14];
+		compressed_size = tbo_data_size(tbo->format, width, height);
+	} else {
+		decoded = malloc((uint64_t)width*height*4);
+		decode_compressed_texture(tbo->format, width, height, data, decoded);
+		data = decoded;
+	}
+
+	if(define_level && level == 0 && tbo->immutable) {
+		// immutable storage can't be resized; replace the GL texture (FBOs it is attached to keep the old one until reattached)
+		glDeleteTextures(1, &tbo->gl_buffer);
+		gl_state_invalidate();	// deleting unbinds the texture and frees its name for reuse
+		glGenTextures(1, &tbo->gl_buffer);
+		tbo->immutable = 0;
+	}
+	gl_bind_texture(0, tbo->gl_buffer);
+	gl_active_texture(0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if(define_level && level == 0) {	// new level 0; allocate the whole chain
+		set_tbo_level_chain(tbo, width, height);
+		tbo->n_levels = 1;
+		if(gl_texture_storage) {
+			glTexStorage2D(GL_TEXTURE_2D, tbo->n_chain_levels, internal_format, width, height);
+			tbo->immutable = 1;
 		}
-	} else return;
-	tbo->n_levels++;
+	} else if(level == tbo->n_levels) tbo->n_levels++;
+	if(define_level && !tbo->immutable) {	// level gets new dimensions; glTexImage2D
+		tbo->level_widths[level] = width;
+		tbo->level_heights[level] = height;
+		if(compressed_size) glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format, width, height, 0, compressed_size, data);
+		else glTexImage2D(GL_TEXTURE_2D, level, internal_format, width, height, 0, format, type, data);
+	} else if(compressed_size)	// level's storage already exists; glTexSubImage2D
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, internal_format, compressed_size, data);
+	else glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, format, type, data);
+	free(decoded);
+	return 1;
+}
+
+// generates the levels after level 0 of a TBO from it
+void generate_tbo_mipmaps(tbo_t* tbo) {
+	if(tbo->format == 12 || tbo->format == 13) return;	// if depth or depth + stencil texture, do nothing
+	if(IS_COMPRESSED_TBO_FORMAT(tbo->format)) return;	// GL can't render to compressed formats; their levels must each be uploaded
+	if(tbo->n_levels == 0) return;	// level 0 has not been uploaded to
+	gl_bind_texture(0, tbo->gl_buffer);
+	gl_active_texture(0);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	set_tbo_level_chain(tbo, tbo->level_widths[0], tbo->level_heights[0]);	// levels given other dimensions are regenerated with the chain's
+	tbo->n_levels = tbo->n_chain_levels;
 }
 
 typedef struct fbo_t {
@@ -2129,6 +3036,9 @@ typedef struct fbo_t {
 typedef struct ubo_t {
 	uint8_t* data;
 	uint64_t size;
+	GLuint gl_buffers[2];	// GL uniform buffers holding data repacked to std140; one for the vertex/compute shader's block layout, one for the pixel shader's (0 if not created)
+	uint64_t layout_keys[2];	// the block layout key (see ubo_layout_key) each GL uniform buffer was last packed for
+	uint8_t dirty;	// bits set when data changes (bit 0 for gl_buffers[0], bit 1 for gl_buffers[1]); cleared once the GL uniform buffer is repacked
 } ubo_t;
 
 typedef struct dbo_t {
@@ -2153,11 +3063,17 @@ typedef struct vid_data_t {
 	uint32_t n_frames;
 	uint32_t width;
 	uint32_t height;
+	uint32_t frame_rate;
+	uint32_t n_decode_jobs;	// decodes of its frames in progress on the image decode pool (frames are 0 until decoded)
+	FILE* frames_file;	// raw frame container the frames are read from when first used (frames are 0 until then); 0 if none
+	uint64_t frames_offset;	// offset of frame 0 in frames_file
 } vid_data_t;
 
 typedef struct object_t {
 	cbo_t cbo;
 	GLint gl_buffer;	// a GL buffer object that doesn't have a dedicated structre for storing additional information; VBO, IBO, VAO
+	uint8_t* buffer_data;	// VBO, IBO; copy of the GL buffer's data, so mapping the buffer doesn't need to read it back from GL
+	uint64_t buffer_size;	// VBO, IBO; size of the GL buffer
 	tbo_t tbo;
 	sbo_t sbo;
 	vao_t vao;
@@ -2222,7 +3138,7 @@ uint8_t check_segfault(thread_t* thread, uint64_t address, uint64_t n_bytes) {
 // updates a thread's "current file stream is open" bit in the SR
 void update_stream_open(thread_t* thread) {
 	uint16_t stream_id = (thread->regs[13] & 0xFFFF0000000ull)>>28;
-	if(stream_id && thread->file_streams[stream_id-1]) thread->regs[13] |= 0x4000000;
+	if(stream_id && stream_id <= 65534 && thread->file_streams[stream_id-1]) thread->regs[13] |= 0x4000000;
 	else thread->regs[13] &= (~0x4000000ull);
 }
 
@@ -2278,17 +3194,15 @@ uint64_t read_main_mem_val(thread_t* thread, uint64_t address, uint8_t n_bytes)
 	return value;
 }
 
-// reads bytes from main memory and returns an allocated block of all data. make sure to call check_segfault on the read region first.
-// returns a pointer to the read memory
-uint8_t* read_main_mem(thread_t* thread, uint64_t address, uint64_t n_bytes) {
-	if(n_bytes == 0) return 0;
-	uint8_t* data = calloc(1,n_bytes);
+// copies n_bytes of main memory at address into data. make sure to call check_segfault on the region being read first.
+void read_main_mem_into(thread_t* thread, uint64_t address, uint64_t n_bytes, uint8_t* data) {
+	if(n_bytes == 0) return;
 	uint64_t bytes_read = 0;
 	uint32_t current_segment = 0;
 	uint64_t max_address = address + n_bytes - 1;
 	if(!thread->segtable_id && thread->id == 0) {
 		memcpy(data, memory+address, n_bytes);
-		return data;
+		return;
 	}
 	while(bytes_read != n_bytes) {
 		if(current_segment >= objects[thread->segtable_id-1].segtable.n_segments) break;
@@ -2307,6 +3221,14 @@ uint8_t* read_main_mem(thread_t* thread, uint64_t address, uint64_t n_bytes) {
 		}	
 		current_segment++;
 	}
+}
+
+// reads bytes from main memory and returns an allocated block of all data. make sure to call check_segfault on the read region first.
+// returns a pointer to the read memory
+uint8_t* read_main_mem(thread_t* thread, uint64_t address, uint64_t n_bytes) {
+	if(n_bytes == 0) return 0;
+	uint8_t* data = calloc(1,n_bytes);
+	read_main_mem_into(thread, address, n_bytes, data);
 	return data;
 }
 
@@ -2385,6 +3307,64 @@ void write_main_mem(thread_t* thread, uint64_t address, uint8_t* data, uint64_t
 	}
 }
 
+// returns the current file stream of a thread; 0 if there's none or it isn't open
+file_stream_t* get_current_file_stream(thread_t* thread) {
+	uint16_t stream_id = (thread->regs[13] & 0xFFFF0000000)>>28;
+	if(!stream_id || stream_id > 65534) return 0;
+	return thread->file_streams[stream_id-1];
+}
+
+// returns the size of a file stream's file, reading it again if it may have changed (or if reread is set)
+uint64_t get_file_stream_size(file_stream_t* stream, uint8_t reread) {
+	if(stream->size_epoch != file_size_epoch || reread) {
+		struct stat stat_buf;
+		stream->size = fstat(fileno(stream->file), &stat_buf) == 0 ? stat_buf.st_size : 0;
+		stream->size_epoch = file_size_epoch;
+	}
+	return stream->size;
+}
+
+// checks that n_bytes starting at offset are within a file stream's file; the file could have grown since its size was read, so it's read again
+// before failing
+uint8_t check_file_stream_range(file_stream_t* stream, uint64_t offset, uint64_t n_bytes) {
+	uint64_t size = get_file_stream_size(stream, 0);
+	if(n_bytes <= size && offset <= size - n_bytes) return 1;
+	size = get_file_stream_size(stream, 1);
+	return n_bytes <= size && offset <= size - n_bytes;
+}
+
+// reads n_bytes of a file stream's file starting at offset straight into main memory at address (or writes them from main memory, if write is set),
+// one segment at a time. make sure to call check_segfault on the region first.
+void file_stream_main_mem_io(thread_t* thread, file_stream_t* stream, uint64_t address, uint64_t n_bytes, uint64_t offset, uint8_t write) {
+	int32_t fd = fileno(stream->file);
+	uint64_t max_address = address + n_bytes - 1;
+	uint32_t n_segments = !thread->segtable_id && thread->id == 0 ? 1 : objects[thread->segtable_id-1].segtable.n_segments;
+	for(uint32_t i = 0; i < n_segments; i++) {
+		uint8_t* a = memory+address;
+		uint64_t start = address, n = n_bytes;	// the part of the address range in this segment
+		if(thread->segtable_id || thread->id != 0) {
+			segment_t* segment = &objects[thread->segtable_id-1].segtable.segments[i];
+			if(segment->deleted) continue;
+			uint64_t seg_end = segment->v_address + segment->length - 1;
+			uint64_t min_end = max_address < seg_end ? max_address : seg_end;
+			start = address > segment->v_address ? address : segment->v_address;
+			if(min_end < start) continue;	// segment does not include any bytes in the address range
+			n = min_end-start+1;
+			a = memory+segment->p_address+(start-segment->v_address);
+		}
+		uint64_t file_offset = offset + (start-address);
+		while(n) {	// a regular file is only read/written partially at its end, or if interrupted
+			int64_t done = write ? pwrite(fd, a, n, file_offset) : pread(fd, a, n, file_offset);
+			if(done <= 0) {
+				if(done < 0 && errno == EINTR) continue;
+				stream->size_epoch = 0;	// the file was shrunk outside of the VM; read its size again next time
+				return;
+			}
+			a += done; file_offset += done; n -= done;
+		}
+	}
+}
+
 // binds a VBO + its associated VAO, creating a new one as necessary.
 void bind_vbo(vao_t* vao, uint64_t vbo_id) {
 	object_t* vbo = &objects[vbo_id-1]; // assumes VBO object exists and is not deleted.
@@ -2392,7 +3372,7 @@ void bind_vbo(vao_t* vao, uint64_t vbo_id) {
 	// find existing VAO parallel to vbo_id, otherwise create a new VAO and bind that
 	for(uint32_t i = 0; i < vao->n_vaos; i++)
 		if(vao->vbo_ids[i] == vbo_id) {
-			glBindVertexArray(vao->gl_vao_ids[i]);
+			gl_bind_vertex_array(vao->gl_vao_ids[i]);
 			return;
 		}
 	vao->gl_vao_ids = realloc(vao->gl_vao_ids, sizeof(GLint)*(vao->n_vaos+1));
@@ -2401,7 +3381,7 @@ void bind_vbo(vao_t* vao, uint64_t vbo_id) {
 
 	GLint gl_id = 0;
 	glGenVertexArrays(1,&gl_id);
-	glBindVertexArray(gl_id);
+	gl_bind_vertex_array(gl_id);
 	vao->gl_vao_ids[vao->n_vaos] = gl_id;
 	for(uint32_t i = 0; i < vao->n_attribs; i++) {
 		glEnableVertexAttribArray(vao->ids[i]);
@@ -2447,81 +3427,77 @@ uint8_t check_undefined_behavior(cbo_t* cbo, pipeline_t* pipeline) {
 	return 0;
 }
 
+// maps a rasterization pipeline's states to GL state, so that binding the pipeline needs no translation
+void build_pipeline_gl_state(pipeline_t* pipeline) {
+	static const GLenum compare_funcs[8] = { GL_ALWAYS, GL_NEVER, GL_LESS, GL_LEQUAL, GL_GREATER, GL_GEQUAL, GL_EQUAL, GL_NOTEQUAL };
+	static const GLenum stencil_ops[8] = { GL_KEEP, GL_ZERO, GL_REPLACE, GL_INCR, GL_DECR, GL_INCR_WRAP, GL_DECR_WRAP, GL_INVERT };
+	static const GLenum blend_ops[5] = { GL_FUNC_ADD, GL_FUNC_SUBTRACT, GL_FUNC_REVERSE_SUBTRACT, GL_MIN, GL_MAX };
+	static const GLenum blend_facs[10] = { GL_ONE, GL_ZERO, GL_SRC_COLOR, GL_DST_COLOR, GL_SRC_ALPHA, GL_DST_ALPHA,
+		GL_ONE_MINUS_SRC_COLOR, GL_ONE_MINUS_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA, GL_ONE_MINUS_DST_ALPHA };
+	static const GLenum cull_faces[4] = { GL_BACK, GL_FRONT, GL_BACK, GL_FRONT_AND_BACK };	// GL's default when culling is disabled
+	gl_raster_state_t* state = &pipeline->gl_state;
+	state->n_draw_buffers = pipeline->n_enabled_attachments+1;
+	state->cull_enabled = pipeline->culled_winding != 0;
+	state->cull_face = cull_faces[pipeline->culled_winding];
+	state->depth_mask = pipeline->depth_enabled;
+	state->depth_func = compare_funcs[pipeline->depth_pass];
+	state->stencil_funcs[0] = compare_funcs[pipeline->cw_stencil_pass] | (uint64_t)pipeline->cw_stencil_ref << 32 | (uint64_t)pipeline->cw_stencil_func_mask << 40;
+	state->stencil_funcs[1] = compare_funcs[pipeline->ccw_stencil_pass] | (uint64_t)pipeline->ccw_stencil_ref << 32 | (uint64_t)pipeline->ccw_stencil_func_mask << 40;
+	state->stencil_write_masks[0] = pipeline->cw_stencil_write_mask;
+	state->stencil_write_masks[1] = pipeline->ccw_stencil_write_mask;
+	state->stencil_ops[0] = stencil_ops[pipeline->cw_stencil_op_sfail] | (uint64_t)stencil_ops[pipeline->cw_stencil_op_spass_dfail] << 16
+		| (uint64_t)stencil_ops[pipeline->cw_stencil_op_sfail_dfail] << 32;
+	state->stencil_ops[1] = stencil_ops[pipeline->ccw_stencil_op_sfail] | (uint64_t)stencil_ops[pipeline->ccw_stencil_op_spass_dfail] << 16
+		| (uint64_t)stencil_ops[pipeline->ccw_stencil_op_sfail_dfail] << 32;
+	state->color_mask = pipeline->color_write_mask;
+	state->blend_enabled = !(pipeline->src_color_blend_fac == 0 && pipeline->dst_color_blend_fac == 1
+		&& pipeline->src_alpha_blend_fac == 0 && pipeline->dst_alpha_blend_fac == 1); // src factor 1 and dst factor 0 = no blending
+	state->blend_equations = blend_ops[pipeline->color_blend_op] | (uint64_t)blend_ops[pipeline->alpha_blend_op] << 16;
+	state->blend_funcs = blend_facs[pipeline->src_color_blend_fac] | (uint64_t)blend_facs[pipeline->dst_color_blend_fac] << 16
+		| (uint64_t)blend_facs[pipeline->src_alpha_blend_fac] << 32 | (uint64_t)blend_facs[pipeline->dst_alpha_blend_fac] << 48;
+}
+
+// sets the GL state for a rasterization pipeline; only state that differs from the shadowed GL state is issued
 void gl_set_pipeline_state(pipeline_t* pipeline) {
-	GLenum attachments[8];
-	for(uint32_t i = 1; i < 8; i++) attachments[i] = GL_NONE;
-	for(uint32_t i = 0; i <= pipeline->n_enabled_attachments; i++) attachments[i] = GL_COLOR_ATTACHMENT0+i;
-	glDrawBuffers(pipeline->n_enabled_attachments+1, attachments);
-	glFrontFace(GL_CW);
-	if(pipeline->culled_winding) glEnable(GL_CULL_FACE);
-	switch(pipeline->culled_winding) {
-		case 0: glDisable(GL_CULL_FACE); break;
-		case 1: glCullFace(GL_FRONT); break;
-		case 2: glCullFace(GL_BACK);  break;
-		case 3: glCullFace(GL_FRONT_AND_BACK); break; 
-	}
-	if(pipeline->depth_enabled) glDepthMask(GL_TRUE);
-	else glDepthMask(GL_FALSE);
-	glEnable(GL_DEPTH_TEST);
-	switch(pipeline->depth_pass) {
-		case 0: glDepthFunc(GL_ALWAYS);  break; case 1: glDepthFunc(GL_NEVER);  break;
-		case 2: glDepthFunc(GL_LESS);    break; case 3: glDepthFunc(GL_LEQUAL); break;
-		case 4: glDepthFunc(GL_GREATER); break; case 5: glDepthFunc(GL_GEQUAL); break;
-		case 6: glDepthFunc(GL_EQUAL);   break; case 7: glDepthFunc(GL_NOTEQUAL); break;
-	}
-	GLenum func;
-	switch(pipeline->cw_stencil_pass) {
-		case 0: func = GL_ALWAYS; break; case 1: func = GL_NEVER;   break; case 2: func = GL_LESS; break;
-		case 3: func = GL_LEQUAL; break; case 4: func = GL_GREATER; break; case 5: func = GL_GEQUAL; break;
-		case 6: func = GL_EQUAL;  break; case 7: func = GL_NOTEQUAL; break;
-	}
-	glStencilFuncSeparate(GL_FRONT, func, pipeline->cw_stencil_ref, pipeline->cw_stencil_func_mask);
-	glStencilMaskSeparate(GL_FRONT, pipeline->cw_stencil_write_mask);
-	switch(pipeline->ccw_stencil_pass) {
-		case 0: func = GL_ALWAYS; break; case 1: func = GL_NEVER;   break; case 2: func = GL_LESS; break;
-		case 3: func = GL_LEQUAL; break; case 4: func = GL_GREATER; break; case 5: func = GL_GEQUAL; break;
-		case 6: func = GL_EQUAL;  break; case 7: func = GL_NOTEQUAL; break;
-	}
-	glStencilFuncSeparate(GL_BACK, func, pipeline->ccw_stencil_ref, pipeline->ccw_stencil_func_mask);
-	glStencilMaskSeparate(GL_BACK, pipeline->ccw_stencil_write_mask);
-	GLenum funcs[6];
-	uint8_t vals[6] = { pipeline->cw_stencil_op_sfail, pipeline->cw_stencil_op_spass_dfail, pipeline->cw_stencil_op_sfail_dfail,
-		pipeline->ccw_stencil_op_sfail, pipeline->ccw_stencil_op_spass_dfail, pipeline->ccw_stencil_op_sfail_dfail };
-	for(uint32_t i = 0; i < 6; i++) switch(vals[i]) {
-		case 0: funcs[i] = GL_KEEP;      break; case 1: funcs[i] = GL_ZERO;      break;
-		case 2: funcs[i] = GL_REPLACE;   break; case 3: funcs[i] = GL_INCR;      break;
-		case 4: funcs[i] = GL_DECR;      break; case 5: funcs[i] = GL_INCR_WRAP; break;
-		case 6: funcs[i] = GL_DECR_WRAP; break; case 7: funcs[i] = GL_INVERT;    break;
-	}
-	glStencilOpSeparate(GL_FRONT, funcs[0], funcs[1], funcs[2]);
-	glStencilOpSeparate(GL_BACK, funcs[3], funcs[4], funcs[5]);
-	glColorMask(pipeline->color_write_mask & 0x8 ? GL_TRUE : GL_FALSE,
-		pipeline->color_write_mask & 0x4 ? GL_TRUE : GL_FALSE,
-		pipeline->color_write_mask & 0x2 ? GL_TRUE : GL_FALSE,
-		pipeline->color_write_mask & 0x1 ? GL_TRUE : GL_FALSE);
-	if(pipeline->src_color_blend_fac == 0 && pipeline->dst_color_blend_fac == 1
-	&& pipeline->src_alpha_blend_fac == 0 && pipeline->dst_alpha_blend_fac == 1)
-		glDisable(GL_BLEND); // src factor 1 and dst factor 0 = no blending
-	else glEnable(GL_BLEND);
-	vals[0] = pipeline->color_blend_op; vals[1] = pipeline->alpha_blend_op;
-	for(uint32_t i = 0; i < 2; i++) switch(vals[i]) {
-		case 0: funcs[i] = GL_FUNC_ADD; break;
-		case 1: funcs[i] = GL_FUNC_SUBTRACT; break;
-		case 2: funcs[i] = GL_FUNC_REVERSE_SUBTRACT; break;
-		case 3: funcs[i] = GL_MIN; break;
-		case 4: funcs[i] = GL_MAX; break;
-	}
-	glBlendEquationSeparate(funcs[0], funcs[1]);
-	vals[0] = pipeline->src_color_blend_fac; vals[1] = pipeline->dst_color_blend_fac;
-	vals[2] = pipeline->src_alpha_blend_fac; vals[3] = pipeline->dst_alpha_blend_fac;
-	for(uint32_t i = 0; i < 4; i++) switch(vals[i]) {
-		case 0: funcs[i] = GL_ONE; break;			case 1: funcs[i] = GL_ZERO; break;
-		case 2: funcs[i] = GL_SRC_COLOR; break;		case 3: funcs[i] = GL_DST_COLOR; break;
-		case 4: funcs[i] = GL_SRC_ALPHA; break;		case 5: funcs[i] = GL_DST_ALPHA; break;
-		case 6: funcs[i] = GL_ONE_MINUS_SRC_COLOR; break;	case 7: funcs[i] = GL_ONE_MINUS_DST_COLOR; break;
-		case 8: funcs[i] = GL_ONE_MINUS_SRC_ALPHA; break;	case 9: funcs[i] = GL_ONE_MINUS_DST_ALPHA; break;
-	}
-	glBlendFuncSeparate(funcs[0], funcs[1], funcs[2], funcs[3]);
+	gl_raster_state_t* state = &pipeline->gl_state;
+	if(GL_STATE_CHANGED(front_face, GL_CW)) glFrontFace(GL_CW);
+	if(GL_STATE_CHANGED(depth_test_enabled, 1)) glEnable(GL_DEPTH_TEST);
+	if(!memcmp(&gl_state.raster, state, sizeof(gl_raster_state_t))) {	// same state as the last pipeline bound; counted as one skipped change
+		gl_calls_skipped++;
+		return;
+	}
+	if(GL_STATE_CHANGED(raster.n_draw_buffers, state->n_draw_buffers)) {
+		GLenum attachments[8];
+		for(uint32_t i = 0; i < 8; i++) attachments[i] = i < state->n_draw_buffers ? GL_COLOR_ATTACHMENT0+i : GL_NONE;
+		glDrawBuffers(state->n_draw_buffers, attachments);
+	}
+	if(GL_STATE_CHANGED(raster.cull_enabled, state->cull_enabled)) {
+		if(state->cull_enabled) glEnable(GL_CULL_FACE);
+		else glDisable(GL_CULL_FACE);
+	}
+	if(GL_STATE_CHANGED(raster.cull_face, state->cull_face)) glCullFace(state->cull_face);
+	if(GL_STATE_CHANGED(raster.depth_mask, state->depth_mask)) glDepthMask(state->depth_mask ? GL_TRUE : GL_FALSE);
+	if(GL_STATE_CHANGED(raster.depth_func, state->depth_func)) glDepthFunc(state->depth_func);
+	GLenum faces[2] = { GL_FRONT, GL_BACK };
+	for(uint32_t i = 0; i < 2; i++) {
+		uint64_t func = state->stencil_funcs[i], ops = state->stencil_ops[i];
+		if(GL_STATE_CHANGED(raster.stencil_funcs[i], func)) glStencilFuncSeparate(faces[i], func & 0xFFFF, (func >> 32) & 0xFF, (func >> 40) & 0xFF);
+		if(GL_STATE_CHANGED(raster.stencil_write_masks[i], state->stencil_write_masks[i])) glStencilMaskSeparate(faces[i], state->stencil_write_masks[i]);
+		if(GL_STATE_CHANGED(raster.stencil_ops[i], ops)) glStencilOpSeparate(faces[i], ops & 0xFFFF, (ops >> 16) & 0xFFFF, (ops >> 32) & 0xFFFF);
+	}
+	if(GL_STATE_CHANGED(raster.color_mask, state->color_mask))
+		glColorMask(state->color_mask & 0x8 ? GL_TRUE : GL_FALSE,
+			state->color_mask & 0x4 ? GL_TRUE : GL_FALSE,
+			state->color_mask & 0x2 ? GL_TRUE : GL_FALSE,
+			state->color_mask & 0x1 ? GL_TRUE : GL_FALSE);
+	if(GL_STATE_CHANGED(raster.blend_enabled, state->blend_enabled)) {
+		if(state->blend_enabled) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+	}
+	uint64_t equations = state->blend_equations, funcs = state->blend_funcs;
+	if(GL_STATE_CHANGED(raster.blend_equations, equations)) glBlendEquationSeparate(equations & 0xFFFF, (equations >> 16) & 0xFFFF);
+	if(GL_STATE_CHANGED(raster.blend_funcs, funcs))
+		glBlendFuncSeparate(funcs & 0xFFFF, (funcs >> 16) & 0xFFFF, (funcs >> 32) & 0xFFFF, (funcs >> 48) & 0xFFFF);
 }
 
 void gl_set_uniform(GLint loc, uint8_t data_type, uint16_t elcount, GLvoid* data) {
@@ -2550,122 +3526,318 @@ void gl_set_uniform(GLint loc, uint8_t data_type, uint16_t elcount, GLvoid* data
 	}
 }
 
+// returns whether or not a definition is a uniform within a uniform (data) block at set+binding
+#define IS_UBO_UNIFORM(def,s,b) ((def).def_type == UNIF_DEF_BIT && !(def).location_id && (def).data_type < 21 && (def).set == (s) && (def).binding == (b))
+
+// returns a key identifying the layout of the uniform block at set+binding (FNV-1a over the type and element count of each uniform)
+// blocks with equal keys have the same std140 data for the same UBO
+uint64_t ubo_layout_key(definition_t* defs, uint32_t n_defs, uint8_t set, uint32_t binding) {
+	uint64_t key = 0xCBF29CE484222325ull;
+	for(uint32_t d = 0; d < n_defs; d++) {
+		if(!IS_UBO_UNIFORM(defs[d], set, binding)) continue;
+		uint8_t bytes[3] = { defs[d].data_type, defs[d].elcount, defs[d].elcount >> 8 };
+		for(uint32_t i = 0; i < 3; i++) key = (key ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return key;
+}
+
+// packs UBO data (uniforms tightly packed in definition order) into the std140 layout of the uniform block at set+binding, and returns the std140 size
+// every uniform is declared as an array, so each element and each matrix column is padded to 16 bytes
+// if dst is 0 only the size is returned; dst should be zeroed, uniforms from the first one that doesn't fit in the UBO data onward are left as zero
+uint64_t pack_ubo_std140(definition_t* defs, uint32_t n_defs, uint8_t set, uint32_t binding, uint8_t* src, uint64_t src_size, uint8_t* dst) {
+	uint64_t src_offset = 0, dst_offset = 0;
+	uint8_t fits = 1;
+	for(uint32_t d = 0; d < n_defs; d++) {
+		if(!IS_UBO_UNIFORM(defs[d], set, binding)) continue;
+		uint8_t type = defs[d].data_type;
+		uint32_t n_columns = (type >= 9 && type < 18) ? MAT_WIDTH(type) : 1;
+		uint32_t column_size = 4*(type < 9 ? VEC_SIZE(type) : (type < 18 ? MAT_HEIGHT(type) : 1));
+		if(src_offset+(uint64_t)defs[d].elcount*n_columns*column_size > src_size)
+			fits = 0; // not enough data in UBO for this uniform
+		for(uint32_t i = 0; i < defs[d].elcount*n_columns; i++) {
+			if(dst && fits) memcpy(dst+dst_offset, src+src_offset, column_size);
+			src_offset += column_size;
+			dst_offset += 16;
+		}
+	}
+	return dst_offset;
+}
+
+// returns the index (= GL uniform buffer binding point) of the pipeline's uniform block at set+binding for a shader stage (0 = vertex/compute, 1 = pixel), or -1 if there isn't one
+int32_t get_ubo_block(pipeline_t* pipeline, uint8_t stage, uint8_t set, uint32_t binding) {
+	for(uint32_t i = 0; i < pipeline->n_ubo_blocks; i++)
+		if(pipeline->ubo_block_stages[i] == stage && pipeline->ubo_block_sets[i] == set && pipeline->ubo_block_bindings[i] == binding) return i;
+	return -1;
+}
+
+// returns the texture unit assigned to the pipeline's sampler array element at set+binding, or -1 if there isn't one
+int32_t get_texture_unit(pipeline_t* pipeline, uint8_t set, uint32_t binding, uint16_t element) {
+	for(uint32_t i = 0; i < pipeline->n_sampler_units; i++)
+		if(pipeline->sampler_unit_sets[i] == set && pipeline->sampler_unit_bindings[i] == binding && pipeline->sampler_unit_elements[i] == element) return i;
+	return -1;
+}
+
+// returns whether or not a definition is a variable within a storage block at set+binding
+#define IS_SBO_VARIABLE(def,s,b) ((def).def_type == VAR_DEF_BIT && (def).within_block && (def).set == (s) && (def).binding == (b))
+
+// returns a key identifying the layout of the storage block at set+binding (FNV-1a over the type and element count of each variable)
+uint64_t sbo_layout_key(definition_t* defs, uint32_t n_defs, uint8_t set, uint32_t binding) {
+	uint64_t key = 0xCBF29CE484222325ull;
+	for(uint32_t d = 0; d < n_defs; d++) {
+		if(!IS_SBO_VARIABLE(defs[d], set, binding)) continue;
+		uint8_t bytes[3] = { defs[d].data_type, defs[d].elcount, defs[d].elcount >> 8 };
+		for(uint32_t i = 0; i < 3; i++) key = (key ^ bytes[i]) * 0x100000001B3ull;
+	}
+	return key;
+}
+
+// copies SBO data (variables tightly packed in definition order, like UBO data) into the std430 layout of the storage block at set+binding, or back
+// out of it if unpack is set; returns the std430 size. every variable is declared as an array, so elements + matrix columns are 4, 8, or 16 bytes apart
+// (16 for 3 components); an unsized last variable gets as many elements as the rest of the SBO data holds. if packed is 0 only the size is returned
+uint64_t pack_sbo_std430(definition_t* defs, uint32_t n_defs, uint8_t set, uint32_t binding, uint8_t* data, uint64_t data_size, uint8_t* packed, uint8_t unpack) {
+	uint64_t src_offset = 0, dst_offset = 0;
+	for(uint32_t d = 0; d < n_defs; d++) {
+		if(!IS_SBO_VARIABLE(defs[d], set, binding)) continue;
+		uint8_t type = defs[d].data_type;
+		uint32_t n_columns = (type >= 9 && type < 18) ? MAT_WIDTH(type) : 1;
+		uint32_t column_size = 4*(type < 9 ? VEC_SIZE(type) : (type < 18 ? MAT_HEIGHT(type) : 1));
+		uint32_t stride = column_size == 12 ? 16 : column_size;
+		uint64_t n = (uint64_t)defs[d].elcount*n_columns;
+		if(!defs[d].elcount) n = src_offset < data_size ? (data_size-src_offset)/(n_columns*column_size)*n_columns : 0;
+		dst_offset = (dst_offset+stride-1)/stride*stride;	// arrays are aligned to their stride
+		for(uint64_t i = 0; i < n; i++) {
+			if(packed && src_offset+column_size <= data_size) {
+				if(unpack) memcpy(data+src_offset, packed+dst_offset, column_size);
+				else memcpy(packed+dst_offset, data+src_offset, column_size);
+			}
+			src_offset += column_size;
+			dst_offset += stride;
+		}
+	}
+	return dst_offset;
+}
+
+// returns the index (= GL shader storage buffer binding point) of the pipeline's storage block at set+binding, or -1 if there isn't one
+int32_t get_sbo_block(pipeline_t* pipeline, uint8_t set, uint32_t binding) {
+	for(uint32_t i = 0; i < pipeline->n_sbo_blocks; i++)
+		if(pipeline->sbo_block_sets[i] == set && pipeline->sbo_block_bindings[i] == binding) return i;
+	return -1;
+}
+
+// copies the std430 contents of an SBO's GL buffer back to its data if a compute dispatch may have written to it
+void read_back_sbo(sbo_t* sbo) {
+	if(!sbo->gpu_written) return;
+	sbo->gpu_written = 0;
+	uint8_t* packed = malloc(sbo->gl_size);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, sbo->gl_buffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sbo->gl_size, packed);
+	pack_sbo_std430(sbo->layout_defs, sbo->n_layout_defs, sbo->layout_set, sbo->layout_binding, sbo->data, sbo->size, packed, 1);
+	free(packed);
+}
+
 void upload_push_constants(definition_t* defs, uint32_t n_defs, pipeline_t* pipeline) {
-	if(!pipeline->n_push_constant_bytes) return;
+	if(!pipeline->n_push_constant_bytes || !pipeline->gl_program) return;
 	uint32_t offset = 0;
 	for(uint32_t d = 0; d < n_defs; d++) {
 		if(defs[d].def_type != UNIF_DEF_BIT || !defs[d].location_id) continue;	// not push constant
-		// use glGetUniformLocation to get the location of the uniform (the GL program has already been set as in use)
-		uint32_t id = defs[d].id;
-		char* glsl_id = calloc(1,1);
-		str_add(&glsl_id, "_");
-		str_add_ui(&glsl_id, id);
-		GLint loc = glGetUniformLocation(pipeline->gl_program, glsl_id);
-		free(glsl_id);
 		uint16_t elcount = defs[d].elcount;
-		// upload data for uniform using glUniform* functions
 		uint8_t type_size = 4;
 		if(defs[d].data_type < 9)
 			type_size *= VEC_SIZE(defs[d].data_type);
 		else if(defs[d].data_type < 18)
 			type_size *= MAT_SIZE(defs[d].data_type);
+		if(!defs[d].used) {	// never referenced by the shader; its declaration was left out of the GLSL
+			offset += type_size*elcount;
+			continue;
+		}
+		// use glGetUniformLocation to get the location of the uniform (the GL program has already been set as in use)
+		uint32_t id = defs[d].id;
+		str_t glsl_id;
+		str_init(&glsl_id, 16);
+		str_add(&glsl_id, "_");
+		str_add_ui(&glsl_id, id);
+		GLint loc = glGetUniformLocation(pipeline->gl_program, glsl_id.str);
+		free(glsl_id.str);
+		// upload data for uniform using glUniform* functions
 		if(loc >= 0) // OpenGL may remove uniforms that are unused; in that case, don't attempt to upload uniform data
 			gl_set_uniform(loc, defs[d].data_type, elcount, pipeline->push_constant_data + offset);
 		offset += type_size*elcount;
 	}
 }
 
-// read all descriptors in the descriptor set to upload all uniform data (glUniform*) and sampler data (glActiveTexture, glBindTexture)
-// there is also storage and acceleration structure descriptors, but they will not be handled here
+// read all descriptors in the descriptor set to bind all uniform data (glBindBufferRange), storage data (glBindBufferBase), and sampler data (glActiveTexture, glBindTexture)
+// there is also image and acceleration structure descriptors, but they will not be handled here
 // do this any time there's a new descriptor set bound, or for each accessible set bound when a new pipeline is bound
-void upload_descriptor_set_data(cbo_t* cbo, desc_set_t* dset, uint32_t set_num, uint32_t* textures_occupied, pipeline_t* pipeline) {
+void upload_descriptor_set_data(cbo_t* cbo, desc_set_t* dset, uint32_t set_num, pipeline_t* pipeline) {
 	for(uint32_t i = 0; i < dset->n_bindings+1; i++) { // for each binding point in the set
 		desc_binding_t* binding = &dset->bindings[i];	// current descriptor binding point
 		for(uint32_t desc = 0; desc < binding->n_descs; desc++) { // for each descriptor in current binding point
-			if(binding->object_ids[desc] == 0 || objects[binding->object_ids[desc]-1].deleted) continue; // if any descriptors are encountered that refer to non-existent or deleted objects, skip them and do nothing (undefined behavior)
+			if(binding->object_ids[desc] == 0 || objects[binding->object_ids[desc]-1].deleted) { // if any descriptors are encountered that refer to non-existent or deleted objects, skip them and do nothing (undefined behavior)
+				int32_t unit = get_texture_unit(pipeline, set_num, binding->binding_number, desc);
+				if(unit >= 0) gl_bind_texture(unit, 0);	// don't leave a previously bound set's texture at the sampler's unit
+				continue;
+			}
 			object_t* object = &objects[binding->object_ids[desc]-1]; // this is the object the descriptor refers to
+			if(object->type == TYPE_TBO) {
+				// texture units are assigned to the pipeline's samplers when it is created, so rebinding the same textures issues nothing
+				int32_t unit = get_texture_unit(pipeline, set_num, binding->binding_number, desc);
+				if(unit < 0) continue; // sampler w/ equivalent set/binding/element not found (or removed as unused), skip
+				gl_bind_texture(unit, object->tbo.gl_buffer);	// bind texture
+				if(gl_sampler_objects && binding->min_filters[desc] < 6 && binding->mag_filters[desc] < 2 && binding->s_modes[desc] < 3 && binding->t_modes[desc] < 3) {
+					// bind the shared GL sampler object for the sampler descriptor's filtering modes
+					gl_bind_sampler(unit, get_gl_sampler(binding->min_filters[desc], binding->mag_filters[desc], binding->s_modes[desc], binding->t_modes[desc]));
+					continue;
+				}
+
+				// no sampler objects; set texture filtering modes (from sampler descriptor) on the texture, skip any the texture already has
+				GLint params[4] = { 0, 0, 0, 0 };
+				switch(binding->min_filters[desc]) {
+					case 0: params[0] = GL_NEAREST; break;
+					case 1: params[0] = GL_LINEAR; break;
+					case 2: params[0] = GL_NEAREST_MIPMAP_NEAREST; break;
+					case 3: params[0] = GL_LINEAR_MIPMAP_NEAREST; break;
+					case 4: params[0] = GL_NEAREST_MIPMAP_LINEAR; break;
+					case 5: params[0] = GL_LINEAR_MIPMAP_LINEAR; break;
+				}
+				switch(binding->mag_filters[desc]) {
+					case 0: params[1] = GL_NEAREST; break;
+					case 1: params[1] = GL_LINEAR; break;
+				}
+				switch(binding->s_modes[desc]) {
+					case 0: params[2] = GL_CLAMP_TO_EDGE; break;
+					case 1: params[2] = GL_MIRRORED_REPEAT; break;
+					case 2: params[2] = GL_REPEAT; break;
+				}
+				switch(binding->t_modes[desc]) {
+					case 0: params[3] = GL_CLAMP_TO_EDGE; break;
+					case 1: params[3] = GL_MIRRORED_REPEAT; break;
+					case 2: params[3] = GL_REPEAT; break;
+				}
+				GLenum param_names[4] = { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T };
+				for(uint32_t p = 0; p < 4; p++) {
+					if(!params[p]) continue;
+					if(object->tbo.tex_params[p] == params[p]) { gl_calls_skipped++; continue; }
+					gl_active_texture(unit);
+					glTexParameteri(GL_TEXTURE_2D, param_names[p], params[p]);
+					object->tbo.tex_params[p] = params[p];
+					gl_calls_issued++;
+				}
+				continue;
+			}
+			if(object->type == TYPE_SBO) {
+				int32_t block = get_sbo_block(pipeline, set_num, binding->binding_number);
+				if(block < 0 || !object->sbo.data) continue; // storage block w/ equivalent set/binding not found (or removed by OpenGL as unused), or no SBO data, skip
+				sbo_t* sbo = &object->sbo;
+				uint64_t key = pipeline->sbo_block_keys[block];
+				if(!sbo->gl_buffer) {
+					glGenBuffers(1, &sbo->gl_buffer);
+					sbo->dirty = 1;
+				}
+				if(sbo->dirty || sbo->layout_key != key) { // only repack + upload if the SBO changed or was packed for a different layout
+					read_back_sbo(sbo);	// keep the results of dispatches that used the previous layout
+					uint64_t size = pack_sbo_std430(pipeline->defs_1, pipeline->n_defs_1, set_num, binding->binding_number, sbo->data, sbo->size, 0, 0);
+					uint8_t* packed = calloc(1, size ? size : 16);
+					pack_sbo_std430(pipeline->defs_1, pipeline->n_defs_1, set_num, binding->binding_number, sbo->data, sbo->size, packed, 0);
+					glBindBuffer(GL_SHADER_STORAGE_BUFFER, sbo->gl_buffer);
+					glBufferData(GL_SHADER_STORAGE_BUFFER, size ? size : 16, packed, GL_DYNAMIC_COPY);
+					free(packed);
+					sbo->gl_size = size;
+					sbo->layout_key = key;
+					sbo->layout_defs = pipeline->defs_1;
+					sbo->n_layout_defs = pipeline->n_defs_1;
+					sbo->layout_set = set_num;
+					sbo->layout_binding = binding->binding_number;
+					sbo->dirty = 0;
+				}
+				glBindBufferBase(GL_SHADER_STORAGE_BUFFER, block, sbo->gl_buffer);
+				sbo->gpu_written = 1;	// the data is read back from the GL buffer before it is next used outside of shaders
+				continue;
+			}
 			for(uint32_t loop = 0; loop < (pipeline->type != 2 ? 2 : 1); loop++) { // run twice if rasterization pipeline, once if compute pipeline
 				definition_t* defs = (loop == 0) ? pipeline->defs_1 : pipeline->defs_2;
 				uint32_t n_defs = (loop == 0) ? pipeline->n_defs_1 : pipeline->n_defs_2;
-				uint32_t ubo_offset = 0; // this is offset into the UBO if uploading uniform data (if a read exceeds the end of the UBO, skip the rest)
-				if(object->type == TYPE_TBO) {
-					for(uint32_t d = 0; d < n_defs; d++) { // find shader definition with equal set + binding as this sampler descriptor
-						int32_t id = -1;
-						if(defs[d].data_type >= 21 && defs[d].set == set_num && defs[d].binding == binding->binding_number)
-							id = defs[d].id;
-						if(id < 0) continue; // sampler definition w/ equivalent set/binding not found, skip
-						// use glGetUniformLocation to get the location of the uniform (the GL program has already been set as in use)
-						char* glsl_id = calloc(1,1);
-						str_add(&glsl_id, "_");
-						str_add_ui(&glsl_id, id);
-						str_add(&glsl_id, "[");
-						str_add_ui(&glsl_id, desc);
-						str_add(&glsl_id, "]");
-						GLint loc = glGetUniformLocation(pipeline->gl_program, glsl_id);
-						free(glsl_id);
-						if(loc < 0) continue; // OpenGL may remove unused samplers
-
-						// go through textures_occupied to find the first available texture unit (0)
-						uint32_t unit;
-						for(unit = 0; unit < max_number_samplers && textures_occupied[unit]; unit++);
-						textures_occupied[unit] = set_num+1;
-						glUniform1i(loc,textures_occupied[unit]-1);	// set the sampler's texture unit
-						glActiveTexture(GL_TEXTURE0+textures_occupied[unit]-1);	// set the active texture unit
-						glBindTexture(GL_TEXTURE_2D, object->tbo.gl_buffer);	// bind texture
-
-						// set texture filtering modes (from sampler descriptor)
-						switch(binding->min_filters[desc]) {
-							case 0: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); break;
-							case 1: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); break;
-							case 2: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST); break;
-							case 3: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST); break;
-							case 4: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR); break;
-							case 5: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); break;
-						}
-						switch(binding->mag_filters[desc]) {
-							case 0: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); break;
-							case 1: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); break;
-						}
-						switch(binding->s_modes[desc]) {
-							case 0: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
-							case 1: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT); break;
-							case 2: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); break;
-						}
-						switch(binding->t_modes[desc]) {
-							case 0: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); break;
-							case 1: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT); break;
-							case 2: glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); break;
-						}
+				if(object->type == TYPE_UBO) {
+					int32_t block = get_ubo_block(pipeline, loop, set_num, binding->binding_number);
+					if(block < 0) continue; // uniform block w/ equivalent set/binding not found (or removed by OpenGL as unused), skip
+					uint64_t key = pipeline->ubo_block_keys[block];
+					uint8_t slot = loop;
+					if(loop == 1 && object->ubo.gl_buffers[0] && !(object->ubo.dirty & 1) && object->ubo.layout_keys[0] == key)
+						slot = 0; // pixel shader block has the same layout as the vertex shader block; share its GL uniform buffer
+					if(!object->ubo.gl_buffers[slot]) {
+						glGenBuffers(1, &object->ubo.gl_buffers[slot]);
+						object->ubo.dirty |= 1 << slot;
 					}
-				} else if(object->type == TYPE_UBO) {
-					for(uint32_t d = 0; d < n_defs; d++) {
-						int32_t id = -1;
-						if(defs[d].def_type == UNIF_DEF_BIT && !defs[d].location_id && defs[d].data_type < 21 && defs[d].set == set_num && defs[d].binding == binding->binding_number)
-							id = defs[d].id;
-						if(id < 0) continue; // uniform definition w/ equivalent set/binding not found, skip
-						// use glGetUniformLocation to get the location of the uniform (the GL program has already been set as in use)
-						char* glsl_id = calloc(1,1);
-						str_add(&glsl_id, "_");
-						str_add_ui(&glsl_id, id);
-						GLint loc = glGetUniformLocation(pipeline->gl_program, glsl_id);
-						free(glsl_id);
-						uint16_t elcount = defs[d].elcount;
-						// upload data for uniform using glUniform* functions
-						uint8_t type_size = 4; // get the size of each uniform element
-						if(defs[d].data_type < 9)		type_size *= VEC_SIZE(defs[d].data_type);
-						else if(defs[d].data_type < 18)	type_size *= MAT_SIZE(defs[d].data_type);
-						if(ubo_offset+elcount*type_size > object->ubo.size)
-							break; // can't upload uniform; not enough data in UBO
-						if(loc >= 0) // OpenGL may remove uniforms that are unused; in that case, don't attempt to upload uniform data
-							gl_set_uniform(loc, defs[d].data_type, elcount, object->ubo.data+ubo_offset);
-						ubo_offset += type_size*elcount;
+					if((object->ubo.dirty & (1 << slot)) || object->ubo.layout_keys[slot] != key) { // only repack + upload if the UBO changed or was packed for a different layout
+						uint8_t* data = calloc(1, pipeline->ubo_block_sizes[block]);
+						pack_ubo_std140(defs, n_defs, set_num, binding->binding_number, object->ubo.data, object->ubo.size, data);
+						glBindBuffer(GL_UNIFORM_BUFFER, object->ubo.gl_buffers[slot]);
+						glBufferData(GL_UNIFORM_BUFFER, pipeline->ubo_block_sizes[block], data, GL_DYNAMIC_DRAW);
+						free(data);
+						object->ubo.layout_keys[slot] = key;
+						object->ubo.dirty &= ~(1 << slot);
 					}
+					glBindBufferRange(GL_UNIFORM_BUFFER, block, object->ubo.gl_buffers[slot], 0, pipeline->ubo_block_sizes[block]);
 				}
 			}
 		}
 	}
 }
 
+// consecutive non-instanced draws replayed from a command buffer are merged into one glMultiDrawArrays/glMultiDrawElements call
+typedef struct draw_batch_t {
+	GLint* firsts;		// first vertex of each non-indexed draw
+	GLsizei* counts;	// number of vertices/indices of each draw
+	GLvoid** offsets;	// IBO byte offset of the first index of each indexed draw
+	uint32_t n_draws;
+	uint32_t capacity;	// number of draws the arrays have room for
+	uint8_t is_indexed;
+	GLenum p_type;
+} draw_batch_t;
+
+draw_batch_t draw_batch;
+
+// issues all draws in the batch; must be done before any GL state used by the draws changes
+void flush_draw_batch(draw_batch_t* batch) {
+	if(!batch->n_draws) return;
+	if(batch->n_draws == 1 && !batch->is_indexed) glDrawArrays(batch->p_type, batch->firsts[0], batch->counts[0]);
+	else if(batch->n_draws == 1) glDrawElements(batch->p_type, batch->counts[0], GL_UNSIGNED_INT, batch->offsets[0]);
+	else if(!batch->is_indexed) glMultiDrawArrays(batch->p_type, batch->firsts, batch->counts, batch->n_draws);
+	else glMultiDrawElements(batch->p_type, batch->counts, GL_UNSIGNED_INT, (const GLvoid* const*)batch->offsets, batch->n_draws);
+	batch->n_draws = 0;
+}
+
+// adds a draw to the batch; instanced draws can't be merged and are issued immediately (after flushing the batch to keep draw order)
+void batch_draw(draw_batch_t* batch, GLenum p_type, uint8_t is_indexed, uint32_t start_idx, uint32_t n_indices, uint32_t n_instances) {
+	if(n_instances > 1) {
+		flush_draw_batch(batch);
+		if(!is_indexed) glDrawArraysInstanced(p_type, start_idx, n_indices, n_instances);
+		else glDrawElementsInstanced(p_type, n_indices, GL_UNSIGNED_INT, (GLvoid*)((uint64_t)start_idx*4), n_instances);
+		return;
+	}
+	if(batch->n_draws && (batch->is_indexed != is_indexed || batch->p_type != p_type)) flush_draw_batch(batch);
+	batch->is_indexed = is_indexed;
+	batch->p_type = p_type;
+	if(batch->n_draws) { // a draw continuing the range of the previous draw (whole primitives only) is drawn by extending the previous one
+		uint32_t last = batch->n_draws-1;
+		uint32_t prim_size = p_type == GL_TRIANGLES ? 3 : (p_type == GL_LINES ? 2 : 1);
+		uint64_t end = is_indexed ? (uint64_t)batch->offsets[last]/4+batch->counts[last] : (uint64_t)batch->firsts[last]+batch->counts[last];
+		if(end == start_idx && batch->counts[last] % prim_size == 0 && (uint64_t)batch->counts[last]+n_indices <= INT32_MAX) {
+			batch->counts[last] += n_indices;
+			return;
+		}
+	}
+	if(batch->n_draws == batch->capacity) {
+		batch->capacity = batch->capacity ? batch->capacity*2 : 64;
+		batch->firsts = realloc(batch->firsts, sizeof(GLint)*batch->capacity);
+		batch->counts = realloc(batch->counts, sizeof(GLsizei)*batch->capacity);
+		batch->offsets = realloc(batch->offsets, sizeof(GLvoid*)*batch->capacity);
+	}
+	batch->firsts[batch->n_draws] = start_idx;
+	batch->counts[batch->n_draws] = n_indices;
+	batch->offsets[batch->n_draws] = (GLvoid*)((uint64_t)start_idx*4);
+	batch->n_draws++;
+}
+
 // executes all the commands in a command buffer
 void submit_cmds(cbo_t* cbo) {
 	if(cbo->pipeline_type == 2) return;	// cmd buffer never had a pipeline binding command recorded to it
@@ -2683,9 +3855,9 @@ void submit_cmds(cbo_t* cbo) {
 			if(fbo_object->deleted) return;	// the FBO bound to the command buffer being submitted has previously been deleted
 			fbo = &fbo_object->fbo;
 			if(fbo->width == 0 || fbo->height == 0) return;	// there are no attachments for this FBO
-			glBindFramebuffer(GL_FRAMEBUFFER, fbo->gl_buffer);
+			gl_bind_framebuffer(fbo->gl_buffer);
 		}
-		else glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		else gl_bind_framebuffer(0);
 	}
 	// RESETTING THE COMMAND BUFFER WILL CLEAR THE PIPELINE TYPE
 
@@ -2695,30 +3867,34 @@ void submit_cmds(cbo_t* cbo) {
 	pipeline_t* pipeline = 0;	// the currently bound pipeline
 	uint8_t* cmds = cbo->cmds;
 	uint8_t undefined_behavior = 0; // whether or not there is undefined behavior based on current set binding layouts for bound pipeline + currently bound sets
-	uint32_t textures_occupied[max_number_samplers]; // for the current pipeline, records the set binding for each sampler bound to a texture unit
 	vao_t* current_vao = 0;
+	GLenum p_type = GL_TRIANGLES;	// primitive type of the bound pipeline
 	while(cmds < (uint8_t*)cbo->cmds+cbo->size) {
 		uint64_t id, is_indexed, n_indices, n_instances, start_idx, offset, n_bytes;
+		uint32_t n_groups[3];
 		uint8_t set, attachments;
-		GLenum p_type;
+		if(*cmds != 92 && *cmds != 93) flush_draw_batch(&draw_batch); // draws batched so far must be issued before any other command
 		switch(*cmds) {	// opcode
 			case 77:	// bind a pipeline
 				cbo->bindings[0] = *(uint64_t*)(cmds+1);	// set, for the CBO, the bound pipeline ID
 				cmds += 9;
-				for(uint32_t i = 0; i < max_number_samplers; i++) textures_occupied[i] = 0;
 				// bindings are bound object IDs for the command buffer: bindings[0] = pipeline object, bindings[1] = FBO, bindings[2] = VBO, bindings[3] = IBO
 				object_t* pipeline_object = &objects[cbo->bindings[0]-1];
+				void update_pending_pipeline(uint64_t id, uint8_t wait);
+				update_pending_pipeline(cbo->bindings[0], 1);	// a pending pipeline must finish being created before it is used
 				if(pipeline_object->deleted) break;	// the pipeline bound to the command buffer being submitted has previously been deleted
 				pipeline = &pipeline_object->pipeline;	// known to not be a ray tracing pipeline; ray tracing pipeline binds are not recorded
 				undefined_behavior = check_undefined_behavior(cbo, pipeline);
-				object_t* vao_object = &objects[pipeline->vao_id-1];
-				if(vao_object->deleted) return;
-				current_vao = &vao_object->vao;
-				glUseProgram(pipeline->gl_program);
+				if(pipeline->type == 0) {	// compute pipelines have no VAO
+					object_t* vao_object = &objects[pipeline->vao_id-1];
+					if(vao_object->deleted) return;
+					current_vao = &vao_object->vao;
+				}
+				gl_use_program(pipeline->gl_program);	// 0 for a compute pipeline without GL compute support
 				// upload all descriptor set data for all accessible descriptor sets
 				for(uint32_t i = 0; i < pipeline->n_desc_sets; i++) {
 					if(cbo->dset_ids[i] == 0 || objects[cbo->dset_ids[i]-1].deleted) continue; // do not account for descriptor sets which have not been bound
-					upload_descriptor_set_data(cbo, &objects[cbo->dset_ids[i]-1].dset, i, textures_occupied, pipeline);
+					upload_descriptor_set_data(cbo, &objects[cbo->dset_ids[i]-1].dset, i, pipeline);
 				}
 				switch(pipeline->primitive_type) {
 					case 0: p_type = GL_TRIANGLES; break;
@@ -2733,7 +3909,7 @@ void submit_cmds(cbo_t* cbo) {
 				if(pipeline->n_push_constant_bytes)	pipeline->push_constant_data = calloc(1,pipeline->n_push_constant_bytes);
 				upload_push_constants(pipeline->defs_1, pipeline->n_defs_1, pipeline);
 				upload_push_constants(pipeline->defs_2, pipeline->n_defs_2, pipeline);
-				gl_set_pipeline_state(pipeline);
+				if(pipeline->type == 0) gl_set_pipeline_state(pipeline);
 				break;
 			case 79:	// bind a descriptor set to a set in the bound pipeline, or VBO/IBO within the bound command buffer
 				id = *(uint64_t*)(cmds+1);
@@ -2748,17 +3924,10 @@ void submit_cmds(cbo_t* cbo) {
 					cbo->bindings[3] = id;
 					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->gl_buffer);
 				} else if(object->type == TYPE_DSET) {	// descriptor set bind
-					for(uint32_t i = 0; i < max_number_samplers; i++)
-						if(textures_occupied[i] == set+1) {
-							textures_occupied[i] = 0;
-							glActiveTexture(GL_TEXTURE0+i);		// set the active texture unit
-							glBindTexture(GL_TEXTURE_2D, 0);	// unbind texture from texture unit
-						}
-
 					// binds the descriptor set 'object' in cbo to 'set'
 					cbo->dset_ids[set] = id;
 					undefined_behavior = check_undefined_behavior(cbo, pipeline); // update whether or not behavior is undefined (based on bound sets + pipeline set layouts)
-					upload_descriptor_set_data(cbo, &object->dset, set, textures_occupied, pipeline);
+					upload_descriptor_set_data(cbo, &object->dset, set, pipeline);
 				}
 				break;
 			case 86:	// clear buffers
@@ -2796,19 +3965,13 @@ void submit_cmds(cbo_t* cbo) {
 				cmds += 17; // go to next opcode
 				if(undefined_behavior) break;
 				if(!cbo->bindings[2]) break;	// if no VBO bound
-				if(!is_indexed && n_instances == 1)
-					glDrawArrays(p_type, start_idx, n_indices);
-				else if(is_indexed && n_instances == 1) 
-					glDrawElements(p_type, n_indices, GL_UNSIGNED_INT, (GLvoid*)(start_idx*4));
-				else if(!is_indexed)
-					glDrawArraysInstanced(p_type, start_idx, n_indices, n_instances);
-				else glDrawElementsInstanced(p_type, n_indices, GL_UNSIGNED_INT, (GLvoid*)(start_idx*4), n_instances);
+				batch_draw(&draw_batch, p_type, is_indexed != 0, start_idx, n_indices, n_instances);
 				break;
 			case 93:	// indirect draw call
 				is_indexed = *(uint64_t*)(cmds+1);
-				id = *(uint64_t*)(cmds+2);
-				offset = *(uint64_t*)(cmds+10);
-				uint64_t n_draws = *(uint64_t*)(cmds+18) + 1;
+				id = *(uint64_t*)(cmds+9);
+				offset = *(uint64_t*)(cmds+17);
+				uint64_t n_draws = *(uint64_t*)(cmds+25) + 1;
 				cmds += 33; // go to next opcode
 				if(objects[id-1].deleted) break; // break if the data buffer has been deleted
 				if(n_draws * 12 + offset > objects[id-1].dbo.size) break; // draw calls exceed size of buffer
@@ -2818,10 +3981,7 @@ void submit_cmds(cbo_t* cbo) {
 					n_instances = params[1]+1;
 					start_idx = params[2];
 					// indexed/non-indexed depends on is_indexed
-					if(!is_indexed && n_instances == 1) glDrawArrays(p_type, start_idx, n_indices);
-					else if(is_indexed && n_instances == 1) glDrawElements(p_type, n_indices, GL_UNSIGNED_INT, (GLvoid*)(start_idx*4));
-					else if(!is_indexed) glDrawArraysInstanced(p_type, start_idx, n_indices, n_instances);
-					else glDrawElementsInstanced(p_type, n_indices, GL_UNSIGNED_INT, (GLvoid*)(start_idx*4), n_instances);
+					batch_draw(&draw_batch, p_type, is_indexed != 0, start_idx, n_indices, n_instances);
 					params += 3;
 				}
 				break;
@@ -2848,8 +4008,19 @@ void submit_cmds(cbo_t* cbo) {
 				upload_push_constants(pipeline->defs_1, pipeline->n_defs_1, pipeline);
 				upload_push_constants(pipeline->defs_2, pipeline->n_defs_2, pipeline);
 				break;
+			case 101:	// dispatch work-groups
+				n_groups[0] = *(uint32_t*)(cmds+1);
+				n_groups[1] = *(uint32_t*)(cmds+5);
+				n_groups[2] = *(uint32_t*)(cmds+9);
+				cmds += 13; // go to next opcode
+				if(undefined_behavior || !pipeline || !pipeline->gl_program) break;	// no GL compute support; nothing is dispatched
+				glDispatchCompute(n_groups[0], n_groups[1], n_groups[2]);
+				// storage writes must be visible to later dispatches, and to glGetBufferSubData when the SBOs are read back
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+				break;
 		}
 	}
+	flush_draw_batch(&draw_batch);
 }
 
 // returns 1 if layout_1 and layout_2 are identical, and 0 otherwise
@@ -2925,10 +4096,614 @@ void create_vao(vao_t* vao, uint8_t* info, uint8_t* success) {
 // creates a pipeline given the pipeline creation info (allocate and fill data in 'pipeline')
 // 'success' will be set 0 if the pipeline creation fails, and 1 otherwise
 // no memory bound checking required; all checking done before call in instruction_72 
+// translated + compiled shaders, content-addressed by shader bytecode and type
+// a pixel shader is translated against the outputs of a vertex shader, so its entry also records which vertex shader entry it was built for
+typedef struct shader_cache_t {
+	uint64_t key;			// hash of bytecode + type (+ vertex shader entry key for pixel shaders)
+	uint8_t* src;			// copy of the bytecode; compared on a key match
+	uint64_t size;
+	uint8_t type;
+	int32_t vertex_entry;	// for pixel shaders, index of the vertex shader entry this was translated against; -1 otherwise
+	char* glsl;				// translated GLSL source
+	GLuint gl_shader;		// compiled GL shader object; 0 until a program needs to be linked from source
+	shader_data_t data;		// translation results; shared read-only by every pipeline using the shader
+} shader_cache_t;
+
+shader_cache_t* shader_cache = 0;
+uint32_t n_cached_shaders = 0;
+
+// linked GL programs, keyed by the (vertex, pixel) shader cache entries they were linked from
+typedef struct program_cache_t {
+	uint64_t vertex_key;
+	uint64_t pixel_key;
+	uint32_t vertex_entry;
+	uint32_t pixel_entry;
+	GLuint gl_program;
+} program_cache_t;
+
+program_cache_t* program_cache = 0;
+uint32_t n_cached_programs = 0;
+
+// hash of a shader's bytecode + type, and of the vertex shader entry a pixel shader is translated against
+uint64_t shader_cache_key(shader_t* shader, int32_t vertex_entry) {
+	uint64_t key = 0xCBF29CE484222325ull;
+	for(uint64_t i = 0; i < shader->size; i++) key = (key ^ (uint8_t)shader->src[i]) * 0x100000001B3ull;
+	key = (key ^ shader->type) * 0x100000001B3ull;
+	if(vertex_entry >= 0) key = (key ^ shader_cache[vertex_entry].key) * 0x100000001B3ull;
+	return key;
+}
+
+// returns the index of the shader cache entry for a vertex, pixel, or compute shader, or -1 if it isn't cached
+// vertex_entry is the vertex shader entry for pixel shaders, -1 for vertex + compute shaders
+int32_t find_cached_shader(shader_t* shader, int32_t vertex_entry) {
+	uint64_t key = shader_cache_key(shader, vertex_entry);
+	for(uint32_t i = 0; i < n_cached_shaders; i++) {
+		shader_cache_t* entry = &shader_cache[i];
+		if(entry->key == key && entry->type == shader->type && entry->size == shader->size && entry->vertex_entry == vertex_entry
+		&& !memcmp(entry->src, shader->src, shader->size))
+			return i;
+	}
+	return -1;
+}
+
+// adds a translated shader to the shader cache (taking ownership of glsl) and returns its entry index
+// if an identical shader was cached in the meantime, its entry is returned instead and glsl is freed
+int32_t add_cached_shader(shader_t* shader, int32_t vertex_entry, char* glsl, shader_data_t* data) {
+	int32_t existing = find_cached_shader(shader, vertex_entry);
+	if(existing >= 0) {
+		free(glsl);
+		return existing;
+	}
+	if(SHOW_SHADERS)
+		printf("GLSL %s shader: \n%s\n", shader->type == 0 ? "vertex" : (shader->type == 1 ? "pixel" : "compute"), glsl);
+	shader_cache = realloc(shader_cache, (n_cached_shaders+1)*sizeof(shader_cache_t));
+	shader_cache_t* entry = &shader_cache[n_cached_shaders];
+	entry->key = shader_cache_key(shader, vertex_entry);
+	entry->src = malloc(shader->size);
+	memcpy(entry->src, shader->src, shader->size);
+	entry->size = shader->size;
+	entry->type = shader->type;
+	entry->vertex_entry = vertex_entry;
+	entry->glsl = glsl;
+	entry->gl_shader = 0;
+	entry->data = *data;
+	return n_cached_shaders++;
+}
+
+// translates shader bytecode to GLSL; data must be zeroed apart from the vertex outputs copied by the caller for pixel shaders
+// returns 1 if the shader is invalid
+uint8_t translate_cached_shader(shader_t* shader, shader_data_t* vertex_data, char** glsl, shader_data_t* data) {
+	shader_t glsl_shader;
+	glsl_shader.src = 0, glsl_shader.size = 0, glsl_shader.type = shader->type;
+	memset(data,0,sizeof(shader_data_t));
+	if(vertex_data) {	// pixel shader translation needs to know about the vertex shader's output IDs + their interpolation modes
+		data->vertex_output_ids = vertex_data->vertex_output_ids;
+		data->vertex_output_modes = vertex_data->vertex_output_modes;
+		data->n_vertex_outputs = vertex_data->n_vertex_outputs;
+	}
+	if(build_shader(shader->src, shader->size, shader->type, &glsl_shader, data) == 1) return 1;
+	*glsl = glsl_shader.src;
+	return 0;
+}
+
+// returns the index of the shader cache entry for a vertex, pixel, or compute shader, translating it on a miss
+// vertex_entry is the vertex shader entry for pixel shaders, -1 for vertex + compute shaders; returns -1 if the shader is invalid
+int32_t get_cached_shader(shader_t* shader, int32_t vertex_entry) {
+	int32_t entry = find_cached_shader(shader, vertex_entry);
+	if(entry >= 0) return entry;
+	char* glsl;
+	shader_data_t data;
+	if(translate_cached_shader(shader, vertex_entry >= 0 ? &shader_cache[vertex_entry].data : 0, &glsl, &data)) return -1;
+	return add_cached_shader(shader, vertex_entry, glsl, &data);
+}
+
+// starts compiling the GLSL of a shader cache entry if it hasn't been yet; the result is checked by check_cached_shader
+void compile_cached_shader(shader_cache_t* entry) {
+	if(entry->gl_shader) return;
+	entry->gl_shader = glCreateShader(entry->type == 0 ? GL_VERTEX_SHADER : (entry->type == 1 ? GL_FRAGMENT_SHADER : GL_COMPUTE_SHADER));
+	glShaderSource(entry->gl_shader, 1, (const GLchar const**)&entry->glsl, 0);
+	glCompileShader(entry->gl_shader);
+}
+
+// checks that a shader cache entry compiled; returns 1 on fail (and forgets the GL shader so it is compiled again if used again)
+uint8_t check_cached_shader(shader_cache_t* entry) {
+	GLint gl_success = 0;
+	glGetShaderiv(entry->gl_shader, GL_COMPILE_STATUS, &gl_success);
+	if(gl_success == GL_FALSE) {
+		GLint log_size = 0;
+		glGetShaderiv(entry->gl_shader, GL_INFO_LOG_LENGTH, &log_size);
+		uint8_t* log = malloc(log_size);
+		glGetShaderInfoLog(entry->gl_shader, log_size, 0, log);
+		printf("create_pipeline() call failed to compile %s shader, GL error: %s\n", entry->type == 0 ? "vertex" : (entry->type == 1 ? "pixel" : "compute"), log);
+		free(log);
+		glDeleteShader(entry->gl_shader);
+		entry->gl_shader = 0;
+		return 1;
+	}
+	return 0;
+}
+
+// program binary cache file layout:
+// magic (4) | BUILD_VER (4) | driver key (8) | vertex GLSL size (4) | pixel GLSL size (4) | binary format (4) | binary size (4) | vertex GLSL | pixel GLSL | binary
+// the GLSL (incl. null characters) is stored so a binary made from a different translation of the same bytecode is never used
+#define PROGRAM_CACHE_MAGIC 0x42504350	/* "PCPB" */
+#define PROGRAM_CACHE_HEADER_SIZE 32
+
+// gets the path of the program binary cache file for a pair of shader keys; the returned string must be freed
+char* program_cache_file(uint64_t vertex_key, uint64_t pixel_key) {
+	char* path = malloc(strlen(program_cache_path)+40);
+	sprintf(path, "%s/%016llx%016llx.bin", program_cache_path, (unsigned long long)vertex_key, (unsigned long long)pixel_key);
+	return path;
+}
+
+// tries to create a GL program from a cached program binary; returns 0 if there is none or it can't be used
+GLuint load_program_binary(shader_cache_t* vertex, shader_cache_t* pixel) {
+	if(!program_cache_path || !gl_program_binaries) return 0;
+	char* path = program_cache_file(vertex->key, pixel->key);
+	FILE* file = fopen(path, "rb");
+	free(path);
+	if(!file) return 0;
+	uint8_t header[PROGRAM_CACHE_HEADER_SIZE];
+	uint8_t* data = 0;
+	GLuint gl_program = 0;
+	uint32_t vsize = strlen(vertex->glsl)+1, psize = strlen(pixel->glsl)+1;
+	if(fread(header, PROGRAM_CACHE_HEADER_SIZE, 1, file) != 1) goto done;
+	if(*(uint32_t*)header != PROGRAM_CACHE_MAGIC || *(uint32_t*)(header+4) != BUILD_VER || *(uint64_t*)(header+8) != gl_driver_key) goto done;
+	if(*(uint32_t*)(header+16) != vsize || *(uint32_t*)(header+20) != psize) goto done;
+	GLenum format = *(uint32_t*)(header+24);
+	uint32_t binary_size = *(uint32_t*)(header+28);
+	data = malloc((uint64_t)vsize+psize+binary_size);
+	if(!data || fread(data, (uint64_t)vsize+psize+binary_size, 1, file) != 1) goto done;
+	if(memcmp(data, vertex->glsl, vsize) || memcmp(data+vsize, pixel->glsl, psize)) goto done;	// the translator's output changed
+	gl_program = glCreateProgram();
+	glProgramBinary(gl_program, format, data+vsize+psize, binary_size);
+	GLint gl_success = 0;
+	glGetProgramiv(gl_program, GL_LINK_STATUS, &gl_success);
+	if(gl_success == GL_FALSE) {	// the driver rejected the binary; the program is relinked from source
+		glDeleteProgram(gl_program);
+		gl_program = 0;
+	}
+done:
+	free(data);
+	fclose(file);
+	return gl_program;
+}
+
+// stores the binary of a linked GL program in the program binary cache
+void store_program_binary(GLuint gl_program, shader_cache_t* vertex, shader_cache_t* pixel) {
+	if(!program_cache_path || !gl_program_binaries) return;
+	GLint binary_size = 0;
+	glGetProgramiv(gl_program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+	if(binary_size <= 0) return;
+	uint8_t* binary = malloc(binary_size);
+	GLenum format = 0;
+	glGetProgramBinary(gl_program, binary_size, &binary_size, &format, binary);
+	uint8_t header[PROGRAM_CACHE_HEADER_SIZE];
+	*(uint32_t*)header = PROGRAM_CACHE_MAGIC;
+	*(uint32_t*)(header+4) = BUILD_VER;
+	*(uint64_t*)(header+8) = gl_driver_key;
+	*(uint32_t*)(header+16) = strlen(vertex->glsl)+1;
+	*(uint32_t*)(header+20) = strlen(pixel->glsl)+1;
+	*(uint32_t*)(header+24) = format;
+	*(uint32_t*)(header+28) = binary_size;
+	// write to a temporary file and rename it, so that a partially written file is never loaded
+	char* path = program_cache_file(vertex->key, pixel->key);
+	char* tmp_path = malloc(strlen(path)+5);
+	sprintf(tmp_path, "%s.tmp", path);
+	FILE* file = fopen(tmp_path, "wb");
+	if(file) {
+		uint8_t ok = fwrite(header, PROGRAM_CACHE_HEADER_SIZE, 1, file) == 1
+			&& fwrite(vertex->glsl, *(uint32_t*)(header+16), 1, file) == 1
+			&& fwrite(pixel->glsl, *(uint32_t*)(header+20), 1, file) == 1
+			&& fwrite(binary, binary_size, 1, file) == 1;
+		if(fclose(file) == 0 && ok) rename(tmp_path, path);
+		else remove(tmp_path);
+	}
+	free(tmp_path);
+	free(path);
+	free(binary);
+}
+
+// adds a linked GL program to the program cache
+void add_cached_program(uint32_t vertex_entry, uint32_t pixel_entry, GLuint gl_program) {
+	program_cache = realloc(program_cache, (n_cached_programs+1)*sizeof(program_cache_t));
+	program_cache[n_cached_programs].vertex_key = shader_cache[vertex_entry].key;
+	program_cache[n_cached_programs].pixel_key = shader_cache[pixel_entry].key;
+	program_cache[n_cached_programs].vertex_entry = vertex_entry;
+	program_cache[n_cached_programs].pixel_entry = pixel_entry;
+	program_cache[n_cached_programs].gl_program = gl_program;
+	n_cached_programs++;
+}
+
+// returns the GL program linked from two shader cache entries if it is in the program cache, or can be loaded from the program binary cache; 0 otherwise
+GLuint find_cached_program(uint32_t vertex_entry, uint32_t pixel_entry) {
+	for(uint32_t i = 0; i < n_cached_programs; i++)
+		if(program_cache[i].vertex_entry == vertex_entry && program_cache[i].pixel_entry == pixel_entry)
+			return program_cache[i].gl_program;
+	GLuint gl_program = load_program_binary(&shader_cache[vertex_entry], &shader_cache[pixel_entry]);
+	if(gl_program) add_cached_program(vertex_entry, pixel_entry, gl_program);
+	return gl_program;
+}
+
+// starts compiling + linking a GL program from two shader cache entries; the result is checked by end_program_link
+// with parallel shader compilation the driver does this work on its own threads, and GL_COMPLETION_STATUS_KHR tells when it is done
+// a compute program is linked from one compute shader entry, passed as both the vertex and pixel entry
+GLuint begin_program_link(uint32_t vertex_entry, uint32_t pixel_entry) {
+	shader_cache_t* vertex = &shader_cache[vertex_entry];
+	shader_cache_t* pixel = &shader_cache[pixel_entry];
+	compile_cached_shader(vertex);
+	compile_cached_shader(pixel);
+	GLuint gl_program = glCreateProgram();
+	if(program_cache_path && gl_program_binaries) glProgramParameteri(gl_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(gl_program, vertex->gl_shader);
+	if(pixel_entry != vertex_entry) glAttachShader(gl_program, pixel->gl_shader);
+	glLinkProgram(gl_program);
+	return gl_program;
+}
+
+// checks that a program started by begin_program_link linked, and adds it to the program cache; returns 0 if compiling or linking failed
+GLuint end_program_link(GLuint gl_program, uint32_t vertex_entry, uint32_t pixel_entry) {
+	shader_cache_t* vertex = &shader_cache[vertex_entry];
+	shader_cache_t* pixel = &shader_cache[pixel_entry];
+	GLint gl_success = 0;
+	glGetProgramiv(gl_program, GL_LINK_STATUS, &gl_success);
+	if(gl_success == GL_FALSE) {
+		if(!check_cached_shader(vertex) && !check_cached_shader(pixel)) {	// shaders compiled; print the link error
+			GLint log_size = 0;
+			glGetProgramiv(gl_program, GL_INFO_LOG_LENGTH, &log_size);
+			uint8_t* log = malloc(log_size);
+			glGetProgramInfoLog(gl_program, log_size, 0, log);
+			printf("create_pipeline() call failed to link shader program, GL error: %s\n", log);
+			free(log);
+		}
+		glDeleteProgram(gl_program);
+		return 0;
+	}
+	for(uint32_t i = 0; i < n_cached_programs; i++)	// another pipeline with the same shaders finished linking first
+		if(program_cache[i].vertex_entry == vertex_entry && program_cache[i].pixel_entry == pixel_entry) {
+			glDeleteProgram(gl_program);
+			return program_cache[i].gl_program;
+		}
+	store_program_binary(gl_program, vertex, pixel);
+	add_cached_program(vertex_entry, pixel_entry, gl_program);
+	return gl_program;
+}
+
+// returns the GL program linked from two shader cache entries; on a miss it is loaded from the program binary cache if possible, otherwise compiled + linked
+// returns 0 if compiling or linking fails
+GLuint get_cached_program(uint32_t vertex_entry, uint32_t pixel_entry) {
+	GLuint gl_program = find_cached_program(vertex_entry, pixel_entry);
+	if(gl_program) return gl_program;
+	return end_program_link(begin_program_link(vertex_entry, pixel_entry), vertex_entry, pixel_entry);
+}
+
+// checks the definitions of a pipeline's shaders against its set layouts; returns 1 if valid
+uint8_t check_pipeline_defs(pipeline_t* pipeline) {
+	// for all definitions, ensure it's not a sampler at non-sampler set/binding, not uniform data at a non-data uniform 
+	// set/binding, not an accel struct at accel set/binding, not a storage at non-storage set/binding
+	// also checks that a sampler's elcount is equal to the number of descriptors at the descriptor binding point
+	for(uint32_t i = 0; i < pipeline->n_defs_1+pipeline->n_defs_2; i++) {
+		uint32_t def_idx = i - (i < pipeline->n_defs_1 ? 0 : pipeline->n_defs_1);
+		definition_t* def = i < pipeline->n_defs_1 ? &pipeline->defs_1[def_idx] : &pipeline->defs_2[def_idx];
+		if((def->def_type == UNIF_DEF_BIT && !def->location_id) // uniform (but not push constant)
+		|| (def->def_type == VAR_DEF_BIT  && def->within_block)) { // storage variable
+			if(def->set > pipeline->n_desc_sets-1) return 0; // set binding inaccessible, pipeline creation fails
+		} else continue; // not a uniform or storage variable definition occupying some descriptor binding
+		set_layout_t set_layout = objects[pipeline->dset_layout_ids[def->set]-1].set_layout;
+		int32_t binding_type = -1;
+		uint16_t n_descs = 1;
+		for(uint32_t j = 0; j < set_layout.n_binding_points+1; j++)
+			if(set_layout.binding_numbers[j] == def->binding) { binding_type = set_layout.binding_types[j]; n_descs = set_layout.n_descs[j]; break; }
+		if(binding_type == -1) return 0; // descriptor binding point for definition does not exist in set layout
+		// now check that this def has a type compatible with binding_type
+		if(def->def_type == VAR_DEF_BIT && binding_type != 1) return 0; // invalid; storage variable at non-storage descriptor
+		else if(def->data_type < 21  && binding_type != 0) return 0; // invalid; uniform data at non-uniform descriptor
+		else if(def->data_type > 20 && def->data_type < 24 && binding_type != 2) return 0; // invalid; sampler at non-sampler descriptor
+		else if(def->data_type > 20 && def->data_type < 24 && def->elcount != 0 && def->elcount != n_descs) return 0; // sampler def incompatible with desc bind point
+		else if(def->data_type == 24 && binding_type != 3) return 0; // invalid; image at non-image descriptor
+		else if(def->data_type == 25 && binding_type != 4) return 0; // invalid; AS at non-AS descriptor
+	}
+	return 1;
+}
+
+// checks a rasterization pipeline's shaders against each other and against its set layouts, and sets its definitions; returns 1 if valid
+uint8_t check_pipeline_shaders(pipeline_t* pipeline, uint32_t vshader_entry, uint32_t pshader_entry) {
+	shader_data_t vshader_data = shader_cache[vshader_entry].data;
+	shader_data_t pshader_data = shader_cache[pshader_entry].data;
+	pipeline->defs_1 = vshader_data.defs; pipeline->n_defs_1 = vshader_data.n_defs;
+	pipeline->defs_2 = pshader_data.defs; pipeline->n_defs_2 = pshader_data.n_defs;
+
+	// push constant data checking
+	if(vshader_data.n_push_constant_bytes && vshader_data.n_push_constant_bytes != pipeline->n_push_constant_bytes) return 0; // pipeline creation fails if a shader does not have same number of push constant bytes as pipeline
+	if(pshader_data.n_push_constant_bytes && pshader_data.n_push_constant_bytes != pipeline->n_push_constant_bytes) return 0; // pipeline creation fails if a shader does not have same number of push constant bytes as pipeline
+	if(vshader_data.n_push_constant_bytes && pshader_data.n_push_constant_bytes) {
+		int32_t first_push_i = -1, first_push_j = -1, n_push_i = 0, n_push_j = 0; // first push constant def indices for vshader, pshader
+		for(uint32_t i = 0; i < vshader_data.n_defs; i++)
+			if(vshader_data.defs[i].def_type == UNIF_DEF_BIT && vshader_data.defs[i].location_id)
+				if(!(n_push_i++)) first_push_i = i;
+		for(uint32_t j = 0; j < pshader_data.n_defs; j++)
+			if(pshader_data.defs[j].def_type == UNIF_DEF_BIT && pshader_data.defs[j].location_id)
+				if(!(n_push_j++)) first_push_j = j;
+		// make sure the push constant block for each shader is the same layout; each have the same element count, type
+		if(n_push_i != n_push_j) return 0;
+		for(uint32_t i = 0; i < n_push_i && vshader_data.defs[first_push_i+i].location_id; i++) {
+			if(vshader_data.defs[first_push_i+i].data_type != pshader_data.defs[first_push_j+i].data_type) return 0;
+			if(vshader_data.defs[first_push_i+i].elcount != pshader_data.defs[first_push_j+i].elcount) return 0;
+		}
+	}
+
+	// make sure each vertex shader output has a pixel shader input w/ same ID
+	for(uint32_t i = 0; i < vshader_data.n_vertex_outputs; i++) {
+		uint8_t found_matching = 0;
+		for(uint32_t j = 0; j < pshader_data.n_pixel_inputs; j++)
+			if(vshader_data.vertex_output_ids[i] == pshader_data.pixel_input_ids[j]) {
+				if(vshader_data.vertex_output_types[i] != pshader_data.pixel_input_types[j]) return 0; // pipeline creation fails if any output/input pairs are not of same data type
+				found_matching = 1;
+				break;
+			}
+		if(!found_matching) return 0; // pipeline creation fails if any vertex shader output IDs are not found in pixel shader input IDs
+	}
+
+	return check_pipeline_defs(pipeline);
+}
+
+// assigns a GL uniform buffer binding point to each uniform block in a rasterization or compute pipeline's program
+void bind_pipeline_ubo_blocks(pipeline_t* pipeline) {
+	for(uint32_t loop = 0; loop < 2; loop++) {
+		definition_t* defs = (loop == 0) ? pipeline->defs_1 : pipeline->defs_2;
+		uint32_t n_defs = (loop == 0) ? pipeline->n_defs_1 : pipeline->n_defs_2;
+		for(uint32_t d = 0; d < n_defs; d++) {
+			if(!IS_UBO_UNIFORM(defs[d], defs[d].set, defs[d].binding)) continue;
+			if(d > 0 && IS_UBO_UNIFORM(defs[d-1], defs[d].set, defs[d].binding)) continue; // not the first uniform in the block
+			str_t block_name;
+			str_init(&block_name, 32);
+			str_add(&block_name, "_");
+			str_add_ui(&block_name, defs[d].set);
+			str_add(&block_name, "_");
+			str_add_ui(&block_name, defs[d].binding);
+			str_add(&block_name, "_");
+			str_add_ui(&block_name, pipeline->type == 2 ? 2 : loop);	// named after the shader type (see translate_shader)
+			GLuint block_index = glGetUniformBlockIndex(pipeline->gl_program, block_name.str);
+			free(block_name.str);
+			if(block_index == GL_INVALID_INDEX) continue; // OpenGL may remove uniform blocks that are unused
+			uint32_t n = pipeline->n_ubo_blocks;
+			pipeline->ubo_block_sets = realloc(pipeline->ubo_block_sets, n+1);
+			pipeline->ubo_block_bindings = realloc(pipeline->ubo_block_bindings, 4*(n+1));
+			pipeline->ubo_block_stages = realloc(pipeline->ubo_block_stages, n+1);
+			pipeline->ubo_block_keys = realloc(pipeline->ubo_block_keys, 8*(n+1));
+			pipeline->ubo_block_sizes = realloc(pipeline->ubo_block_sizes, 8*(n+1));
+			pipeline->ubo_block_sets[n] = defs[d].set;
+			pipeline->ubo_block_bindings[n] = defs[d].binding;
+			pipeline->ubo_block_stages[n] = loop;
+			pipeline->ubo_block_keys[n] = ubo_layout_key(defs, n_defs, defs[d].set, defs[d].binding);
+			pipeline->ubo_block_sizes[n] = pack_ubo_std140(defs, n_defs, defs[d].set, defs[d].binding, 0, 0, 0);
+			glUniformBlockBinding(pipeline->gl_program, block_index, n);
+			pipeline->n_ubo_blocks++;
+		}
+	}
+}
+
+// assigns a GL shader storage buffer binding point to each storage block in a compute pipeline's program
+void bind_pipeline_sbo_blocks(pipeline_t* pipeline) {
+	definition_t* defs = pipeline->defs_1;
+	uint32_t n_defs = pipeline->n_defs_1;
+	for(uint32_t d = 0; d < n_defs; d++) {
+		if(!IS_SBO_VARIABLE(defs[d], defs[d].set, defs[d].binding)) continue;
+		if(d > 0 && IS_SBO_VARIABLE(defs[d-1], defs[d].set, defs[d].binding)) continue; // not the first variable in the block
+		str_t block_name;
+		str_init(&block_name, 32);
+		str_add(&block_name, "_");
+		str_add_ui(&block_name, defs[d].set);
+		str_add(&block_name, "_");
+		str_add_ui(&block_name, defs[d].binding);
+		str_add(&block_name, "_2");
+		GLuint block_index = glGetProgramResourceIndex(pipeline->gl_program, GL_SHADER_STORAGE_BLOCK, block_name.str);
+		free(block_name.str);
+		if(block_index == GL_INVALID_INDEX) continue; // OpenGL may remove storage blocks that are unused
+		uint32_t n = pipeline->n_sbo_blocks;
+		pipeline->sbo_block_sets = realloc(pipeline->sbo_block_sets, n+1);
+		pipeline->sbo_block_bindings = realloc(pipeline->sbo_block_bindings, 4*(n+1));
+		pipeline->sbo_block_keys = realloc(pipeline->sbo_block_keys, 8*(n+1));
+		pipeline->sbo_block_sets[n] = defs[d].set;
+		pipeline->sbo_block_bindings[n] = defs[d].binding;
+		pipeline->sbo_block_keys[n] = sbo_layout_key(defs, n_defs, defs[d].set, defs[d].binding);
+		glShaderStorageBlockBinding(pipeline->gl_program, block_index, n);
+		pipeline->n_sbo_blocks++;
+	}
+}
+
+// assigns a texture unit to each sampler array element in a rasterization or compute pipeline's program, and sets the sampler uniforms to them
+// samplers at the same set+binding in both shaders share units; programs shared by pipelines get the same assignment, as it only depends on the shaders
+void assign_pipeline_texture_units(pipeline_t* pipeline) {
+	gl_use_program(pipeline->gl_program);
+	for(uint32_t loop = 0; loop < 2; loop++) {
+		definition_t* defs = (loop == 0) ? pipeline->defs_1 : pipeline->defs_2;
+		uint32_t n_defs = (loop == 0) ? pipeline->n_defs_1 : pipeline->n_defs_2;
+		for(uint32_t d = 0; d < n_defs; d++) {
+			if(defs[d].data_type < 21 || defs[d].data_type > 23 || !defs[d].used) continue; // not a sampler, or left out of the GLSL as unused
+			for(uint16_t element = 0; element < defs[d].elcount; element++) {
+				str_t glsl_id;
+				str_init(&glsl_id, 32);
+				str_add(&glsl_id, "_");
+				str_add_ui(&glsl_id, defs[d].id);
+				str_add(&glsl_id, "[");
+				str_add_ui(&glsl_id, element);
+				str_add(&glsl_id, "]");
+				GLint loc = glGetUniformLocation(pipeline->gl_program, glsl_id.str);
+				free(glsl_id.str);
+				if(loc < 0) continue; // OpenGL may remove unused samplers
+				int32_t unit = get_texture_unit(pipeline, defs[d].set, defs[d].binding, element);
+				if(unit < 0) {
+					if(pipeline->n_sampler_units == max_number_samplers) continue;
+					uint32_t n = unit = pipeline->n_sampler_units++;
+					pipeline->sampler_unit_sets = realloc(pipeline->sampler_unit_sets, n+1);
+					pipeline->sampler_unit_bindings = realloc(pipeline->sampler_unit_bindings, 4*(n+1));
+					pipeline->sampler_unit_elements = realloc(pipeline->sampler_unit_elements, 2*(n+1));
+					pipeline->sampler_unit_sets[n] = defs[d].set;
+					pipeline->sampler_unit_bindings[n] = defs[d].binding;
+					pipeline->sampler_unit_elements[n] = element;
+				}
+				glUniform1i(loc, unit);
+			}
+		}
+	}
+}
+
+// checks + links a rasterization pipeline whose shaders are in the shader cache; returns 0 on fail and 1 when done
+// if async is set and the driver compiles in parallel, returns 2 while it is still linking; pipeline->gl_program must then be finished by end_program_link
+uint8_t link_pipeline(pipeline_t* pipeline, uint32_t vshader_entry, uint32_t pshader_entry, uint8_t async) {
+	if(!check_pipeline_shaders(pipeline, vshader_entry, pshader_entry)) return 0;
+	pipeline->gl_program = find_cached_program(vshader_entry, pshader_entry);
+	if(!pipeline->gl_program) {
+		pipeline->gl_program = begin_program_link(vshader_entry, pshader_entry);
+		if(async && gl_parallel_shader_compile) return 2;
+		if(!(pipeline->gl_program = end_program_link(pipeline->gl_program, vshader_entry, pshader_entry))) return 0;
+	}
+	bind_pipeline_ubo_blocks(pipeline);
+	assign_pipeline_texture_units(pipeline);
+	return 1;
+}
+
+// creation of a rasterization pipeline that hasn't finished yet
+// its shaders are translated on the pipeline worker thread, then the rest is done on the main thread by update_pipeline_job
+#define PIPELINE_JOB_TRANSLATING 0	/* queued for or being translated by the worker */
+#define PIPELINE_JOB_TRANSLATED 1	/* translated; the shaders are added to the shader cache and linked by update_pipeline_job */
+#define PIPELINE_JOB_LINKING 2		/* the driver is linking the program on its own threads */
+struct pipeline_job_t {
+	uint8_t stage;				// only read/written with pipeline_job_mutex held while translating
+	uint8_t failed;				// set by the worker if a shader is invalid
+	shader_t vshader, pshader;	// copies of the shader bytecode
+	int32_t vshader_entry;		// shader cache entries; -1 until the shader is translated + cached
+	int32_t pshader_entry;
+	char* vshader_glsl;			// translation results, added to the shader cache on the main thread
+	char* pshader_glsl;
+	shader_data_t vshader_data;
+	shader_data_t pshader_data;
+};
+
+pthread_mutex_t pipeline_job_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pipeline_job_queued = PTHREAD_COND_INITIALIZER;		// signaled when a job is queued for the worker
+pthread_cond_t pipeline_job_translated = PTHREAD_COND_INITIALIZER;	// signaled when the worker finishes translating a job
+pipeline_job_t** pipeline_job_queue = 0;	// jobs waiting for the worker, oldest first
+uint32_t n_queued_pipeline_jobs = 0;
+uint8_t pipeline_worker_started = 0;
+
+uint64_t* pending_pipelines = 0;	// IDs of pipeline objects whose job hasn't finished
+uint32_t n_pending_pipelines = 0;
+
+// translates the shaders of a job; only touches the job itself, so it can run on the worker thread
+void translate_pipeline_job(pipeline_job_t* job) {
+	if(job->vshader_entry < 0 && translate_cached_shader(&job->vshader, 0, &job->vshader_glsl, &job->vshader_data)) { job->failed = 1; return; }
+	if(translate_cached_shader(&job->pshader, &job->vshader_data, &job->pshader_glsl, &job->pshader_data)) job->failed = 1;
+}
+
+void* pipeline_worker(void* arg) {
+	pthread_mutex_lock(&pipeline_job_mutex);
+	while(1) {
+		while(!n_queued_pipeline_jobs) pthread_cond_wait(&pipeline_job_queued, &pipeline_job_mutex);
+		pipeline_job_t* job = pipeline_job_queue[0];
+		memmove(pipeline_job_queue, pipeline_job_queue+1, (--n_queued_pipeline_jobs)*sizeof(pipeline_job_t*));
+		pthread_mutex_unlock(&pipeline_job_mutex);
+		translate_pipeline_job(job);
+		pthread_mutex_lock(&pipeline_job_mutex);
+		job->stage = PIPELINE_JOB_TRANSLATED;
+		pthread_cond_broadcast(&pipeline_job_translated);
+	}
+	return 0;
+}
+
+// creates a job for a pipeline; if vshader is given, the shaders are copied and queued for translation (vshader_entry is the vertex shader's cache entry if it's already cached, otherwise -1)
+pipeline_job_t* new_pipeline_job(shader_t* vshader, shader_t* pshader, int32_t vshader_entry) {
+	pipeline_job_t* job = calloc(1, sizeof(pipeline_job_t));
+	job->vshader_entry = vshader_entry;
+	job->pshader_entry = -1;
+	if(!vshader) return job;
+	job->stage = PIPELINE_JOB_TRANSLATING;
+	job->vshader = *vshader;
+	job->vshader.src = malloc(vshader->size);
+	memcpy(job->vshader.src, vshader->src, vshader->size);
+	job->pshader = *pshader;
+	job->pshader.src = malloc(pshader->size);
+	memcpy(job->pshader.src, pshader->src, pshader->size);
+	if(vshader_entry >= 0) job->vshader_data = shader_cache[vshader_entry].data;	// pixel shader is translated against the cached vertex shader's outputs
+
+	pthread_mutex_lock(&pipeline_job_mutex);
+	if(!pipeline_worker_started) {
+		pthread_t worker;
+		if(pthread_create(&worker, 0, pipeline_worker, 0) == 0) {
+			pthread_detach(worker);
+			pipeline_worker_started = 1;
+		}
+	}
+	if(pipeline_worker_started) {
+		pipeline_job_queue = realloc(pipeline_job_queue, (n_queued_pipeline_jobs+1)*sizeof(pipeline_job_t*));
+		pipeline_job_queue[n_queued_pipeline_jobs++] = job;
+		pthread_cond_signal(&pipeline_job_queued);
+	}
+	pthread_mutex_unlock(&pipeline_job_mutex);
+	if(!pipeline_worker_started) {	// no worker; translate now
+		translate_pipeline_job(job);
+		job->stage = PIPELINE_JOB_TRANSLATED;
+	}
+	return job;
+}
+
+// continues the job of a pending pipeline; if wait is set it runs to completion
+// returns 1 if the pipeline is still pending, 0 if it is now ready, and 2 if its creation failed
+uint8_t update_pipeline_job(pipeline_t* pipeline, uint8_t wait) {
+	pipeline_job_t* job = pipeline->job;
+	uint8_t result = 0;
+	if(job->stage != PIPELINE_JOB_LINKING) {
+		pthread_mutex_lock(&pipeline_job_mutex);
+		while(wait && job->stage == PIPELINE_JOB_TRANSLATING) pthread_cond_wait(&pipeline_job_translated, &pipeline_job_mutex);
+		uint8_t translating = job->stage == PIPELINE_JOB_TRANSLATING;
+		pthread_mutex_unlock(&pipeline_job_mutex);
+		if(translating) return 1;
+
+		if(job->vshader_glsl) job->vshader_entry = add_cached_shader(&job->vshader, -1, job->vshader_glsl, &job->vshader_data);
+		if(job->failed) { result = 2; goto done; }
+		job->pshader_entry = add_cached_shader(&job->pshader, job->vshader_entry, job->pshader_glsl, &job->pshader_data);
+		uint8_t linked = link_pipeline(pipeline, job->vshader_entry, job->pshader_entry, !wait);
+		if(linked != 2) { result = linked ? 0 : 2; goto done; }
+		job->stage = PIPELINE_JOB_LINKING;
+	}
+	if(!wait) {
+		GLint completed = 0;
+		glGetProgramiv(pipeline->gl_program, GL_COMPLETION_STATUS_KHR, &completed);
+		if(!completed) return 1;
+	}
+	pipeline->gl_program = end_program_link(pipeline->gl_program, job->vshader_entry, job->pshader_entry);
+	if(pipeline->gl_program) {
+		bind_pipeline_ubo_blocks(pipeline);
+		assign_pipeline_texture_units(pipeline);
+	} else result = 2;
+done:
+	free(job->vshader.src);
+	free(job->pshader.src);
+	free(job);
+	pipeline->job = 0;
+	return result;
+}
+
+// continues (or with wait set, finishes) creating a pending pipeline object; a pipeline whose creation fails becomes deleted
+void update_pending_pipeline(uint64_t id, uint8_t wait) {
+	object_t* object = &objects[id-1];
+	if(!object->pipeline.job) return;
+	if(update_pipeline_job(&object->pipeline, wait) == 2) object->deleted = 1;
+}
+
+// continues creating all pending pipeline objects without blocking; called once per main loop iteration
+void update_pending_pipelines() {
+	for(uint32_t i = 0; i < n_pending_pipelines; i++) {
+		update_pending_pipeline(pending_pipelines[i], 0);
+		if(!objects[pending_pipelines[i]-1].pipeline.job) pending_pipelines[i--] = pending_pipelines[--n_pending_pipelines];
+	}
+}
+
 void create_pipeline(pipeline_t* pipeline, uint8_t* info, uint8_t* success, thread_t* thread) {
-	// EACH PIPELINE WILL GET ITS OWN SHADER PROGRAM, EVEN IF ONE WITH IDENTICAL SHADERS ALREADY EXISTS, TO SIMPLIFY THE VM/
 	// SET ALL PIPELINE STATE HERE.
-	// BUILD_SHADER GENERATED GLSL SOURCE WILL EXIST ONLY IN THIS FUNCTION TO CREATE SHADER PROGRAMS AND IS NOT STORED IN SHADER OBJECTS, PIPELINE OBJECTS, OR ANYWHERE ELSE.
+	// SHADERS ARE TRANSLATED + COMPILED ONCE PER UNIQUE BYTECODE (SEE get_cached_shader), AND PIPELINES WITH IDENTICAL SHADERS SHARE ONE GL PROGRAM (SEE get_cached_program).
+	// WITH ASYNC_PIPELINES A RASTERIZATION PIPELINE MAY BE CREATED PENDING (pipeline->job SET); IT IS FINISHED BY update_pending_pipelines OR WAITED ON WHEN SUBMITTED.
 
 	*success = 0;
 	if(pipeline->type == 0) {	// if creating a rasterization pipeline
@@ -3034,134 +4809,30 @@ void create_pipeline(pipeline_t* pipeline, uint8_t* info, uint8_t* success, thre
 		if(pipeline->src_alpha_blend_fac > 9) return;
 		pipeline->dst_alpha_blend_fac = info[23];
 		if(pipeline->dst_alpha_blend_fac > 9) return;
+		build_pipeline_gl_state(pipeline);
 
 		//
 		// BUILD THE PIPELINE'S SHADERS
 		//
 
-		shader_t glsl_vshader, glsl_pshader;
-		glsl_vshader.src = calloc(1,1), glsl_vshader.size = 1, glsl_vshader.type = vshader_object->shader.type;
-		glsl_pshader.src = calloc(1,1), glsl_pshader.size = 1, glsl_pshader.type = pshader_object->shader.type;
-
-		shader_data_t vshader_data, pshader_data;
-		memset(&vshader_data,0,sizeof(shader_data_t));
-		memset(&pshader_data,0,sizeof(shader_data_t));
-
-		/*** VALIDATE + TRANSLATE SOURCE CODE OF SHADER; RETURN IF INVALID ***/
-		if(build_shader(vshader_object->shader.src, vshader_object->shader.size, vshader_object->shader.type, &glsl_vshader, &vshader_data) == 1) return;
-		// copy over information important for pixel shader translation; need to know about the vertex shader's output IDs + their interpolation modes
-		pshader_data.vertex_output_ids = vshader_data.vertex_output_ids;
-		pshader_data.vertex_output_modes = vshader_data.vertex_output_modes;
-		pshader_data.n_vertex_outputs = vshader_data.n_vertex_outputs;
-		if(SHOW_SHADERS)
-			printf("GLSL vertex shader: \n%s\n", glsl_vshader.src);
-
-		if(build_shader(pshader_object->shader.src, pshader_object->shader.size, pshader_object->shader.type, &glsl_pshader, &pshader_data) == 1) return;
-		pipeline->defs_1 = vshader_data.defs; pipeline->n_defs_1 = vshader_data.n_defs;
-		pipeline->defs_2 = pshader_data.defs; pipeline->n_defs_2 = pshader_data.n_defs;
-		if(SHOW_SHADERS)
-			printf("GLSL pixel shader: \n%s\n", glsl_pshader.src);
-
-		// push constant data checking
-		if(vshader_data.n_push_constant_bytes && vshader_data.n_push_constant_bytes != pipeline->n_push_constant_bytes) return; // pipeline creation fails if a shader does not have same number of push constant bytes as pipeline
-		if(pshader_data.n_push_constant_bytes && pshader_data.n_push_constant_bytes != pipeline->n_push_constant_bytes) return; // pipeline creation fails if a shader does not have same number of push constant bytes as pipeline
-		if(vshader_data.n_push_constant_bytes && pshader_data.n_push_constant_bytes) {
-			int32_t first_push_i = -1, first_push_j = -1, n_push_i = 0, n_push_j = 0; // first push constant def indices for vshader, pshader
-			for(uint32_t i = 0; i < vshader_data.n_defs; i++)
-				if(vshader_data.defs[i].def_type == UNIF_DEF_BIT && vshader_data.defs[i].location_id)
-					if(!(n_push_i++)) first_push_i = i;
-			for(uint32_t j = 0; j < pshader_data.n_defs; j++)
-				if(pshader_data.defs[j].def_type == UNIF_DEF_BIT && pshader_data.defs[j].location_id)
-					if(!(n_push_j++)) first_push_j = j;
-			// make sure the push constant block for each shader is the same layout; each have the same element count, type
-			if(n_push_i != n_push_j) return;
-			for(uint32_t i = 0; i < n_push_i && vshader_data.defs[first_push_i+i].location_id; i++) {
-				if(vshader_data.defs[first_push_i+i].data_type != pshader_data.defs[first_push_j+i].data_type) return;
-				if(vshader_data.defs[first_push_i+i].elcount != pshader_data.defs[first_push_j+i].elcount) return;
-			}
-		}
-
-		// make sure each vertex shader output has a pixel shader input w/ same ID
-		for(uint32_t i = 0; i < vshader_data.n_vertex_outputs; i++) {
-			uint8_t found_matching = 0;
-			for(uint32_t j = 0; j < pshader_data.n_pixel_inputs; j++)
-				if(vshader_data.vertex_output_ids[i] == pshader_data.pixel_input_ids[j]) {
-					if(vshader_data.vertex_output_types[i] != pshader_data.pixel_input_types[j]) return; // pipeline creation fails if any output/input pairs are not of same data type
-					found_matching = 1;
-					break;
-				}
-			if(!found_matching) return; // pipeline creation fails if any vertex shader output IDs are not found in pixel shader input IDs
-		}
-
-		// for all definitions, ensure it's not a sampler at non-sampler set/binding, not uniform data at a non-data uniform 
-		// set/binding, not an accel struct at accel set/binding, not a storage at non-storage set/binding
-		// also checks that a sampler's elcount is equal to the number of descriptors at the descriptor binding point
-		for(uint32_t i = 0; i < pipeline->n_defs_1+pipeline->n_defs_2; i++) {
-			uint32_t def_idx = i - (i < pipeline->n_defs_1 ? 0 : pipeline->n_defs_1);
-			definition_t* def = i < pipeline->n_defs_1 ? &pipeline->defs_1[def_idx] : &pipeline->defs_2[def_idx];
-			if((def->def_type == UNIF_DEF_BIT && !def->location_id) // uniform (but not push constant)
-			|| (def->def_type == VAR_DEF_BIT  && def->within_block)) { // storage variable
-				if(def->set > pipeline->n_desc_sets-1) return; // set binding inaccessible, pipeline creation fails
-			} else continue; // not a uniform or storage variable definition occupying some descriptor binding
-			set_layout_t set_layout = objects[pipeline->dset_layout_ids[def->set]-1].set_layout;
-			int32_t binding_type = -1;
-			uint16_t n_descs = 1;
-			for(uint32_t j = 0; j < set_layout.n_binding_points+1; j++)
-				if(set_layout.binding_numbers[j] == def->binding) { binding_type = set_layout.binding_types[j]; n_descs = set_layout.n_descs[j]; break; }
-			if(binding_type == -1) return; // descriptor binding point for definition does not exist in set layout
-			// now check that this def has a type compatible with binding_type
-			if(def->def_type == VAR_DEF_BIT && binding_type != 1) return; // invalid; storage variable at non-storage descriptor
-			else if(def->data_type < 21  && binding_type != 0) return; // invalid; uniform data at non-uniform descriptor
-			else if(def->data_type > 20 && def->data_type < 24 && binding_type != 2) return; // invalid; sampler at non-sampler descriptor
-			else if(def->data_type > 20 && def->data_type < 24 && def->elcount != 0 && def->elcount != n_descs) return; // sampler def incompatible with desc bind point
-			else if(def->data_type == 24 && binding_type != 3) return; // invalid; image at non-image descriptor
-			else if(def->data_type == 25 && binding_type != 4) return; // invalid; AS at non-AS descriptor
-		}
-
-		/*** COMPILE THE GENERATED GLSL SOURCE CODE INTO A NEW GL SHADER OBJECT ***/
-		uint32_t gl_vshader_id = 0, gl_pshader_id = 0;
-		pipeline->gl_program = glCreateProgram();
-		gl_vshader_id = glCreateShader(GL_VERTEX_SHADER);
-		gl_pshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(gl_vshader_id, 1, (const GLchar const**)&glsl_vshader.src, 0);
-		glShaderSource(gl_pshader_id, 1, (const GLchar const**)&glsl_pshader.src, 0);
-		glCompileShader(gl_vshader_id);
-		GLint gl_success = 0;
-		glGetShaderiv(gl_vshader_id, GL_COMPILE_STATUS, &gl_success);
-		if(gl_success == GL_FALSE) {
-			GLint log_size = 0;
-			glGetShaderiv(gl_vshader_id, GL_INFO_LOG_LENGTH, &log_size);
-			uint8_t* log = malloc(log_size);
-			glGetShaderInfoLog(gl_vshader_id, log_size, 0, log);
-			printf("create_pipeline() call failed to compile vertex shader, GL error: %s\n", log);
-			glDeleteShader(gl_vshader_id);
-			return;
-		}		
-		glCompileShader(gl_pshader_id);
-		gl_success = 0;
-		glGetShaderiv(gl_pshader_id, GL_COMPILE_STATUS, &gl_success);
-		if(gl_success == GL_FALSE) {
-			GLint log_size = 0;
-			glGetShaderiv(gl_pshader_id, GL_INFO_LOG_LENGTH, &log_size);
-			uint8_t* log = malloc(log_size);
-			glGetShaderInfoLog(gl_pshader_id, log_size, 0, log);
-			printf("create_pipeline() call failed to compile pixel shader, GL error: %s\n", log);
-			glDeleteShader(gl_pshader_id);
+		/*** FIND THE SHADERS IN THE SHADER CACHE, OR TRANSLATE THEM; RETURN IF INVALID ***/
+		int32_t vshader_entry = find_cached_shader(&vshader_object->shader, -1);
+		int32_t pshader_entry = vshader_entry < 0 ? -1 : find_cached_shader(&pshader_object->shader, vshader_entry);
+		if(ASYNC_PIPELINES && pshader_entry < 0) {	// translate on the pipeline worker; the pipeline is pending until update_pipeline_job finishes it
+			pipeline->job = new_pipeline_job(&vshader_object->shader, &pshader_object->shader, vshader_entry);
+			*success = 1;
 			return;
 		}
-		glAttachShader(pipeline->gl_program, gl_vshader_id);
-		glAttachShader(pipeline->gl_program, gl_pshader_id);
-		glLinkProgram(pipeline->gl_program);
-		gl_success = 0;
-		glGetProgramiv(pipeline->gl_program, GL_LINK_STATUS, &gl_success);
-		if(gl_success == GL_FALSE) {
-			GLint log_size = 0;
-			glGetProgramiv(pipeline->gl_program, GL_INFO_LOG_LENGTH, &log_size);
-			uint8_t* log = malloc(log_size);
-			glGetProgramInfoLog(pipeline->gl_program, log_size, 0, log);
-			printf("create_pipeline() call failed to link shader program, GL error: %s\n", log);
-			glDeleteProgram(pipeline->gl_program);
-			return;
+		if(vshader_entry < 0 && (vshader_entry = get_cached_shader(&vshader_object->shader, -1)) < 0) return;
+		if(pshader_entry < 0 && (pshader_entry = get_cached_shader(&pshader_object->shader, vshader_entry)) < 0) return;
+
+		/*** LINK THE SHADERS INTO A GL PROGRAM, OR REUSE THE ONE LINKED FOR AN IDENTICAL PIPELINE ***/
+		uint8_t linked = link_pipeline(pipeline, vshader_entry, pshader_entry, ASYNC_PIPELINES);
+		if(!linked) return;
+		if(linked == 2) {	// the driver is linking on its own threads; the pipeline is pending until update_pipeline_job finishes it
+			pipeline->job = new_pipeline_job(0, 0, vshader_entry);
+			pipeline->job->pshader_entry = pshader_entry;
+			pipeline->job->stage = PIPELINE_JOB_LINKING;
 		}
 	}
 	if(pipeline->type == 1) return;	// this VM does not support ray tracing pipelines
@@ -3203,6 +4874,20 @@ void create_pipeline(pipeline_t* pipeline, uint8_t* info, uint8_t* success, thre
 		}
 		if(n_ubos > max_number_ubos || n_sbos > max_number_sbos || n_samplers > max_number_samplers || n_images > max_number_images)
 			return;
+
+		/*** TRANSLATE THE COMPUTE SHADER AND CHECK IT AGAINST THE SET LAYOUTS; LINK IT INTO A GL PROGRAM IF GL SUPPORTS COMPUTE SHADERS ***/
+		int32_t cshader_entry = get_cached_shader(&cshader_object->shader, -1);
+		if(cshader_entry < 0) return;
+		shader_data_t cshader_data = shader_cache[cshader_entry].data;
+		pipeline->defs_1 = cshader_data.defs; pipeline->n_defs_1 = cshader_data.n_defs;
+		if(cshader_data.n_push_constant_bytes && cshader_data.n_push_constant_bytes != pipeline->n_push_constant_bytes) return;
+		if(!check_pipeline_defs(pipeline)) return;
+		if(gl_compute) {	// without GL compute support the pipeline is still valid, but dispatches using it do nothing
+			if(!(pipeline->gl_program = get_cached_program(cshader_entry, cshader_entry))) return;
+			bind_pipeline_ubo_blocks(pipeline);
+			bind_pipeline_sbo_blocks(pipeline);
+			assign_pipeline_texture_units(pipeline);
+		}
 	}
 	*success = 1;	// if the function reached here, there was no error in creating the pipeline object
 }
@@ -3319,6 +5004,17 @@ uint8_t check_highest_path(uint8_t* a, uint8_t* b) {
 	return 0;	// path b starts with path a
 }
 
+// sets an opened file's stream at the first null pointer in a thread's file_streams array; this is the file stream ID
+void add_file_stream(thread_t* thread, FILE* f, uint16_t* file_id) {
+	for(uint32_t i = 0; i < 65534; i++)
+		if(!thread->file_streams[i]) {
+			thread->file_streams[i] = calloc(1, sizeof(file_stream_t));
+			thread->file_streams[i]->file = f;
+			*file_id = i + 1;
+			break;
+		}
+}
+
 // create some number of directories OR open a file and set the stream FILE* at the first null pointer in file_streams array; this is the file stream ID
 uint8_t open_file(uint8_t* path, uint8_t* highest_path, uint16_t* file_id, thread_t* thread) {
 	if(!validate_path(path)) return 5;	// the filename contains invalid characters
@@ -3336,12 +5032,7 @@ uint8_t open_file(uint8_t* path, uint8_t* highest_path, uint16_t* file_id, threa
 		if(!check_path_existence(path)) {	// if file doesn't exist, create and open it
 			f = fopen(full_path, "w+"); // fails if file's directory doesn't already exist
 			if(f) {
-				for(uint32_t i = 0; i < 65534; i++)
-					if(!thread->file_streams[i]) {
-						thread->file_streams[i] = f;
-						*file_id = i + 1;
-						break;
-					}
+				add_file_stream(thread, f, file_id);
 				free(full_path);
 				return 0;	// file was created and opened
 			} else switch(errno) {
@@ -3351,12 +5042,7 @@ uint8_t open_file(uint8_t* path, uint8_t* highest_path, uint16_t* file_id, threa
 		} else {	// if file does exist, open it
 			f = fopen(full_path, "r+");
 			if(f) {
-				for(uint32_t i = 0; i < 65534; i++)
-					if(!thread->file_streams[i]) {
-						thread->file_streams[i] = f;
-						*file_id = i + 1;
-						break;
-					}
+				add_file_stream(thread, f, file_id);
 				free(full_path);
 				return 0;	// file was opened
 			} else switch(errno) {
@@ -3364,63 +5050,686 @@ uint8_t open_file(uint8_t* path, uint8_t* highest_path, uint16_t* file_id, threa
 				default: free(full_path); return 1;	// unknown error
 			}
 		}
-	} else { // create directory; path ends with /
-		struct stat stat_buf;
-		if(stat(full_path, &stat_buf) == 0 && S_ISDIR(stat_buf.st_mode)) { free(full_path); return 3; }	// all directories exist
-		for(uint32_t i = 0; full_path[i] != '\0'; i++)
-			if(full_path[i] == '/' && full_path[i+1] != '\0') {
-				uint32_t j = i+1;
-				for(; full_path[j] != '/'; j++); // j is index of next /
-				full_path[j] = '\0';
-				if(stat(full_path, &stat_buf) != 0) mkdir(full_path, 0777);
-				full_path[j] = '/';
-				i = j-1;
+	} else { // create directory; path ends with /
+		struct stat stat_buf;
+		if(stat(full_path, &stat_buf) == 0 && S_ISDIR(stat_buf.st_mode)) { free(full_path); return 3; }	// all directories exist
+		for(uint32_t i = 0; full_path[i] != '\0'; i++)
+			if(full_path[i] == '/' && full_path[i+1] != '\0') {
+				uint32_t j = i+1;
+				for(; full_path[j] != '/'; j++); // j is index of next /
+				full_path[j] = '\0';
+				if(stat(full_path, &stat_buf) != 0) mkdir(full_path, 0777);
+				full_path[j] = '/';
+				i = j-1;
+			}
+		free(full_path);
+		return 8;	// directories were created
+	}
+}
+
+// delete an empty directory or delete a file
+uint8_t delete_file(uint8_t* path, uint8_t* highest_path) {
+	if(!validate_path(path)) return 5;      // the filename contains invalid characters
+	if(check_highest_path(highest_path, path)) return 2; // r/w permission denied
+
+	uint8_t code = check_path_existence(path);
+	if(!code) return 1; // unknown error; neither existing file or directory
+
+	uint8_t* full_path;
+	uint32_t full_size;
+	get_full_path(path, &full_path, &full_size);
+
+	if(code == 1) { // existing file
+		// remove file at full_path
+		if(remove(full_path) == -1) { free(full_path); return 1; }	// unknown error
+		free(full_path);
+		return 0;	// no error
+	} else if(code == 2) { // existing directory
+		// remove directory at full_path
+		if(rmdir(full_path) == -1) { free(full_path); return 1; }	// unknown error
+		free(full_path);
+		return 0;	// no error
+	}
+}
+
+// takes an n-byte value and swaps the bytes of it (n is 0 to 7 to represent 1-8 bytes; 0 = 8)
+uint64_t byteswap(uint64_t val, uint8_t n) {
+	if(!val) val = 7;
+	switch(n) {
+		case 1: val &= 0xFFFF; return (val&0xFF)<<8 | (val&0xFF0)>>8; break;
+		case 2: val &= 0xFFFFFF; return (val&0xFF)<<16 | (val&0xFF00) | (val&0xFF0000)>>16; break;
+		case 3: val &= 0xFFFFFFFF; return (val&0xFF)<<24 | (val&0xFF00)<<8 | (val&0xFF0000)>>8 | (val&0xFF000000)>>24; break;
+		case 4: val &= 0xFFFFFFFFFF; return (val&0xFF)<<32 | (val&0xFF00)<<16 | (val&0xFF000000)>>16 | (val&0xFF00000000)>>32; break;
+		case 5: val &= 0xFFFFFFFFFFFF; return (val&0xFF)<<40 | (val&0xFF00)<<24 | (val&0xFF0000)<<8 | (val&0xFF000000)>>8 | (val&0xFF00000000)>>24 | (val&0xFF0000000000)>>40; break;
+		case 6: val &= 0xFFFFFFFFFFFFFF; return (val&0xFF)<<48 | (val&0xFF00)<<32 | (val&0xFF0000)<<16 | (val&0xFF000000) | (val&0xFF00000000)>>16 | (val&0xFF0000000000)>>32 | (val&0xFF000000000000)>>48; break;
+		case 7: val &= 0xFFFFFFFFFFFFFFFF; return (val&0xFF)<<56 | (val&0xFF00)<<40 | (val&0xFF0000)<<24 | (val&0xFF000000)<<8 | (val&0xFF00000000)>>8 | (val&0xFF0000000000)>>24 | (val&0xFF000000000000)>>40 | (val&0xFF00000000000000)>>56; break;
+	}
+}
+
+void exec_cycle(thread_t* thread);
+
+// decoded image files, keyed by full path and the file's modification time + size; the least recently used images' pixels are dropped first
+// an entry only holds the image's header information (from stbi_info) until its pixels are needed
+#define IMAGE_CACHE_MAX_BYTES (256*1024*1024)	// maximum total size of decoded pixels kept in the cache
+#define IMAGE_CACHE_MAX_ENTRIES 1024
+typedef struct image_cache_t {
+	uint64_t key;		// hash of the full path
+	uint8_t* path;		// full path of the file; compared on a key match
+	time_t mtime;		// modification time + size of the file when it was read
+	off_t size;
+	uint8_t valid;		// whether or not the file is a valid image
+	uint32_t width;
+	uint32_t height;
+	uint32_t n_channels;	// number of channels in the file (2 or 4 if it has an alpha channel)
+	uint8_t* pixels;	// decoded 8-bit RGBA pixels; 0 if they haven't been decoded
+	uint64_t last_used;	// value of image_cache_clock when the entry was last used
+} image_cache_t;
+
+image_cache_t* image_cache = 0;
+uint32_t n_cached_images = 0;
+uint64_t image_cache_bytes = 0;	// total size of decoded pixels in the cache
+uint64_t image_cache_clock = 0;
+
+uint64_t image_cache_key(uint8_t* path) {
+	uint64_t key = 0xCBF29CE484222325ull;
+	for(uint8_t* c = path; *c; c++) key = (key ^ *c) * 0x100000001B3ull;
+	return key;
+}
+
+void drop_cached_image_pixels(image_cache_t* entry) {
+	if(!entry->pixels) return;
+	stbi_image_free(entry->pixels);
+	entry->pixels = 0;
+	image_cache_bytes -= (uint64_t)entry->width*entry->height*4;
+}
+
+void forget_image_decodes(uint8_t* path);
+
+// removes an image file's entry from the cache; done when the file is written, in case its modification time + size don't change
+// pending decodes of the file won't be stored in the cache either
+void forget_cached_image(uint8_t* path) {
+	forget_image_decodes(path);
+	uint64_t key = image_cache_key(path);
+	for(uint32_t i = 0; i < n_cached_images; i++) {
+		if(image_cache[i].key != key || strcmp(image_cache[i].path, path) != 0) continue;
+		drop_cached_image_pixels(&image_cache[i]);
+		free(image_cache[i].path);
+		image_cache[i] = image_cache[--n_cached_images];
+		return;
+	}
+}
+
+// gives a cache entry its decoded pixels, dropping the least recently used pixels of other entries to stay under IMAGE_CACHE_MAX_BYTES
+void set_cached_image_pixels(image_cache_t* entry, uint8_t* pixels) {
+	entry->pixels = pixels;
+	image_cache_bytes += (uint64_t)entry->width*entry->height*4;
+	while(image_cache_bytes > IMAGE_CACHE_MAX_BYTES) {	// drop the least recently used pixels other than these
+		image_cache_t* lru = 0;
+		for(uint32_t i = 0; i < n_cached_images; i++)
+			if(image_cache[i].pixels && &image_cache[i] != entry && (!lru || image_cache[i].last_used < lru->last_used)) lru = &image_cache[i];
+		if(!lru) break;
+		drop_cached_image_pixels(lru);
+	}
+}
+
+// returns the cache entry of an image file (full path), or 0 if the file isn't a valid image; its pixels are decoded too if decode is set
+// the entry is only valid until the next call
+image_cache_t* get_cached_image(uint8_t* path, uint8_t decode) {
+	struct stat stat_buf;
+	if(stat(path, &stat_buf) || !S_ISREG(stat_buf.st_mode)) return 0;
+	uint64_t key = image_cache_key(path);
+	image_cache_t* entry = 0;
+	for(uint32_t i = 0; i < n_cached_images; i++)
+		if(image_cache[i].key == key && strcmp(image_cache[i].path, path) == 0) { entry = &image_cache[i]; break; }
+
+	if(entry && (entry->mtime != stat_buf.st_mtime || entry->size != stat_buf.st_size)) {	// file has changed since it was read
+		forget_cached_image(path);
+		entry = 0;
+	}
+	if(!entry) {
+		if(n_cached_images == IMAGE_CACHE_MAX_ENTRIES) {	// remove the least recently used entry
+			uint32_t lru = 0;
+			for(uint32_t i = 1; i < n_cached_images; i++)
+				if(image_cache[i].last_used < image_cache[lru].last_used) lru = i;
+			forget_cached_image(image_cache[lru].path);
+		}
+		image_cache = realloc(image_cache, (n_cached_images+1)*sizeof(image_cache_t));
+		entry = &image_cache[n_cached_images++];
+		memset(entry, 0, sizeof(image_cache_t));
+		entry->key = key;
+		entry->path = strdup(path);
+		entry->mtime = stat_buf.st_mtime;
+		entry->size = stat_buf.st_size;
+		int32_t w, h, n;
+		entry->valid = stbi_info(path, &w, &h, &n);	// only read the header
+		if(entry->valid) { entry->width = w; entry->height = h; entry->n_channels = n; }
+	}
+	entry->last_used = ++image_cache_clock;
+	if(!entry->valid) return 0;
+	if(!decode || entry->pixels) return entry;
+
+	int32_t w, h, n;
+	uint8_t* pixels = stbi_load(path, &w, &h, &n, 4);
+	if(!pixels) { entry->valid = 0; return 0; }	// header is valid, but the image data isn't
+	set_cached_image_pixels(entry, pixels);
+	return entry;
+}
+
+// video/image files loaded to video data objects are decoded on a pool of worker threads; the frame count and resolution are known from the file
+// header, and the decoded pixels become the frames once the main loop sees the job finish (see update_image_decode_jobs)
+// a job decodes one image file (a still image or a frame of an image sequence) or a range of the frames of a GIF
+#define MAX_IMAGE_DECODE_THREADS 8
+typedef struct image_decode_job_t {
+	uint8_t* path;		// full path of the image file
+	uint64_t vid_data_id;	// ID of the video data object to load to; 0 if the object was deleted or loaded to again before the decode finished
+				// (only used by the main thread)
+	uint32_t frame;		// first frame of the video data object to load to
+	uint32_t file_frame;	// first frame of the file to decode (GIF)
+	uint32_t n_frames;	// number of frames to decode
+	uint8_t gif;
+	uint32_t width;		// resolution read from the header
+	uint32_t height;
+	uint8_t** pixels;	// decoded 8-bit RGBA pixels of each frame; 0 if decoding failed
+	uint8_t* cache_pixels;	// copy of the pixels of a still image or image sequence frame, made by the worker for the image cache
+	uint8_t cacheable;	// whether or not cache_pixels may be stored in the image cache; unset if the file is written before the job finishes
+				// (only used by the main thread)
+	time_t mtime;		// modification time + size of the file when the job was queued
+	off_t size;
+	uint8_t finished;
+} image_decode_job_t;
+
+pthread_mutex_t image_decode_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t image_decode_queued = PTHREAD_COND_INITIALIZER;	// signaled when a job is queued for the workers
+pthread_cond_t image_decode_finished = PTHREAD_COND_INITIALIZER;	// signaled when a worker finishes a job
+image_decode_job_t** image_decode_queue = 0;	// jobs waiting for a worker, oldest first
+uint32_t n_queued_image_decodes = 0;
+uint32_t n_image_decode_threads = 0;
+image_decode_job_t** image_decode_jobs = 0;	// all unfinished or uninstalled jobs
+uint32_t n_image_decode_jobs = 0;
+
+void decode_image_job(image_decode_job_t* job) {
+	int32_t w, h, n, z = 1;
+	uint8_t* pixels = 0;
+	int32_t* delays = 0;
+	if(job->gif) {	// stb_image only decodes all frames of a GIF at once, from memory
+		FILE* f = fopen(job->path, "rb");
+		if(f) {
+			fseek(f, 0, SEEK_END);
+			int64_t size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			uint8_t* data = size > 0 ? malloc(size) : 0;
+			if(data && fread(data, 1, size, f) == size)
+				pixels = stbi_load_gif_from_memory(data, size, &delays, &w, &h, &z, &n, 4);
+			free(data);
+			fclose(f);
+		}
+		if(delays) stbi_image_free(delays);
+	} else pixels = stbi_load(job->path, &w, &h, &n, 4);
+	if(!pixels) return;
+	if(w == job->width && h == job->height && job->file_frame + job->n_frames <= z) {	// otherwise, the file changed since its header was read
+		uint64_t frame_size = (uint64_t)w*h*4;
+		job->pixels = malloc(job->n_frames*sizeof(uint8_t*));
+		if(!job->gif) {
+			job->pixels[0] = pixels;
+			job->cache_pixels = malloc(frame_size);
+			memcpy(job->cache_pixels, pixels, frame_size);
+		} else for(uint32_t i = 0; i < job->n_frames; i++) {
+			job->pixels[i] = malloc(frame_size);
+			memcpy(job->pixels[i], pixels + (job->file_frame+i)*frame_size, frame_size);
+		}
+		if(job->gif) stbi_image_free(pixels);
+	} else stbi_image_free(pixels);
+}
+
+void* image_decode_worker(void* arg) {
+	pthread_mutex_lock(&image_decode_mutex);
+	while(1) {
+		while(!n_queued_image_decodes) pthread_cond_wait(&image_decode_queued, &image_decode_mutex);
+		image_decode_job_t* job = image_decode_queue[0];
+		memmove(image_decode_queue, image_decode_queue+1, (--n_queued_image_decodes)*sizeof(image_decode_job_t*));
+		pthread_mutex_unlock(&image_decode_mutex);
+		decode_image_job(job);
+		pthread_mutex_lock(&image_decode_mutex);
+		job->finished = 1;
+		pthread_cond_broadcast(&image_decode_finished);
+	}
+	return 0;
+}
+
+// starts decoding n_frames frames of a width x height image file (full path), starting at frame file_frame of it (GIF), to the frames of a video
+// data object starting at frame; those frames must be allocated (and 0) beforehand
+void queue_image_decode(uint64_t vid_data_id, uint32_t frame, uint8_t* path, uint8_t gif, uint32_t file_frame, uint32_t n_frames, uint32_t width, uint32_t height) {
+	image_decode_job_t* job = calloc(1, sizeof(image_decode_job_t));
+	job->path = strdup(path);
+	job->vid_data_id = vid_data_id;
+	job->frame = frame;
+	job->file_frame = file_frame;
+	job->n_frames = n_frames;
+	job->gif = gif;
+	job->width = width;
+	job->height = height;
+	struct stat stat_buf;
+	job->cacheable = !gif && stat(path, &stat_buf) == 0;
+	if(job->cacheable) { job->mtime = stat_buf.st_mtime; job->size = stat_buf.st_size; }
+	objects[vid_data_id-1].vid_data.n_decode_jobs++;
+	image_decode_jobs = realloc(image_decode_jobs, (n_image_decode_jobs+1)*sizeof(image_decode_job_t*));
+	image_decode_jobs[n_image_decode_jobs++] = job;
+
+	pthread_mutex_lock(&image_decode_mutex);
+	if(n_queued_image_decodes >= n_image_decode_threads && n_image_decode_threads < MAX_IMAGE_DECODE_THREADS) {	// start another worker for the backlog, up to one per CPU
+		long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		pthread_t worker;
+		if((n_image_decode_threads < n_cpus || !n_image_decode_threads) && pthread_create(&worker, 0, image_decode_worker, 0) == 0) {
+			pthread_detach(worker);
+			n_image_decode_threads++;
+		}
+	}
+	if(n_image_decode_threads) {
+		image_decode_queue = realloc(image_decode_queue, (n_queued_image_decodes+1)*sizeof(image_decode_job_t*));
+		image_decode_queue[n_queued_image_decodes++] = job;
+		pthread_cond_signal(&image_decode_queued);
+	}
+	pthread_mutex_unlock(&image_decode_mutex);
+	if(!n_image_decode_threads) {	// no workers; decode now
+		decode_image_job(job);
+		job->finished = 1;
+	}
+}
+
+// keeps the pending decodes of an image file (full path) out of the image cache; done when the file is written
+void forget_image_decodes(uint8_t* path) {
+	for(uint32_t i = 0; i < n_image_decode_jobs; i++)
+		if(strcmp(image_decode_jobs[i]->path, path) == 0) image_decode_jobs[i]->cacheable = 0;
+}
+
+// stores the pixels a decode job copied for the image cache in the file's cache entry, so loading the file again doesn't decode it again
+// they are only stored if the file has the modification time + size it had when the job was queued and wasn't written since
+void cache_decoded_image(image_decode_job_t* job) {
+	image_cache_t* entry = job->cacheable ? get_cached_image(job->path, 0) : 0;
+	if(entry && !entry->pixels && entry->mtime == job->mtime && entry->size == job->size && entry->width == job->width && entry->height == job->height)
+		set_cached_image_pixels(entry, job->cache_pixels);
+	else free(job->cache_pixels);
+	job->cache_pixels = 0;
+}
+
+// whether or not a decode job loads to a video data object
+uint8_t is_image_decode_for(image_decode_job_t* job, vid_data_t* vid_data) { return job->vid_data_id && &objects[job->vid_data_id-1].vid_data == vid_data; }
+
+// detaches the pending decodes of a video data object, whose results are then discarded; done when the object is deleted or loaded to again
+void cancel_image_decode(vid_data_t* vid_data) {
+	if(!vid_data->n_decode_jobs) return;
+	for(uint32_t i = 0; i < n_image_decode_jobs; i++)
+		if(is_image_decode_for(image_decode_jobs[i], vid_data)) image_decode_jobs[i]->vid_data_id = 0;
+	vid_data->n_decode_jobs = 0;
+}
+
+// frees the frames of a video data object, cancelling any decodes of them
+void clear_vid_data(vid_data_t* vid_data) {
+	cancel_image_decode(vid_data);
+	for(uint32_t i = 0; i < vid_data->n_frames; i++)
+		if(vid_data->frames[i])
+			free(vid_data->frames[i]);
+	if(vid_data->n_frames)
+		free(vid_data->frames);
+	if(vid_data->frames_file) fclose(vid_data->frames_file);
+	memset(vid_data, 0, sizeof(vid_data_t));
+}
+
+// moves the pixels of finished decodes into their video data objects; a decode that failed leaves its object without any frames
+// decoded image files (other than GIFs) are also stored in the image cache
+void update_image_decode_jobs() {
+	if(!n_image_decode_jobs) return;
+	pthread_mutex_lock(&image_decode_mutex);
+	for(uint32_t i = 0; i < n_image_decode_jobs; i++) {
+		image_decode_job_t* job = image_decode_jobs[i];
+		if(!job->finished) continue;
+		if(job->cache_pixels) cache_decoded_image(job);
+		if(job->vid_data_id) {
+			vid_data_t* vid_data = &objects[job->vid_data_id-1].vid_data;
+			vid_data->n_decode_jobs--;
+			if(!job->pixels) clear_vid_data(vid_data);	// also cancels the object's other decodes
+			else for(uint32_t j = 0; j < job->n_frames; j++)
+				vid_data->frames[job->frame+j] = job->pixels[j];
+		} else if(job->pixels)
+			for(uint32_t j = 0; j < job->n_frames; j++)
+				stbi_image_free(job->pixels[j]);
+		free(job->pixels);
+		free(job->path);
+		free(job);
+		image_decode_jobs[i--] = image_decode_jobs[--n_image_decode_jobs];
+	}
+	pthread_mutex_unlock(&image_decode_mutex);
+}
+
+// finishes the pending decodes of a video data object now; jobs no worker has taken yet are decoded on this thread
+void wait_image_decode(vid_data_t* vid_data) {
+	if(!vid_data->n_decode_jobs) return;
+	pthread_mutex_lock(&image_decode_mutex);
+	for(uint32_t i = 0; i < n_queued_image_decodes; i++) {
+		image_decode_job_t* job = image_decode_queue[i];
+		if(!is_image_decode_for(job, vid_data)) continue;
+		memmove(image_decode_queue+i, image_decode_queue+i+1, (--n_queued_image_decodes-i)*sizeof(image_decode_job_t*));
+		i--;
+		pthread_mutex_unlock(&image_decode_mutex);
+		decode_image_job(job);
+		pthread_mutex_lock(&image_decode_mutex);
+		job->finished = 1;
+	}
+	for(uint32_t i = 0; i < n_image_decode_jobs; i++)
+		if(is_image_decode_for(image_decode_jobs[i], vid_data) && !image_decode_jobs[i]->finished) {
+			pthread_cond_wait(&image_decode_finished, &image_decode_mutex);
+			i = -1;	// check all of them again
+		}
+	pthread_mutex_unlock(&image_decode_mutex);
+	update_image_decode_jobs();
+}
+
+// returns a frame of a video data object, reading it from its raw frame container first if it hasn't been yet; 0 if it's still being decoded
+uint8_t* get_vid_data_frame(vid_data_t* vid_data, uint32_t frame) {
+	if(vid_data->frames[frame] || !vid_data->frames_file) return vid_data->frames[frame];
+	uint64_t frame_size = (uint64_t)vid_data->width*vid_data->height*4;
+	uint8_t* pixels = calloc(1, frame_size);	// if the file was shortened since it was loaded, the missing part of the frame is 0
+	pread(fileno(vid_data->frames_file), pixels, frame_size, vid_data->frames_offset + frame*frame_size);
+	vid_data->frames[frame] = pixels;
+	return pixels;
+}
+
+// builds the path of a frame of an image sequence (see open_video_stream) from the sequence's path; the returned path is allocated
+uint8_t* get_sequence_frame_path(uint8_t* path, uint32_t frame) {
+	uint8_t* ext = strrchr(path, '.');
+	uint8_t* frame_path = malloc(strlen(path)+16);
+	sprintf(frame_path, "%.*s_%06u%s", (uint32_t)(ext-path), path, frame, ext);
+	return frame_path;
+}
+
+// supported video/image files: still images (PNG/JPEG), image sequences (a PNG/JPEG path that doesn't exist, whose frame files do), GIFs, and
+// raw frame containers (see open_video_stream)
+#define VIDEO_FILE_IMAGE 0
+#define VIDEO_FILE_SEQUENCE 1
+#define VIDEO_FILE_GIF 2
+#define VIDEO_FILE_PVF 3
+typedef struct video_file_info_t {
+	uint8_t type;
+	uint32_t width;
+	uint32_t height;
+	uint32_t n_frames;
+	uint32_t frame_rate;
+	uint8_t alpha;	// whether or not the file has an alpha channel
+	uint64_t frames_offset;	// raw frame containers; offset of frame 0
+} video_file_info_t;
+
+// counts the frames of a GIF by walking its blocks without decoding them; the frame rate is from the delay of the first frame (0 if not animated)
+uint8_t read_gif_frame_info(uint8_t* path, uint32_t* n_frames, uint32_t* frame_rate) {
+	FILE* f = fopen(path, "rb");
+	if(!f) return 0;
+	uint8_t header[13];
+	if(fread(header, 1, 13, f) != 13 || memcmp(header, "GIF", 3) != 0) { fclose(f); return 0; }
+	if(header[10] & 0x80) fseek(f, 3 << ((header[10] & 7) + 1), SEEK_CUR);	// global color table
+	uint32_t delay = 0;
+	*n_frames = 0;
+	int32_t c;
+	while((c = fgetc(f)) != EOF && c != 0x3B) {	// until the trailer
+		if(c == 0x21) {	// extension
+			int32_t label = fgetc(f);
+			if(label == 0xF9 && !*n_frames) {	// graphic control extension of the first frame
+				uint8_t gce[6];
+				if(fread(gce, 1, 6, f) != 6) break;
+				delay = gce[2] | gce[3] << 8;	// in hundredths of a second
+				if(gce[5]) fseek(f, -1, SEEK_CUR);	// not the terminator; let the sub-block loop below skip the rest
+				else continue;
 			}
-		free(full_path);
-		return 8;	// directories were created
+		} else if(c == 0x2C) {	// image descriptor
+			uint8_t desc[9];
+			if(fread(desc, 1, 9, f) != 9) break;
+			if(desc[8] & 0x80) fseek(f, 3 << ((desc[8] & 7) + 1), SEEK_CUR);	// local color table
+			fgetc(f);	// LZW minimum code size
+			(*n_frames)++;
+		} else break;	// not a valid block
+		int32_t size;
+		while((size = fgetc(f)) > 0) fseek(f, size, SEEK_CUR);	// skip the data sub-blocks
+		if(size == EOF) break;
 	}
+	fclose(f);
+	if(!*n_frames) return 0;
+	*frame_rate = *n_frames == 1 ? 0 : 100 / (delay ? delay : 10);	// like browsers, a delay of 0 is taken as 1/10 of a second
+	if(*n_frames > 1 && !*frame_rate) *frame_rate = 1;
+	return 1;
 }
 
-// delete an empty directory or delete a file
-uint8_t delete_file(uint8_t* path, uint8_t* highest_path) {
-	if(!validate_path(path)) return 5;      // the filename contains invalid characters
-	if(check_highest_path(highest_path, path)) return 2; // r/w permission denied
+// reads the frame count, frame rate, and resolution of a video/image file (full path, of a supported format); returns 0 if the file isn't valid
+uint8_t get_video_file_info(uint8_t* path, video_file_info_t* info) {
+	memset(info, 0, sizeof(video_file_info_t));
+	char* ext = get_string_file_ext(path);
+	if(strcmp(ext, "pvf") == 0) {
+		FILE* f = fopen(path, "rb");
+		if(!f) return 0;
+		uint32_t header[4];
+		uint8_t valid = fread(header, 1, 16, f) == 16 && memcmp(header, "PVF1", 4) == 0 && header[1] && header[2];
+		fseek(f, 0, SEEK_END);
+		uint64_t size = ftell(f);
+		fclose(f);
+		if(!valid) return 0;
+		info->type = VIDEO_FILE_PVF;
+		info->width = header[1];
+		info->height = header[2];
+		info->frame_rate = header[3];
+		info->n_frames = (size-16) / ((uint64_t)info->width*info->height*4);
+		info->alpha = 1;
+		info->frames_offset = 16;
+		return info->n_frames != 0;
+	}
+	struct stat stat_buf;
+	uint8_t is_sequence = stat(path, &stat_buf) != 0;
+	uint8_t* frame_path = is_sequence ? get_sequence_frame_path(path, 0) : path;
+	image_cache_t* image = get_cached_image(frame_path, 0);
+	if(is_sequence) free(frame_path);
+	if(!image) return 0;
+	info->width = image->width;
+	info->height = image->height;
+	info->alpha = image->n_channels == 4;
+	info->n_frames = 1;
+	if(is_sequence) {
+		info->type = VIDEO_FILE_SEQUENCE;
+		while(1) {	// count the frame files up to the first one missing
+			frame_path = get_sequence_frame_path(path, info->n_frames);
+			uint8_t exists = stat(frame_path, &stat_buf) == 0;
+			free(frame_path);
+			if(!exists) break;
+			info->n_frames++;
+		}
+	} else if(strcmp(ext, "gif") == 0) {
+		info->type = VIDEO_FILE_GIF;
+		info->alpha = 1;	// transparency of GIFs is only known once decoded
+		return read_gif_frame_info(path, &info->n_frames, &info->frame_rate);
+	}
+	return 1;
+}
 
-	uint8_t code = check_path_existence(path);
-	if(!code) return 1; // unknown error; neither existing file or directory
+// reads a video/image file path string from main memory, returning its full path if it's a valid, accessible path to a file of a supported
+// video/image format or to an image sequence (0 otherwise)
+uint8_t* get_video_file_path(thread_t* thread, uint64_t path_addr) {
+	uint8_t* path_str = 0;
+	uint32_t path_length = get_string_main_mem(thread, path_addr, &path_str);
+	if(!path_length) return 0;
+	uint8_t* full_path = 0;
+	if(validate_path(path_str) && !check_highest_path(thread->highest_dir, path_str)) {
+		char* ext = get_string_file_ext(path_str);
+		uint8_t is_image = ext && (strcmp(ext, "png") == 0 || strcmp(ext, "jpg") == 0 || strcmp(ext, "jpeg") == 0);
+		uint8_t path_type = check_path_existence(path_str);
+		if(path_type == 1 && (is_image || strcmp(ext, "gif") == 0 || strcmp(ext, "pvf") == 0)) {
+			uint32_t full_size;
+			get_full_path(path_str, &full_path, &full_size);
+		} else if(!path_type && is_image) {	// could be an image sequence; its frame files are checked by get_video_file_info
+			uint32_t full_size;
+			get_full_path(path_str, &full_path, &full_size);
+		}
+	}
+	free(path_str);
+	return full_path;
+}
 
-	uint8_t* full_path;
-	uint32_t full_size;
-	get_full_path(path, &full_path, &full_size);
+// reads an image file path string from main memory, returning its full path if it's a valid, accessible path to a file of a supported image format (0 otherwise)
+uint8_t* get_image_file_path(thread_t* thread, uint64_t path_addr) {
+	uint8_t* path_str = 0;
+	uint32_t path_length = get_string_main_mem(thread, path_addr, &path_str);
+	if(!path_length) return 0;
+	uint8_t* full_path = 0;
+	if(validate_path(path_str) && check_path_existence(path_str) == 1 && !check_highest_path(thread->highest_dir, path_str)) {
+		char* ext = get_string_file_ext(path_str);
+		if(ext && (strcmp(ext, "png") == 0 || strcmp(ext, "jpg") == 0 || strcmp(ext, "jpeg") == 0)) {
+			uint32_t full_size;
+			get_full_path(path_str, &full_path, &full_size);
+		}
+	}
+	free(path_str);
+	return full_path;
+}
 
-	if(code == 1) { // existing file
-		// remove file at full_path
-		if(remove(full_path) == -1) { free(full_path); return 1; }	// unknown error
-		free(full_path);
-		return 0;	// no error
-	} else if(code == 2) { // existing directory
-		// remove directory at full_path
-		if(rmdir(full_path) == -1) { free(full_path); return 1; }	// unknown error
-		free(full_path);
-		return 0;	// no error
+// extension: captured frames can be appended to a video stream file, either a raw frame container (.pvf) or a PNG sequence (.png; frame n is
+// written to the path with _n, zero-padded to 6 digits, inserted before the extension, so the frame numbers are the index of the sequence)
+// a raw frame container is a 16-byte header (the ASCII characters "PVF1", then 32-bit unsigned integers of the width, height, and frame rate),
+// followed by the frames as 8-bit RGBA pixel arrays (starting at the top row); its frame count is the number of whole frames after the header
+#define VIDEO_STREAM_MAX_QUEUED 8	// frames a stream can have queued for the writer; a thread appending to a full stream waits (see exec_cycle)
+typedef struct video_stream_t {
+	uint8_t* path;	// full path of the file (PNG sequences: of frame files, without the frame number)
+	FILE* file;	// raw frame container; 0 for PNG sequences
+	uint32_t width;
+	uint32_t height;
+	uint32_t n_frames;	// frames appended so far
+	uint32_t n_queued;	// frames appended but not yet written; guarded by video_stream_mutex
+	uint64_t thread_id;	// the thread that opened the stream; only it can append to or close the stream
+} video_stream_t;
+
+typedef struct video_stream_job_t {
+	video_stream_t* stream;
+	uint32_t frame;
+	uint8_t* pixels;	// 0 to close the stream once its frames before this are written
+} video_stream_job_t;
+
+pthread_mutex_t video_stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t video_stream_queued = PTHREAD_COND_INITIALIZER;	// signaled when a job is queued for the writer
+pthread_cond_t video_stream_written = PTHREAD_COND_INITIALIZER;	// signaled when the writer finishes a job
+video_stream_job_t* video_stream_queue = 0;	// jobs waiting for the writer, oldest first; a single writer keeps each stream's frames in order
+uint32_t n_queued_video_stream_jobs = 0;
+uint8_t video_stream_writer_started = 0;
+video_stream_t** video_streams = 0;	// open streams by ID-1; 0 once closed (IDs aren't reused)
+uint32_t n_video_streams = 0;
+
+void write_video_stream_job(video_stream_job_t* job) {
+	video_stream_t* stream = job->stream;
+	if(!job->pixels) {
+		if(stream->file) fclose(stream->file);
+		free(stream->path);
+		free(stream);
+		return;
+	}
+	if(stream->file) fwrite(job->pixels, 1, (uint64_t)stream->width*stream->height*4, stream->file);
+	else {
+		uint8_t* ext = strrchr(stream->path, '.');
+		uint32_t stem_length = ext - stream->path;
+		uint8_t* frame_path = malloc(strlen(stream->path)+16);
+		sprintf(frame_path, "%.*s_%06u%s", stem_length, stream->path, job->frame, ext);
+		stbi_write_png(frame_path, stream->width, stream->height, 4, job->pixels, stream->width*4);
+		free(frame_path);
 	}
+	free(job->pixels);
 }
 
-// takes an n-byte value and swaps the bytes of it (n is 0 to 7 to represent 1-8 bytes; 0 = 8)
-uint64_t byteswap(uint64_t val, uint8_t n) {
-	if(!val) val = 7;
-	switch(n) {
-		case 1: val &= 0xFFFF; return (val&0xFF)<<8 | (val&0xFF0)>>8; break;
-		case 2: val &= 0xFFFFFF; return (val&0xFF)<<16 | (val&0xFF00) | (val&0xFF0000)>>16; break;
-		case 3: val &= 0xFFFFFFFF; return (val&0xFF)<<24 | (val&0xFF00)<<8 | (val&0xFF0000)>>8 | (val&0xFF000000)>>24; break;
-		case 4: val &= 0xFFFFFFFFFF; return (val&0xFF)<<32 | (val&0xFF00)<<16 | (val&0xFF000000)>>16 | (val&0xFF00000000)>>32; break;
-		case 5: val &= 0xFFFFFFFFFFFF; return (val&0xFF)<<40 | (val&0xFF00)<<24 | (val&0xFF0000)<<8 | (val&0xFF000000)>>8 | (val&0xFF00000000)>>24 | (val&0xFF0000000000)>>40; break;
-		case 6: val &= 0xFFFFFFFFFFFFFF; return (val&0xFF)<<48 | (val&0xFF00)<<32 | (val&0xFF0000)<<16 | (val&0xFF000000) | (val&0xFF00000000)>>16 | (val&0xFF0000000000)>>32 | (val&0xFF000000000000)>>48; break;
-		case 7: val &= 0xFFFFFFFFFFFFFFFF; return (val&0xFF)<<56 | (val&0xFF00)<<40 | (val&0xFF0000)<<24 | (val&0xFF000000)<<8 | (val&0xFF00000000)>>8 | (val&0xFF0000000000)>>24 | (val&0xFF000000000000)>>40 | (val&0xFF00000000000000)>>56; break;
+void* video_stream_writer(void* arg) {
+	pthread_mutex_lock(&video_stream_mutex);
+	while(1) {
+		while(!n_queued_video_stream_jobs) pthread_cond_wait(&video_stream_queued, &video_stream_mutex);
+		video_stream_job_t job = video_stream_queue[0];
+		pthread_mutex_unlock(&video_stream_mutex);
+		write_video_stream_job(&job);
+		pthread_mutex_lock(&video_stream_mutex);
+		memmove(video_stream_queue, video_stream_queue+1, (--n_queued_video_stream_jobs)*sizeof(video_stream_job_t));	// dequeued after writing, so the queue empties only once everything is written
+		if(job.pixels) job.stream->n_queued--;
+		pthread_cond_broadcast(&video_stream_written);
 	}
+	return 0;
 }
 
-void exec_cycle(thread_t* thread);
+// queues a job for the writer, starting it if it isn't running; without a writer, the job is done now
+void queue_video_stream_job(video_stream_t* stream, uint32_t frame, uint8_t* pixels) {
+	pthread_mutex_lock(&video_stream_mutex);
+	if(!video_stream_writer_started) {
+		pthread_t writer;
+		if(pthread_create(&writer, 0, video_stream_writer, 0) == 0) {
+			pthread_detach(writer);
+			video_stream_writer_started = 1;
+		}
+	}
+	if(video_stream_writer_started) {
+		video_stream_queue = realloc(video_stream_queue, (n_queued_video_stream_jobs+1)*sizeof(video_stream_job_t));
+		video_stream_queue[n_queued_video_stream_jobs++] = (video_stream_job_t){ stream, frame, pixels };
+		if(pixels) stream->n_queued++;
+		pthread_cond_signal(&video_stream_queued);
+		pthread_mutex_unlock(&video_stream_mutex);
+		return;
+	}
+	pthread_mutex_unlock(&video_stream_mutex);
+	video_stream_job_t job = { stream, frame, pixels };
+	write_video_stream_job(&job);
+}
+
+// returns whether or not an open video stream has room in its queue for another frame
+uint8_t video_stream_has_room(video_stream_t* stream) {
+	pthread_mutex_lock(&video_stream_mutex);
+	uint8_t has_room = stream->n_queued < VIDEO_STREAM_MAX_QUEUED;
+	pthread_mutex_unlock(&video_stream_mutex);
+	return has_room;
+}
+
+// copies a frame from main memory and queues it to be appended to an open video stream
+void append_video_stream_frame(thread_t* thread, video_stream_t* stream, uint64_t pixels_addr) {
+	uint64_t frame_size = (uint64_t)stream->width*stream->height*4;
+	if(check_segfault(thread, pixels_addr, frame_size)) return;
+	queue_video_stream_job(stream, stream->n_frames++, read_main_mem(thread, pixels_addr, frame_size));
+}
+
+// opens a video stream file (full path) for writing for a thread, returning its stream ID (0 if it couldn't be created)
+uint64_t open_video_stream(thread_t* thread, uint8_t* full_path, uint32_t width, uint32_t height, uint32_t frame_rate) {
+	video_stream_t* stream = calloc(1, sizeof(video_stream_t));
+	if(strcmp(get_string_file_ext(full_path), "pvf") == 0) {
+		stream->file = fopen(full_path, "wb");
+		file_size_epoch++;	// an existing file is truncated
+		if(!stream->file) { free(stream); return 0; }
+		uint32_t header[4] = { 0, width, height, frame_rate };
+		memcpy(header, "PVF1", 4);
+		fwrite(header, 1, 16, stream->file);
+	}
+	stream->path = strdup(full_path);
+	stream->width = width;
+	stream->height = height;
+	stream->thread_id = thread->id;
+	video_streams = realloc(video_streams, (n_video_streams+1)*sizeof(video_stream_t*));
+	video_streams[n_video_streams++] = stream;
+	return n_video_streams;
+}
+
+// returns an open video stream of a thread by its ID, or 0 if the ID isn't of a stream the thread opened
+video_stream_t* get_video_stream(thread_t* thread, uint64_t stream_id) {
+	if(!stream_id || stream_id > n_video_streams || !video_streams[stream_id-1]) return 0;
+	if(video_streams[stream_id-1]->thread_id != thread->id) return 0;
+	return video_streams[stream_id-1];
+}
+
+// closes a video stream; its remaining frames are still written
+void close_video_stream(uint64_t stream_id) {
+	if(!stream_id || stream_id > n_video_streams || !video_streams[stream_id-1]) return;
+	queue_video_stream_job(video_streams[stream_id-1], 0, 0);
+	video_streams[stream_id-1] = 0;
+}
+
+// closes all video streams and waits for the writer to finish; done before exiting
+void finish_video_streams() {
+	for(uint32_t i = 0; i < n_video_streams; i++)
+		close_video_stream(i+1);
+	pthread_mutex_lock(&video_stream_mutex);
+	while(n_queued_video_stream_jobs) pthread_cond_wait(&video_stream_written, &video_stream_mutex);
+	pthread_mutex_unlock(&video_stream_mutex);
+}
 
 void instruction_0(thread_t* thread) { thread->output = &thread->regs[0]; }
 void instruction_1(thread_t* thread) { thread->output = &thread->regs[1]; }
@@ -3908,9 +6217,9 @@ void instruction_62(thread_t* thread) {
 	// close a file stream named by primary register
 	uint16_t stream_id = *thread->primary;
 	if(*thread->primary == 0) stream_id = (thread->regs[13] & 0xFFFF0000000)>>28;
-	if(stream_id > 65535 || stream_id == 0) { update_stream_open(thread); return; }
-	FILE* f = thread->file_streams[stream_id-1];
-	if(f) fclose(f);
+	if(stream_id > 65534 || stream_id == 0) { update_stream_open(thread); return; }
+	file_stream_t* stream = thread->file_streams[stream_id-1];
+	if(stream) { fclose(stream->file); free(stream); }
 	thread->file_streams[stream_id-1] = 0;
 	update_stream_open(thread);
 }
@@ -3921,62 +6230,39 @@ void instruction_63(thread_t* thread) {
 void instruction_64(thread_t* thread) { // write to file
 	if(!thread->perm_file_io) return;
 	uint64_t data_addr = *thread->primary;
-	if(check_segfault(thread, data_addr, *thread->output+1)) { update_stream_open(thread); return; }
-	uint8_t* data = read_main_mem(thread, data_addr, *thread->output+1); // data to write to file
 	uint64_t data_size = *thread->output + 1;
-	uint16_t stream_id = (thread->regs[13] & 0xFFFF0000000)>>28;
-	uint64_t file_size = 0;
-	if(!stream_id) { update_stream_open(thread); return; }	// file stream id is 0 (which is reserved)
-	if(thread->file_streams[stream_id-1]) { // get the size of the file
-		uint64_t prev = ftell(thread->file_streams[stream_id-1]);
-		fseek(thread->file_streams[stream_id-1], 0L, SEEK_END);
-		file_size = ftell(thread->file_streams[stream_id-1]);
-		fseek(thread->file_streams[stream_id-1], prev, SEEK_SET);
-	} else { update_stream_open(thread); return; } // this file is not open
-	if(*thread->secondary + data_size - 1 > file_size) { update_stream_open(thread); return; } // data write out of range of file
-	// write to file "data", for number of bytes specified by data_size, at byte addressed by secondary reg
-	fseek(thread->file_streams[stream_id-1], *thread->secondary, SEEK_SET);
-	fwrite(data, 1, data_size, thread->file_streams[stream_id-1]);
-	fseek(thread->file_streams[stream_id-1], 0, SEEK_SET);
-	free(data);
+	if(check_segfault(thread, data_addr, data_size)) { update_stream_open(thread); return; }
+	file_stream_t* stream = get_current_file_stream(thread);
+	if(!stream) { update_stream_open(thread); return; }	// file stream id is 0 (which is reserved), or this file is not open
+	if(!check_file_stream_range(stream, *thread->secondary, data_size)) { update_stream_open(thread); return; } // data write out of range of file
+	// write to file from main memory, for number of bytes specified by data_size, at byte addressed by secondary reg
+	file_stream_main_mem_io(thread, stream, data_addr, data_size, *thread->secondary, 1);
 	update_stream_open(thread);
 }
 void instruction_65(thread_t* thread) { // read from file
 	if(!thread->perm_file_io) return;
 	uint64_t output_addr = *thread->primary;
 	uint64_t output_size = *thread->output + 1;
-	if(check_segfault(thread, output_addr, output_size));
-	uint8_t* output = malloc(output_size); // temp. storage for read file data
-	uint16_t stream_id = (thread->regs[13] & 0xFFFF0000000)>>28;
-	uint64_t file_size = 0;
-	if(!stream_id) { update_stream_open(thread); return; }  // file stream id is 0 (which is reserved)
-	if(thread->file_streams[stream_id-1]) { // get the size of the file
-		fseek(thread->file_streams[stream_id-1], 0L, SEEK_END);
-		file_size = ftell(thread->file_streams[stream_id-1]);
-		fseek(thread->file_streams[stream_id-1], 0L, SEEK_SET);
-	} else { update_stream_open(thread); return; } // this file is not open
-	if(*thread->secondary + output_size - 1 > file_size) { update_stream_open(thread); return; } // data read out of range of file
-	// read from file to "output", for number of bytes specified by output_size, at byte specified by secondary reg
-	fseek(thread->file_streams[stream_id-1], *thread->secondary, SEEK_SET);
-	fread(output, 1, output_size, thread->file_streams[stream_id-1]);
-	fseek(thread->file_streams[stream_id-1], 0L, SEEK_SET);
-	write_main_mem(thread, output_addr, output, output_size);
-	free(output);
+	if(check_segfault(thread, output_addr, output_size)) { update_stream_open(thread); return; }
+	file_stream_t* stream = get_current_file_stream(thread);
+	if(!stream) { update_stream_open(thread); return; }	// file stream id is 0 (which is reserved), or this file is not open
+	if(!check_file_stream_range(stream, *thread->secondary, output_size)) { update_stream_open(thread); return; } // data read out of range of file
+	// read from file to main memory, for number of bytes specified by output_size, at byte specified by secondary reg
+	file_stream_main_mem_io(thread, stream, output_addr, output_size, *thread->secondary, 0);
 	update_stream_open(thread);
 }
 void instruction_66(thread_t* thread) { // resize a file or get its size
 	if(!thread->perm_file_io) return;
-	uint16_t stream_id = (thread->regs[13] & 0xFFFF0000000)>>28;
-	if(!stream_id) { update_stream_open(thread); return; } // no file stream is set as current file stream
-	if(thread->file_streams[stream_id-1]) { // file stream is open
+	file_stream_t* stream = get_current_file_stream(thread);
+	if(stream) { // file stream is open
 		if(*thread->primary) { // resize the file to *thread->primary bytes
-			uint64_t fd = fileno(thread->file_streams[stream_id-1]);
-			ftruncate(fd, *thread->primary);
-		} else { // get file size
-			fseek(thread->file_streams[stream_id-1], 0L, SEEK_END);
-			*thread->output = ftell(thread->file_streams[stream_id-1]);
-			fseek(thread->file_streams[stream_id-1], 0L, SEEK_SET);
-		}
+			if(ftruncate(fileno(stream->file), *thread->primary) == 0) {
+				file_size_epoch++;	// other streams of the file keep its old size
+				stream->size = *thread->primary;
+				stream->size_epoch = file_size_epoch;
+			}
+		} else // get file size
+			*thread->output = get_file_stream_size(stream, 0);
 	}
 	update_stream_open(thread);
 }
@@ -4139,16 +6425,14 @@ void instruction_72(thread_t* thread) {	// generate an object
 		case TYPE_VBO: glGenBuffers(1, &object->gl_buffer); break;
 		case TYPE_IBO: glGenBuffers(1, &object->gl_buffer); break;
 		case TYPE_TBO:
-			if(*thread->secondary > 13) CLEAN_RETURN;	// not a valid texture format
+			if(*thread->secondary >= N_TBO_FORMATS) CLEAN_RETURN;	// not a valid texture format
+			memset(&object->tbo, 0, sizeof(tbo_t));
 			object->tbo.format = *thread->secondary;
-			object->tbo.level_widths = 0;
-			object->tbo.level_heights = 0;
-			object->tbo.n_levels = 0;
 			glGenTextures(1, &object->tbo.gl_buffer);
 			break;
 		case TYPE_FBO: object->fbo.width = 0; object->fbo.height = 0; glGenFramebuffers(1, &object->fbo.gl_buffer); break;
 		case TYPE_UBO: object->ubo.data = 0; object->ubo.size = 0; break;
-		case TYPE_SBO: object->sbo.data = 0; object->sbo.size = 0; break;
+		case TYPE_SBO: memset(&object->sbo, 0, sizeof(sbo_t)); break;
 		case TYPE_DBO: object->dbo.data = 0; object->dbo.size = 0; break;
 		case TYPE_SAMPLER_DESC: object->s_mode = 0; object->t_mode = 0; object->min_filter = 0; object->mag_filter = 0; object->object_id = 0; break;	// TBO descriptor
 		case TYPE_IMAGE_DESC: object->image_level = 0; object->object_id = 0; break; // image descriptor
@@ -4224,6 +6508,10 @@ void instruction_72(thread_t* thread) {	// generate an object
 			create_pipeline(&object->pipeline, info, &success, thread);
 			free(info);
 			if(!success) CLEAN_RETURN;	// pipeline creation failed; nothing will happen
+			if(object->pipeline.job) {	// pending; if creation fails later the object becomes deleted
+				pending_pipelines = realloc(pending_pipelines, (n_pending_pipelines+1)*sizeof(uint64_t));
+				pending_pipelines[n_pending_pipelines++] = object_id;
+			}
 			break;
 		case TYPE_RT_PIPE: break; // ray tracing pipeline; not supported
 		case TYPE_COMPUTE_PIPE: // compute pipeline
@@ -4256,19 +6544,18 @@ void instruction_73(thread_t* thread) {	// delete an object
 	if(object->privacy_key != thread->privacy_key) return;
 	switch(object->type) {
 		case TYPE_VAO: case TYPE_VBO: case TYPE_IBO:
-			glDeleteBuffers(1, &object->gl_buffer); break;
-		case TYPE_TBO: glDeleteTextures(1, &object->tbo.gl_buffer); break;
-		case TYPE_FBO: glDeleteFramebuffers(1, &object->fbo.gl_buffer); break;
-		case TYPE_UBO: if(object->ubo.data) free(object->ubo.data); break;
-		case TYPE_SBO: if(object->sbo.data) free(object->sbo.data); break;
-		case TYPE_DBO: if(object->dbo.data) free(object->dbo.data); break;
-		case TYPE_VID_DATA:
-			for(uint32_t i = 0; i < object->vid_data.n_frames; i++)
-				if(object->vid_data.frames[i])
-					free(object->vid_data.frames[i]);
-			if(object->vid_data.n_frames)
-				free(object->vid_data.frames);
+			glDeleteBuffers(1, &object->gl_buffer);
+			if(object->buffer_data) free(object->buffer_data);
+			break;
+		case TYPE_TBO:
+			glDeleteTextures(1, &object->tbo.gl_buffer); gl_state_invalidate();	// deleting unbinds the texture and frees its name for reuse
+			free(object->tbo.level_widths); free(object->tbo.level_heights);
 			break;
+		case TYPE_FBO: glDeleteFramebuffers(1, &object->fbo.gl_buffer); gl_state_invalidate(); break;
+		case TYPE_UBO: if(object->ubo.data) free(object->ubo.data); glDeleteBuffers(2, object->ubo.gl_buffers); break;
+		case TYPE_SBO: if(object->sbo.data) free(object->sbo.data); if(object->sbo.gl_buffer) glDeleteBuffers(1, &object->sbo.gl_buffer); break;
+		case TYPE_DBO: if(object->dbo.data) free(object->dbo.data); break;
+		case TYPE_VID_DATA: clear_vid_data(&object->vid_data); break;
 		case TYPE_SEGTABLE:
 			for(uint32_t i = 1; i < n_threads; i++)
 				if(threads[i].segtable_id == *thread->primary)
@@ -4344,7 +6631,8 @@ void instruction_76(thread_t* thread) {	// bind an object to a descriptor
 	if(object->type == TYPE_TBO && *thread->secondary) {
 		descriptor_id = thread->bindings.image_desc_binding;	// updating an image descriptor
 		level = (*thread->secondary&0xFFFFFFFF)-1;
-		if(level > object->tbo.n_levels-1) return;	// level does not exist in the TBO
+		if(level >= object->tbo.n_levels) return;	// level does not exist in the TBO
+		if(IS_COMPRESSED_TBO_FORMAT(object->tbo.format)) return;	// compressed textures can't be images
 	} else {
 		switch(object->type) {
 			case TYPE_TBO: descriptor_id = thread->bindings.sampler_desc_binding; break;	// TBO object; get bound TBO descriptor
@@ -4528,20 +6816,13 @@ void instruction_80(thread_t* thread) {	// outputs the size of a bound buffer
 		case 9: *thread->output = object->shader.size; return;	// shader object
 	}
 
-	GLint gl_size = 0;
-	GLenum type = 0;
-	switch(*thread->primary) {
-		case 0: type = GL_ARRAY_BUFFER; break;
-		case 1: type = GL_ELEMENT_ARRAY_BUFFER; break;
-	}
-	glBindBuffer(type, object->gl_buffer);
-	glGetBufferParameteriv(type, GL_BUFFER_SIZE, &gl_size);
-	if(gl_size != GL_INVALID_OPERATION) *thread->output = gl_size;
-	else *thread->output = 0;
+	*thread->output = object->buffer_size;	// VBO or IBO
 }
 void instruction_81(thread_t* thread) {	// maps/unmaps a bound buffer; only updates once unmapped. outputs address to mapped region after a map and updates mapping error bit in SR
+	uint64_t buffer_type = *thread->primary & ~0x100ull;
+	uint8_t write_only = (*thread->primary & 0x100) != 0;	// write-only map; the mapped region's contents are undefined until written (buffer data isn't copied to it)
 	uint64_t bound_id;
-	switch(*thread->primary) {
+	switch(buffer_type) {
 		case 0: bound_id = thread->bindings.vbo_binding; break;	// VBO
 		case 1: bound_id = thread->bindings.ibo_binding; break;	// IBO
 		case 2: bound_id = thread->bindings.ubo_binding; break;	// UBO
@@ -4555,42 +6836,46 @@ void instruction_81(thread_t* thread) {	// maps/unmaps a bound buffer; only upda
 	object_t* object = &objects[bound_id-1];
 	if(object->deleted) { thread->regs[13] |= 0x20000; return; }	// the object bound was previously deleted
 
-	// get the size of the buffer for this object
+	// get the size and data of the buffer for this object
 	uint64_t buffer_size = 0;
-	GLint gl_size = 0;
+	uint8_t* buffer_data = 0;
 	switch(object->type) {
-		case TYPE_VBO: glBindBuffer(GL_ARRAY_BUFFER, object->gl_buffer); glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &gl_size); buffer_size = gl_size; break; // get size of VBO
-		case TYPE_IBO: glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->gl_buffer); glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &gl_size); buffer_size = gl_size; break; // get size of IBO
-		case TYPE_UBO: buffer_size = object->ubo.size; break;	// get size of UBO
-		case TYPE_SBO: buffer_size = object->sbo.size; break;	// get size of SBO
-		case TYPE_DBO: buffer_size = object->dbo.size; break;	// get size of DBO
+		case TYPE_VBO: case TYPE_IBO: buffer_size = object->buffer_size; buffer_data = object->buffer_data; break;	// get size of VBO/IBO
+		case TYPE_UBO: buffer_size = object->ubo.size; buffer_data = object->ubo.data; break;	// get size of UBO
+		case TYPE_SBO: read_back_sbo(&object->sbo); buffer_size = object->sbo.size; buffer_data = object->sbo.data; break;	// get size of SBO (with the results of any dispatches)
+		case TYPE_DBO: buffer_size = object->dbo.size; buffer_data = object->dbo.data; break;	// get size of DBO
 		case TYPE_VSH: case TYPE_PSH: case TYPE_CSH:
-			buffer_size = object->shader.size; break;	// get size of vertex, pixel, or compute shader
+			buffer_size = object->shader.size; buffer_data = object->shader.src; break;	// get size of vertex, pixel, or compute shader
 	}
 	if(object->mapped_address == 0) {	// map this object
 		if(buffer_size == 0) { thread->regs[13] |= 0x20000; return; }	// there is no allocated buffer data to map, set buffer map error bit to 1
-		object->mapped_address = new_mapping(object->privacy_key, buffer_size);
+		object->mapped_address = new_mapping(object->privacy_key, buffer_size, buffer_data);
 		// fill memory[object->mapped_address] with buffer data
-		switch(*thread->primary) {
-			case 0: glBindBuffer(GL_ARRAY_BUFFER, object->gl_buffer); glGetBufferSubData(GL_ARRAY_BUFFER, 0, buffer_size, &memory[object->mapped_address]); break;  // VBO
-			case 1: glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->gl_buffer); glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, buffer_size, &memory[object->mapped_address]); break;  // IBO
-			case 2: memcpy(&memory[object->mapped_address], object->ubo.data, buffer_size); break; // UBO
-			case 3: memcpy(&memory[object->mapped_address], object->sbo.data, buffer_size); break; // SBO
-			case 4: memcpy(&memory[object->mapped_address], object->dbo.data, buffer_size); break; // DBO
-			case 6: memcpy(&memory[object->mapped_address], object->shader.src, buffer_size); break; // shader
-			default: thread->regs[13] |= 0x20000; return;
-		}
+		if(!write_only) memcpy(&memory[object->mapped_address], buffer_data, buffer_size);
 		*thread->output = object->mapped_address;	// output the address of the mapped region to the output register
 		thread->regs[13] &= (~0x20000ull); // clear buffer map error bit
 	} else {	// unmap this object (update object's store beforehand)
-		switch(*thread->primary) {
-			case 0: glBindBuffer(GL_ARRAY_BUFFER, object->gl_buffer); glBufferData(GL_ARRAY_BUFFER, buffer_size, &memory[object->mapped_address], GL_DYNAMIC_DRAW); break;  // VBO
-			case 1: glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->gl_buffer); glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer_size, &memory[object->mapped_address], GL_DYNAMIC_DRAW); break;  // IBO
-			case 2: memcpy(object->ubo.data, &memory[object->mapped_address], buffer_size); break; // UBO
-			case 3: memcpy(object->sbo.data, &memory[object->mapped_address], buffer_size); break; // SBO
-			case 4: memcpy(object->dbo.data, &memory[object->mapped_address], buffer_size); break;
-			case 6: memcpy(object->shader.src, &memory[object->mapped_address], buffer_size); break; // shader
-			default: thread->regs[13] |= 0x20000; return;
+		// only the ranges written to while mapped are copied back
+		map_t* mapping = get_mapping(object->mapped_address);
+		uint64_t dirty_size = 0;
+		for(uint32_t i = 0; i < mapping->n_dirty; i++) {
+			uint64_t size = mapping->dirty[i][1] - mapping->dirty[i][0];
+			memcpy(buffer_data + (mapping->dirty[i][0] - mapping->address), &memory[mapping->dirty[i][0]], size);
+			dirty_size += size;
+		}
+		if(dirty_size) {
+			if(object->type == TYPE_VBO || object->type == TYPE_IBO) {
+				GLenum target = object->type == TYPE_VBO ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER;
+				glBindBuffer(target, object->gl_buffer);
+				if(dirty_size*2 >= buffer_size) // mostly rewritten; orphan the GL buffer's storage instead of waiting for the GPU to finish with it
+					glBufferData(target, buffer_size, buffer_data, GL_DYNAMIC_DRAW);
+				else for(uint32_t i = 0; i < mapping->n_dirty; i++) {
+					uint64_t offset = mapping->dirty[i][0] - mapping->address;
+					glBufferSubData(target, offset, mapping->dirty[i][1] - mapping->dirty[i][0], buffer_data + offset);
+				}
+			}
+			if(object->type == TYPE_UBO) object->ubo.dirty = 3;
+			if(object->type == TYPE_SBO) object->sbo.dirty = 1;
 		}
 		thread->regs[13] &= (~0x20000ull); // clear buffer map error bit
 		delete_mapping(object->mapped_address);
@@ -4606,10 +6891,20 @@ void instruction_82(thread_t* thread) {	// allocates a buffer
 	if(object->mapped_address) { thread->regs[13] |= 0x100; return; }	// object is mapped
 
 	switch(object->type) {
-		case TYPE_VBO: glBindBuffer(GL_ARRAY_BUFFER, object->gl_buffer); glBufferData(GL_ARRAY_BUFFER, *thread->secondary, 0, GL_DYNAMIC_DRAW); break; // allocate VBO
-		case TYPE_IBO: glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->gl_buffer); glBufferData(GL_ELEMENT_ARRAY_BUFFER, *thread->secondary, 0, GL_DYNAMIC_DRAW); break; // allocate IBO
-		case TYPE_UBO: object->ubo.data = malloc(*thread->secondary); object->ubo.size = *thread->secondary; break;  // allocate UBO
-		case TYPE_SBO: object->sbo.data = malloc(*thread->secondary); object->sbo.size = *thread->secondary; break;  // allocate SBO
+		case TYPE_VBO: case TYPE_IBO:	// allocate VBO/IBO
+			if(object->buffer_data) free(object->buffer_data);
+			object->buffer_data = calloc(1, *thread->secondary);
+			object->buffer_size = *thread->secondary;
+			glBindBuffer(object->type == TYPE_VBO ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, object->gl_buffer);
+			glBufferData(object->type == TYPE_VBO ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, *thread->secondary, object->buffer_data, GL_DYNAMIC_DRAW);
+			break;
+		case TYPE_UBO: object->ubo.data = malloc(*thread->secondary); object->ubo.size = *thread->secondary; object->ubo.dirty = 3; break;  // allocate UBO
+		case TYPE_SBO:	// allocate SBO; results of earlier dispatches are discarded with the old data
+			if(*thread->secondary > SBO_MAX_SIZE) { thread->regs[13] |= 0x100; return; }
+			if(object->sbo.data) free(object->sbo.data);
+			object->sbo.data = malloc(*thread->secondary); object->sbo.size = *thread->secondary;
+			object->sbo.dirty = 1; object->sbo.gpu_written = 0;
+			break;
 		case TYPE_DBO: object->dbo.data = malloc(*thread->secondary); object->dbo.size = *thread->secondary; break;  // allocate DBO
 		case TYPE_VSH: case TYPE_PSH: case TYPE_CSH:
 			object->shader.src = calloc(1,*thread->secondary); object->shader.size = *thread->secondary; break;    // allocate vertex, pixel, or compute shader
@@ -4632,20 +6927,32 @@ void instruction_83(thread_t* thread) {	// upload to texture
 	uint32_t level = params[2];
 	free(params);
 
-	// secondary register is address to texture data
-	uint32_t texture_size, bpp;
-	switch(tbo->tbo.format) {
-		case 0: case 1: case 3: bpp = 1; break;
-		case 4: case 5: case 7: bpp = 2; break;
-		case 6:  bpp = 8; break;
-		case 10: bpp = 16; break;
-		default: bpp = 4; break;
+	// if bit 31 of the level is set, a 32-bit X and Y follow; the texels are uploaded to the width x height rectangle at X, Y of the existing level
+	uint8_t sub_rect = level >> 31;
+	uint32_t x = 0, y = 0;
+	if(sub_rect) {
+		level &= 0x7FFFFFFF;
+		if(check_segfault(thread, *thread->primary+12, 8)) return;
+		x = read_main_mem_val(thread, *thread->primary+12, 4);
+		y = read_main_mem_val(thread, *thread->primary+16, 4);
 	}
-	texture_size = bpp*width*height;
+	if(width > max_texture_size || height > max_texture_size) return;
+
+	// secondary register is address to texture data (blocks of 4x4 texels for compressed formats)
+	uint64_t texture_size = tbo_data_size(tbo->tbo.format, width, height);
 
 	if(check_segfault(thread, *thread->secondary, texture_size)) return;
+	uint8_t* staging = IS_DECODED_TBO_FORMAT(tbo->tbo.format) ? 0 : map_upload_buffer(texture_size);	// texels decoded on the CPU are uploaded from memory
+	if(staging) {	// the texels are copied straight into a GL buffer, which the driver uploads from asynchronously
+		read_main_mem_into(thread, *thread->secondary, texture_size, staging);
+		if(unmap_upload_buffer()) {
+			upload_texture(&tbo->tbo, level, x, y, width, height, sub_rect, 0);
+			release_upload_buffer();
+			return;
+		}
+	}
 	uint8_t* tex_data = read_main_mem(thread, *thread->secondary, texture_size);
-	upload_texture(&tbo->tbo, level, width, height, tex_data);
+	upload_texture(&tbo->tbo, level, x, y, width, height, sub_rect, tex_data);
 	free(tex_data);
 }
 void instruction_84(thread_t* thread) {	// generate mipmaps for a texture
@@ -4653,26 +6960,7 @@ void instruction_84(thread_t* thread) {	// generate mipmaps for a texture
 	if(bound_id == 0 || bound_id > n_objects) return;
 	object_t* tbo = &objects[bound_id-1];
 	if(tbo->deleted) return;
-	if(tbo->tbo.format == 12 || tbo->tbo.format == 13) return;	// if depth or depth + stencil texture, do nothing
-	if(tbo->tbo.level_widths[0] == 0 && tbo->tbo.level_heights[0] == 0) return;
-	if(tbo->tbo.n_levels == 0) return;
-	glBindTexture(GL_TEXTURE_2D, tbo->tbo.gl_buffer);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	uint32_t w = tbo->tbo.level_widths[0];
-	uint32_t h = tbo->tbo.level_heights[0];
-	for(uint32_t level = 0; !(w == 1 && h == 1); level++) {
-		w /= 2;
-		h /= 2;
-		if(w == 0) w = 1;
-		if(h == 0) h = 1;
-		if(level == tbo->tbo.n_levels) {
-			tbo->tbo.level_widths = realloc(tbo->tbo.level_widths, sizeof(uint32_t)*(tbo->tbo.n_levels+1));
-			tbo->tbo.level_heights = realloc(tbo->tbo.level_heights, sizeof(uint32_t)*(tbo->tbo.n_levels+1));
-			tbo->tbo.level_widths[level] = w;
-			tbo->tbo.level_heights[level] = h;
-			tbo->tbo.n_levels++;
-		}
-	}
+	generate_tbo_mipmaps(&tbo->tbo);
 }
 void instruction_85(thread_t* thread) {	// attach level 0 of bound TBO to bound FBO as attachment
 	uint64_t tbo_id = thread->bindings.tbo_binding;
@@ -4688,7 +6976,7 @@ void instruction_85(thread_t* thread) {	// attach level 0 of bound TBO to bound
 	object_t* fbo = &objects[fbo_id-1];
 	if(fbo->deleted) return;
 
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo->fbo.gl_buffer);
+	gl_bind_framebuffer(fbo->fbo.gl_buffer);
 
 	uint8_t any_attachments_bound = 0;
 	GLint attached;
@@ -4699,7 +6987,8 @@ void instruction_85(thread_t* thread) {	// attach level 0 of bound TBO to bound
 	glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &attached); if(attached != GL_NONE) any_attachments_bound = 1;
 	glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &attached); if(attached != GL_NONE) any_attachments_bound = 1;
 	uint32_t level = *thread->secondary & 0xFFFFFFFF;
-	if(level >= tbo->tbo.n_levels) return;
+	if(tbo_id && level >= tbo->tbo.n_levels) return;
+	if(tbo_id && IS_COMPRESSED_TBO_FORMAT(tbo->tbo.format)) return;	// compressed textures can't be attachments
 
 	if(!any_attachments_bound && tbo_id) {
 		fbo->fbo.width = tbo->tbo.level_widths[level];
@@ -4806,6 +7095,7 @@ void instruction_90(thread_t* thread) {	// submit command buffers to compute que
 	uint16_t queue = read_main_mem_val(thread, *thread->primary, 2);
 	if(queue > 0) return;	// in this implementation, there is only 1 compute queue that command buffers can be submitted to
 	uint32_t n_cbos = read_main_mem_val(thread, *thread->primary+2, 4) + 1;
+	if(check_segfault(thread, *thread->primary, 6+n_cbos*8)) return;
 	uint64_t* cbo_ids = (uint64_t*)read_main_mem(thread, *thread->primary + 6, n_cbos*8);
 	// make sure all CBO IDs are valid
 	for(uint32_t i = 0; i < n_cbos; i++) {
@@ -4814,7 +7104,7 @@ void instruction_90(thread_t* thread) {	// submit command buffers to compute que
 		object_t* cbo = &objects[cbo_id-1];
 		if(cbo->deleted) { free(cbo_ids); return; }
 		if(cbo->privacy_key != thread->privacy_key) { free(cbo_ids); return; }
-		if(cbo->cbo.pipeline_type != 1) { free(cbo_ids); return; }	// command buffer not using rasterization pipelines
+		if(cbo->cbo.pipeline_type != 1) { free(cbo_ids); return; }	// command buffer not using compute pipelines
 	}
 	for(uint32_t i = 0; i < n_cbos; i++)
 		submit_cmds(&objects[cbo_ids[i]-1].cbo);	// submit this command buffer
@@ -4936,15 +7226,14 @@ void instruction_101(thread_t* thread) {	// compute dispatch
 	if(bound_cbo->cbo.pipeline_type != 1) return;	// not a compute pipeline CBO
 
 	uint32_t* params = (uint32_t*)read_main_mem(thread, *thread->primary, 12);
+	uint32_t info[3] = { params[0], params[1], params[2] };      // info for command
+	free(params);
 
-	if(!params[0] || !params[1] || !params[2]) return;
+	if(!info[0] || !info[1] || !info[2]) return;
 
-	uint32_t* global_work = (uint32_t*)(memory + HW_INFORMATION + 167);
-	if(params[0] > global_work[0] || params[1] > global_work[1] || params[2] > global_work[2] || params[0]*params[1]*params[2] > global_work[3])
-		return; // if dimensions exceed their maximum or the product exceeds the maximum global work-group size, do nothing
+	if(info[0] > max_global_work_size[0] || info[1] > max_global_work_size[1] || info[2] > max_global_work_size[2])
+		return; // if dimensions exceed their maximum, do nothing (the hardware information has no limit for the product of the dimensions)
 
-	uint32_t info[3] = { params[0], params[1], params[2] };      // info for command
-	free(params);
 	record_command(&bound_cbo->cbo, 101, info, 12);   // record the dispatch compute command into the command buffer
 }
 void instruction_102(thread_t* thread) { *thread->output = HW_INFORMATION; }
@@ -5062,14 +7351,118 @@ void instruction_117(thread_t* thread) { // single variable math function
 	else result = ival;
 	*thread->output = result;
 }
+// display captures are read back into a ring of GL pixel pack buffers, so that instruction 118 doesn't wait on the GPU to finish drawing the display;
+// instruction 118 only requests a capture, which is read from the back buffer right before the next buffer swap (the frame about to be displayed)
+// a capture is copied to main memory by update_display_captures once the fence placed after its readback has signaled (or without sync objects,
+// once CAPTURE_RING_SIZE-1 buffer swaps have passed since it was made); the thread's SR_BIT_CAPTURE is cleared when all of its captures are copied
+#define CAPTURE_RING_SIZE 3
+typedef struct capture_buffer_t {
+	GLuint gl_buffer;
+	uint64_t size;	// allocated size of the GL buffer
+	GLsync fence;	// signaled once the readback into the buffer has finished (0 without sync objects)
+	uint8_t requested;	// whether or not the buffer is reserved for a capture to be read back at the next buffer swap
+	uint8_t pending;	// whether or not the buffer holds a capture not yet copied to main memory
+	uint64_t thread_id;	// the thread that made the capture
+	uint64_t address;	// the address to copy the capture to
+	uint32_t width, height;
+	uint64_t swap;	// value of n_swaps when the capture was made
+} capture_buffer_t;
+
+capture_buffer_t capture_ring[CAPTURE_RING_SIZE];
+uint32_t capture_ring_next = 0;	// index of the next buffer in the ring to use
+uint64_t n_swaps = 0;	// number of buffer swaps so far
+
+// ends a capture of a thread, whether or not it reached main memory
+void end_display_capture(capture_buffer_t* capture) {
+	thread_t* thread = &threads[capture->thread_id];
+	capture->requested = capture->pending = 0;
+	if(thread->n_pending_captures && !--thread->n_pending_captures) thread->regs[13] &= ~SR_BIT_CAPTURE;
+}
+
+// copies the capture in a buffer of the capture ring to main memory, flipping its rows so that the top row comes first
+void finish_display_capture(capture_buffer_t* capture) {
+	end_display_capture(capture);
+	if(capture->fence) {
+		glDeleteSync(capture->fence);
+		capture->fence = 0;
+	}
+	thread_t* thread = &threads[capture->thread_id];
+	uint64_t row_size = (uint64_t)capture->width*4;
+	if(thread->killed || check_segfault(thread, capture->address, row_size*capture->height)) return;	// the thread's segments may have changed since
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->gl_buffer);
+	uint8_t* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_size*capture->height, GL_MAP_READ_BIT);
+	if(pixels) {
+		for(uint32_t y = 0; y < capture->height; y++)
+			write_main_mem(thread, capture->address + y*row_size, pixels + (capture->height-1-y)*row_size, row_size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// reads the back buffer into each requested capture; called right before the buffer swap
+// a capture requested at a different framebuffer size than the current one is dropped
+void read_display_captures() {
+	uint8_t bound = 0;
+	for(uint32_t i = 0; i < CAPTURE_RING_SIZE; i++) {
+		capture_buffer_t* capture = &capture_ring[i];
+		if(!capture->requested) continue;
+		if(capture->width != framebuffer_width || capture->height != framebuffer_height) {
+			end_display_capture(capture);
+			continue;
+		}
+		if(!bound) {
+			gl_bind_framebuffer(0);
+			glReadBuffer(GL_BACK);
+			bound = 1;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->gl_buffer);
+		glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		if(gl_sync_objects) capture->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		capture->requested = 0;
+		capture->pending = 1;
+		capture->swap = n_swaps;
+	}
+	if(bound) glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// copies each capture whose readback has finished to main memory; called once after all threads have cycled
+void update_display_captures() {
+	for(uint32_t i = 0; i < CAPTURE_RING_SIZE; i++) {
+		capture_buffer_t* capture = &capture_ring[(capture_ring_next+i) % CAPTURE_RING_SIZE];	// oldest first
+		if(!capture->pending) continue;
+		if(capture->fence) {
+			GLenum status = glClientWaitSync(capture->fence, 0, 0);	// poll; never wait
+			if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+		} else if(n_swaps - capture->swap < CAPTURE_RING_SIZE-1) continue;
+		finish_display_capture(capture);
+	}
+}
+
 void instruction_118(thread_t* thread) { // copy display/camera contents to memory
 	if(*thread->primary != 0) return;	// only capturing from display is supported
-	if(thread->perm_screenshot) return;	// do not have necessary permission to capture from display
-	uint64_t address = *(uint64_t*)(memory + HW_INFORMATION + 1);
-	uint32_t* dimensions = (uint32_t*)&memory[address];
-	uint32_t width = dimensions[0];  // display width
-	uint32_t height = dimensions[1]; // display height
-	if(check_segfault(thread, *thread->secondary, width*height*4)) return;
+	if(!thread->perm_screenshot) return;	// do not have necessary permission to capture from display
+	uint32_t width = framebuffer_width;
+	uint32_t height = framebuffer_height;
+	uint64_t size = (uint64_t)width*height*4;
+	if(!size || check_segfault(thread, *thread->secondary, size)) return;
+	capture_buffer_t* capture = &capture_ring[capture_ring_next];
+	if(capture->requested) return;	// every buffer is reserved for the next buffer swap; at most CAPTURE_RING_SIZE captures are made per frame
+	if(capture->pending) finish_display_capture(capture);	// every buffer is in use; the oldest capture must be copied out first
+	if(!capture->gl_buffer) glGenBuffers(1, &capture->gl_buffer);
+	if(size > capture->size) {	// grow the buffer to the largest capture made through it
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->gl_buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		capture->size = size;
+	}
+	capture->requested = 1;
+	capture->thread_id = thread->id;
+	capture->address = *thread->secondary;
+	capture->width = width;
+	capture->height = height;
+	capture_ring_next = (capture_ring_next+1) % CAPTURE_RING_SIZE;
+	thread->n_pending_captures++;
+	thread->regs[13] |= SR_BIT_CAPTURE;
 }
 void instruction_119(thread_t* thread) { // output time information
 	struct timespec tm;
@@ -5102,7 +7495,7 @@ void instruction_120(thread_t* thread) { // copy region of memory to another loc
 	else read_data = read_main_mem(thread, *thread->primary, *thread->secondary);
 
 	if(*thread->output >= mappings_low && *thread->output < HW_INFORMATION) { // write is within the area for mapped buffer regions
-		if(check_mapped_region(thread->privacy_key, *thread->output, *thread->secondary))
+		if(check_mapped_write(thread->privacy_key, *thread->output, *thread->secondary))
 			memcpy(memory+(*thread->output), read_data, *thread->secondary);
 	} else if(!check_segfault(thread, *thread->output, *thread->secondary))
 		write_main_mem(thread, *thread->output, read_data, *thread->secondary);
@@ -5110,121 +7503,164 @@ void instruction_120(thread_t* thread) { // copy region of memory to another loc
 }
 void instruction_121(thread_t* thread) { return; }	// configure/get info from audio sources + listeners
 void instruction_122(thread_t* thread) { return; }	// get/set info related to audio data/files
+// uploads 8-bit RGBA pixels to a level of the bound TBO, which must have an 8-bit RGBA format, then generates its mipmaps if bit 0 of flags is set
+void upload_rgba8_to_bound_tbo(thread_t* thread, uint32_t level, uint32_t flags, uint32_t width, uint32_t height, uint8_t* pixels) {
+	uint64_t bound_id = thread->bindings.tbo_binding;
+	if(bound_id == 0 || bound_id > n_objects) return;
+	object_t* tbo = &objects[bound_id-1];
+	if(tbo->deleted) return;
+	if(tbo->tbo.format != 9 && tbo->tbo.format != 11) return;	// not RGBA8UI or RGBA8
+	if(!upload_texture(&tbo->tbo, level, 0, 0, width, height, 0, pixels)) return;
+	if((flags & 1) && level == 0) generate_tbo_mipmaps(&tbo->tbo);
+}
+
 void instruction_123(thread_t* thread) {	// get/set info related to video data/files
-	if(!thread->perm_file_io || !thread->bindings.vid_data_binding)
+	if(!thread->perm_file_io) return;
+
+	// extension (primary register 11): upload an image file straight to a level of the bound TBO, without going through a video data object or memory
+	// the secondary register is an address to a 32-bit unsigned integer of the level, followed by 32 bits of flags (bit 0: generate mipmaps after
+	// uploading level 0), followed by a 64-bit address to the ASCII string of the file path; the TBO must have an 8-bit RGBA format (9 or 11)
+	if(*thread->primary == 11) {
+		if(check_segfault(thread, *thread->secondary, 16)) return;
+		uint32_t level = read_main_mem_val(thread, *thread->secondary, 4);
+		uint32_t flags = read_main_mem_val(thread, *thread->secondary+4, 4);
+		uint8_t* full_path = get_image_file_path(thread, read_main_mem_val(thread, *thread->secondary+8, 8));
+		if(!full_path) return;
+		image_cache_t* image = get_cached_image(full_path, 1);
+		free(full_path);
+		if(!image) return;			// image file is invalid
+		upload_rgba8_to_bound_tbo(thread, level, flags, image->width, image->height, image->pixels);
+		return;
+	}
+
+	// extension (primary registers 12-14): append frames to a video stream file (see open_video_stream); the frames are written in the background
+	if(*thread->primary == 12) {	// open a video stream; the secondary register is an address to 32-bit unsigned integers of the width, height, and
+		// frame rate, followed by a 64-bit address to the ASCII string of the file path (.pvf or .png); the file is replaced if it exists
+		// the stream ID is output to the output register (0 if the stream couldn't be opened)
+		*thread->output = 0;
+		if(check_segfault(thread, *thread->secondary, 20)) return;
+		uint32_t width = read_main_mem_val(thread, *thread->secondary, 4);
+		uint32_t height = read_main_mem_val(thread, *thread->secondary+4, 4);
+		uint32_t frame_rate = read_main_mem_val(thread, *thread->secondary+8, 4);
+		if(!width || !height) return;
+		uint8_t* path_str = 0;
+		if(!get_string_main_mem(thread, read_main_mem_val(thread, *thread->secondary+12, 8), &path_str)) return;
+		if(validate_path(path_str) && check_path_existence(path_str) != 2 && !check_highest_path(thread->highest_dir, path_str)) {
+			char* ext = get_string_file_ext(path_str);
+			if(ext && (strcmp(ext, "pvf") == 0 || strcmp(ext, "png") == 0)) {
+				uint8_t* full_path;
+				uint32_t full_size;
+				get_full_path(path_str, &full_path, &full_size);
+				*thread->output = open_video_stream(thread, full_path, width, height, frame_rate);
+				free(full_path);
+			}
+		}
+		free(path_str);
 		return;
+	} else if(*thread->primary == 13) {	// append a frame to a video stream; the secondary register is an address to the 64-bit stream ID, followed by
+		// a 64-bit address to the pixel array (same format and layout as in loading video frames, at the stream's resolution)
+		if(check_segfault(thread, *thread->secondary, 16)) return;
+		uint64_t stream_id = read_main_mem_val(thread, *thread->secondary, 8);
+		uint64_t pixels_addr = read_main_mem_val(thread, *thread->secondary+8, 8);
+		video_stream_t* stream = get_video_stream(thread, stream_id);
+		if(!stream) return;	// not open, or opened by another thread
+		if(!video_stream_has_room(stream)) {	// the writer is behind; the thread waits, and the frame is copied once there's room
+			thread->video_stream_wait = stream_id;
+			thread->video_stream_wait_addr = pixels_addr;
+			thread->end_cyc = 1;
+			return;
+		}
+		append_video_stream_frame(thread, stream, pixels_addr);
+		return;
+	} else if(*thread->primary == 14) {	// close a video stream; the secondary register is the stream ID
+		if(get_video_stream(thread, *thread->secondary)) close_video_stream(*thread->secondary);
+		return;
+	}
+
+	if(!thread->bindings.vid_data_binding) return;
 
 	object_t* vid_object = &objects[thread->bindings.vid_data_binding-1];
 	if(vid_object->deleted) return;	// the FBO bound to the command buffer being submitted has previously been deleted
 	vid_data_t* vid_data = &vid_object->vid_data;
 
-	// load video/image data from file to vid_data
+	// image files are read through the image cache; querying a file only reads its header, and loading it again doesn't decode it again
+	// loading a range of frames doesn't wait for them: images and GIFs are decoded in the background, and raw frame containers are read as their
+	// frames are first used
 	if(*thread->primary == 0) {		// load video/image data from file to vid_data
 		if(check_segfault(thread, *thread->secondary, 16)) return;
 		uint32_t first_frame = read_main_mem_val(thread, *thread->secondary, 4);
 		uint32_t last_frame = read_main_mem_val(thread, *thread->secondary+4, 4);
-		if(first_frame != 0 || last_frame != 0) return;	// currently only support image files (1 frame)
-
-		uint64_t path_addr = read_main_mem_val(thread, *thread->secondary+8, 8);
-		uint8_t* path_str = 0;
-		uint32_t path_length = get_string_main_mem(thread, path_addr, &path_str);
-		if(!path_length || !validate_path(path_str) || check_path_existence(path_str) != 1) return;
-		if(check_highest_path(thread->highest_dir, path_str)) return;
-		char* ext = get_string_file_ext(path_str);
-		if(strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 && strcmp(ext, "jpeg") != 0) return;
-
-		uint8_t* full_path;
-		uint32_t full_size;
-		get_full_path(path_str, &full_path, &full_size);
-
-		// load the image data into vid_data
-		uint32_t w, h, n;
-		uint8_t* frame = stbi_load(full_path, &w, &h, &n, 4);
-		if(!frame) return;			// image file is invalid
-
-		*thread->output = (n == 4);
-
-		for(uint32_t i = 0; i < vid_data->n_frames; i++)
-			free(vid_data->frames[i]);
-		if(vid_data->n_frames)
-			free(vid_data->frames);
-
-		vid_data->frames = malloc(sizeof(uint8_t*));
-		vid_data->frames[0] = malloc(w*h*4);
-		memcpy(vid_data->frames[0], frame, w*h*4);
-		vid_data->n_frames = 1;
-		vid_data->width = w;
-		vid_data->height = h;
-
-		stbi_image_free(frame);
+		if(first_frame > last_frame) return;
+
+		uint8_t* full_path = get_video_file_path(thread, read_main_mem_val(thread, *thread->secondary+8, 8));
+		if(!full_path) return;
+		video_file_info_t info;
+		if(!get_video_file_info(full_path, &info) || last_frame >= info.n_frames) { free(full_path); return; }	// file is invalid, or frames don't exist
+		FILE* frames_file = 0;
+		if(info.type == VIDEO_FILE_PVF && !(frames_file = fopen(full_path, "rb"))) { free(full_path); return; }
+
+		*thread->output = info.alpha;
+
+		clear_vid_data(vid_data);
+		vid_data->n_frames = last_frame-first_frame+1;
+		vid_data->frames = calloc(vid_data->n_frames, sizeof(uint8_t*));
+		vid_data->width = info.width;
+		vid_data->height = info.height;
+		vid_data->frame_rate = info.frame_rate;
+		vid_data->frames_file = frames_file;
+		vid_data->frames_offset = info.frames_offset + first_frame*(uint64_t)info.width*info.height*4;
+
+		uint64_t frame_size = (uint64_t)info.width*info.height*4;
+		if(info.type == VIDEO_FILE_GIF)
+			queue_image_decode(thread->bindings.vid_data_binding, 0, full_path, 1, first_frame, vid_data->n_frames, info.width, info.height);
+		else if(info.type != VIDEO_FILE_PVF)
+			for(uint32_t i = 0; i < vid_data->n_frames; i++) {
+				uint8_t* frame_path = info.type == VIDEO_FILE_SEQUENCE ? get_sequence_frame_path(full_path, first_frame+i) : full_path;
+				image_cache_t* image = get_cached_image(frame_path, 0);
+				if(image && image->pixels && image->width == info.width && image->height == info.height) {	// already decoded
+					vid_data->frames[i] = malloc(frame_size);
+					memcpy(vid_data->frames[i], image->pixels, frame_size);
+				} else queue_image_decode(thread->bindings.vid_data_binding, i, frame_path, 0, 0, 1, info.width, info.height);	// the frame is decoded in the background
+				if(frame_path != full_path) free(frame_path);
+			}
+		free(full_path);
 	} else if(*thread->primary == 1) {		// get the frame count of a file
-		uint8_t* path_str = 0;
-		uint32_t path_length = get_string_main_mem(thread, *thread->secondary, &path_str);
-		if(!path_length || !validate_path(path_str) || check_path_existence(path_str) != 1) return;
-		if(check_highest_path(thread->highest_dir, path_str)) return;
-		char* ext = get_string_file_ext(path_str);
-		if(strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 && strcmp(ext, "jpeg") != 0) return;
-
-		uint8_t* full_path;
-		uint32_t full_size;
-		get_full_path(path_str, &full_path, &full_size);
-
-		// load the image to check if it's valid
-		uint32_t w, h, n;
-		uint8_t* frame = stbi_load(full_path, &w, &h, &n, 4);
-		if(!frame) return;			// image file is invalid
-		stbi_image_free(frame);
+		uint8_t* full_path = get_video_file_path(thread, *thread->secondary);
+		if(!full_path) return;
+		video_file_info_t info;
+		uint8_t valid = get_video_file_info(full_path, &info);
+		free(full_path);
+		if(!valid) return;			// file is invalid
 
-		*thread->output = 1;		// if image is valid, it contains 1 frame
+		*thread->output = info.n_frames;
 	} else if(*thread->primary == 2)		// get frame count of vid_data
 		*thread->output = vid_data->n_frames;
 	else if(*thread->primary == 3) {		// get resolution of a file
 		if(check_segfault(thread, *thread->secondary, 16)) return;
-		uint64_t path_addr = read_main_mem_val(thread, *thread->secondary+8, 8);
-		uint8_t* path_str = 0;
-		uint32_t path_length = get_string_main_mem(thread, path_addr, &path_str);
-		if(!path_length || !validate_path(path_str) || check_path_existence(path_str) != 1) return;
-		if(check_highest_path(thread->highest_dir, path_str)) return;
-		char* ext = get_string_file_ext(path_str);
-		if(strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 && strcmp(ext, "jpeg") != 0) return;
-
-		uint8_t* full_path;
-		uint32_t full_size;
-		get_full_path(path_str, &full_path, &full_size);
-
-		// load image to obtain its resolution
-		uint32_t w, h, n;
-		uint8_t* frame = stbi_load(full_path, &w, &h, &n, 4);
-		if(!frame) return;			// image file is invalid
-		stbi_image_free(frame);
+		uint8_t* full_path = get_video_file_path(thread, read_main_mem_val(thread, *thread->secondary+8, 8));
+		if(!full_path) return;
+		video_file_info_t info;
+		uint8_t valid = get_video_file_info(full_path, &info);
+		free(full_path);
+		if(!valid) return;			// file is invalid
 
-		uint32_t data[] = { w,h };
+		uint32_t data[] = { info.width, info.height };
 		write_main_mem(thread, *thread->secondary, (uint8_t*)data, 8);
 	} else if(*thread->primary == 4) {		// get resolution of vid_data
 		if(check_segfault(thread, *thread->secondary, 8)) return;
 		uint32_t data[] = { vid_data->width, vid_data->height };
 		write_main_mem(thread, *thread->secondary, (uint8_t*)data, 8);
 	} else if(*thread->primary == 5)		// get frame rate of vid_data
-		*thread->output = 0;	// images have a frame rate of 0
+		*thread->output = vid_data->frame_rate;
 	else if(*thread->primary == 6) {		// get frame rate of a file
-		uint8_t* path_str = 0;
-		uint32_t path_length = get_string_main_mem(thread, *thread->secondary, &path_str);
-		if(!path_length || !validate_path(path_str) || check_path_existence(path_str) != 1) return;
-		if(check_highest_path(thread->highest_dir, path_str)) return;
-		char* ext = get_string_file_ext(path_str);
-		if(strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 && strcmp(ext, "jpeg") != 0) return;
-
-		uint8_t* full_path;
-		uint32_t full_size;
-		get_full_path(path_str, &full_path, &full_size);
-
-		// load the image to check if it's valid
-		uint32_t w, h, n;
-		uint8_t* frame = stbi_load(full_path, &w, &h, &n, 4);
-		if(!frame) return;			// image file is invalid
-		stbi_image_free(frame);
+		uint8_t* full_path = get_video_file_path(thread, *thread->secondary);
+		if(!full_path) return;
+		video_file_info_t info;
+		uint8_t valid = get_video_file_info(full_path, &info);
+		free(full_path);
+		if(!valid) return;			// file is invalid
 
-		*thread->output = 0;		// if image is valid, it has frame rate of 0
+		*thread->output = info.frame_rate;
 	} else if(*thread->primary == 7) {		// copy a frame from vid_data to memory
 		if(check_segfault(thread, *thread->secondary, 12)) return;
 		uint32_t frame = read_main_mem_val(thread, *thread->secondary, 4);
@@ -5232,35 +7668,31 @@ void instruction_123(thread_t* thread) {	// get/set info related to video data/f
 		uint64_t output_addr = read_main_mem_val(thread, *thread->secondary+4, 8);
 		uint32_t frame_size = vid_data->width * vid_data->height * 4;
 		if(check_segfault(thread, output_addr, frame_size)) return;
-		write_main_mem(thread, output_addr, vid_data->frames[frame], frame_size);
+		uint8_t* pixels = get_vid_data_frame(vid_data, frame);
+		if(!pixels) {	// frame is still being decoded; the thread waits, and the frame is copied once the decode finishes (see exec_cycle)
+			thread->vid_data_wait = thread->bindings.vid_data_binding;
+			thread->vid_data_wait_frame = frame;
+			thread->vid_data_wait_addr = output_addr;
+			thread->end_cyc = 1;
+			return;
+		}
+		write_main_mem(thread, output_addr, pixels, frame_size);
 	} else if(*thread->primary == 8) {		// overwrite a frame of a file
 		if(check_segfault(thread, *thread->secondary, 20)) return;
 		uint32_t frame_num = read_main_mem_val(thread, *thread->secondary, 4);
 		uint64_t data_addr = read_main_mem_val(thread, *thread->secondary+4, 8);
 		if(frame_num > 0) return;	// currently only support image files (1 frame)
 
-		uint64_t path_addr = read_main_mem_val(thread, *thread->secondary+12, 8);
-		uint8_t* path_str = 0;
-		uint32_t path_length = get_string_main_mem(thread, path_addr, &path_str);
-		if(!path_length || !validate_path(path_str) || check_path_existence(path_str) != 1) return;
-		if(check_highest_path(thread->highest_dir, path_str)) return;
-		char* ext = get_string_file_ext(path_str);
-		if(strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 && strcmp(ext, "jpeg") != 0) return;
-
-		uint8_t* full_path;
-		uint32_t full_size;
-		get_full_path(path_str, &full_path, &full_size);
-
-		// load the image to check if it's valid
-		uint32_t w, h, n;
-		uint8_t* img = stbi_load(full_path, &w, &h, &n, 4);
-		if(!img) return;			// image file is invalid
-		stbi_image_free(img);
-
-		if(check_segfault(thread, data_addr, w*h*4)) return;
+		uint8_t* full_path = get_image_file_path(thread, read_main_mem_val(thread, *thread->secondary+12, 8));
+		if(!full_path) return;
+		image_cache_t* image = get_cached_image(full_path, 0);	// check if it's valid
+		if(!image || check_segfault(thread, data_addr, (uint64_t)image->width*image->height*4)) { free(full_path); return; }
+		uint32_t w = image->width, h = image->height;
 		uint8_t* data = read_main_mem(thread, data_addr, w*h*4);
 
-		if(strcmp(ext, "png") == 0)
+		forget_cached_image(full_path);
+		file_size_epoch++;	// the file is rewritten
+		if(strcmp(get_string_file_ext(full_path), "png") == 0)
 			stbi_write_png(full_path, w, h, 4, data, w*4);
 		else {
 			uint8_t* jpg_data = malloc(w*h*3);			// must discard the 4th byte of each pixel in 'data' (only have 3 components)
@@ -5271,6 +7703,7 @@ void instruction_123(thread_t* thread) {	// get/set info related to video data/f
 			free(jpg_data);
 		}
 		free(data);
+		free(full_path);
 	} else if(*thread->primary == 9) {		// set frame count/rate of a file
 		if(check_segfault(thread, *thread->secondary, 24)) return;
 		uint32_t frame_rate = read_main_mem_val(thread, *thread->secondary, 4);
@@ -5280,31 +7713,30 @@ void instruction_123(thread_t* thread) {	// get/set info related to video data/f
 		if(frame_count != 1 || frame_rate != 0) return;		// currently only support image files
 		if(frame_width == 0 || frame_height == 0) return;
 
-		uint64_t path_addr = read_main_mem_val(thread, *thread->secondary+16, 8);
-		uint8_t* path_str = 0;
-		uint32_t path_length = get_string_main_mem(thread, path_addr, &path_str);
-		if(!path_length || !validate_path(path_str) || check_path_existence(path_str) != 1) return;
-		if(check_highest_path(thread->highest_dir, path_str)) return;
-		char* ext = get_string_file_ext(path_str);
-		if(strcmp(ext, "png") != 0 && strcmp(ext, "jpg") != 0 && strcmp(ext, "jpeg") != 0) return;
-
-
-		uint8_t* full_path;
-		uint32_t full_size;
-		get_full_path(path_str, &full_path, &full_size);
-
-		// load the image to check if it's valid
-		uint32_t w, h, n;
-		uint8_t* img = stbi_load(full_path, &w, &h, &n, 4);
-		if(!img) {			// image file is invalid; overwrite file content with a blank image (stbi_write_*)
+		uint8_t* full_path = get_image_file_path(thread, read_main_mem_val(thread, *thread->secondary+16, 8));
+		if(!full_path) return;
+		if(!get_cached_image(full_path, 0)) {	// image file is invalid; overwrite file content with a blank image (stbi_write_*)
+			forget_cached_image(full_path);
+			file_size_epoch++;
 			uint8_t* data = calloc(1,frame_width*frame_height*4);
-			if(strcmp(ext, "png") == 0)
+			if(strcmp(get_string_file_ext(full_path), "png") == 0)
 				stbi_write_png(full_path, frame_width, frame_height, 4, data, frame_width*4);
 			else
 				stbi_write_jpg(full_path, frame_width, frame_height, 3, data, 100);
 			free(data);
-		} else
-			stbi_image_free(img);
+		}
+		free(full_path);
+	} else if(*thread->primary == 10) {		// extension: upload a frame from vid_data to a level of the bound TBO, without going through memory
+		// the secondary register is an address to a 32-bit unsigned integer of the frame number, followed by a 32-bit unsigned integer of the level,
+		// followed by 32 bits of flags (bit 0: generate mipmaps after uploading level 0); the TBO must have an 8-bit RGBA format (9 or 11)
+		if(check_segfault(thread, *thread->secondary, 12)) return;
+		uint32_t frame = read_main_mem_val(thread, *thread->secondary, 4);
+		uint32_t level = read_main_mem_val(thread, *thread->secondary+4, 4);
+		uint32_t flags = read_main_mem_val(thread, *thread->secondary+8, 4);
+		if(frame >= vid_data->n_frames) return;
+		if(!get_vid_data_frame(vid_data, frame)) wait_image_decode(vid_data);	// the frame must be decoded before GL can upload it
+		if(frame >= vid_data->n_frames) return;	// decoding failed
+		upload_rgba8_to_bound_tbo(thread, level, flags, vid_data->width, vid_data->height, get_vid_data_frame(vid_data, frame));
 	}
 }
 void instruction_124(thread_t* thread) { return; }	// networking
@@ -5704,56 +8136,56 @@ void instruction_239(thread_t* thread) {
 void instruction_240(thread_t* thread) {
 	uint8_t n_bytes = 1;    // number of bytes to store
 	if(*thread->primary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->primary, n_bytes)) { write_main_mem_val(thread, *thread->primary, *thread->secondary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	memory[*thread->primary] = *thread->secondary;
 }
 void instruction_241(thread_t* thread) {
 	uint8_t n_bytes = 2;    // number of bytes to store
 	if(*thread->primary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->primary, n_bytes)) { write_main_mem_val(thread, *thread->primary, *thread->secondary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	*(uint16_t*)(&memory[*thread->primary]) = *thread->secondary;
 }
 void instruction_242(thread_t* thread) {
 	uint8_t n_bytes = 4;    // number of bytes to store
 	if(*thread->primary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->primary, n_bytes)) { write_main_mem_val(thread, *thread->primary, *thread->secondary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	*(uint32_t*)(&memory[*thread->primary]) = *thread->secondary;
 }
 void instruction_243(thread_t* thread) {
 	uint8_t n_bytes = 8;    // number of bytes to store
 	if(*thread->primary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->primary, n_bytes)) { write_main_mem_val(thread, *thread->primary, *thread->secondary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->primary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	*(uint64_t*)(&memory[*thread->primary]) = *thread->secondary;
 }
 void instruction_244(thread_t* thread) {
 	uint8_t n_bytes = 1;	// number of bytes to store
 	if(*thread->secondary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->secondary, n_bytes)) { write_main_mem_val(thread, *thread->secondary, *thread->primary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	memory[*thread->secondary] = *thread->primary;
 }
 void instruction_245(thread_t* thread) {
 	uint8_t n_bytes = 2;	// number of bytes to store
 	if(*thread->secondary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->secondary, n_bytes)) { write_main_mem_val(thread, *thread->secondary, *thread->primary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	*(uint16_t*)(&memory[*thread->secondary]) = *thread->primary;
 }
 void instruction_246(thread_t* thread) {
 	uint8_t n_bytes = 4;	// number of bytes to store
 	if(*thread->secondary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->secondary, n_bytes)) { write_main_mem_val(thread, *thread->secondary, *thread->primary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	*(uint32_t*)(&memory[*thread->secondary]) = *thread->primary;
 }
 void instruction_247(thread_t* thread) {
 	uint8_t n_bytes = 8;	// number of bytes to store
 	if(*thread->secondary < SIZE_MAIN_MEM && !check_segfault(thread, *thread->secondary, n_bytes)) { write_main_mem_val(thread, *thread->secondary, *thread->primary, n_bytes); return; }
-	if(!check_mapped_region(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
+	if(!check_mapped_write(thread->privacy_key, *thread->secondary, n_bytes)) { thread->regs[13] |= SR_BIT_SEGFAULT; return; }
 	thread->regs[13] &= (~SR_BIT_SEGFAULT);
 	*(uint64_t*)(&memory[*thread->secondary]) = *thread->primary;
 }
@@ -5854,6 +8286,22 @@ void init_funcs() {
 void exec_cycle(thread_t* thread) {
 	if(thread->joining && !threads[thread->joining-1].killed) return;
 	thread->joining = 0;	// no longer waiting for any threads to be killed
+	if(thread->vid_data_wait) {	// copy the frame of a video data object that was being decoded
+		object_t* vid_object = &objects[thread->vid_data_wait-1];
+		vid_data_t* vid_data = &vid_object->vid_data;
+		uint32_t frame = thread->vid_data_wait_frame;
+		if(!vid_object->deleted && frame < vid_data->n_frames && !vid_data->frames[frame] && vid_data->n_decode_jobs) return;
+		thread->vid_data_wait = 0;
+		uint32_t frame_size = vid_data->width * vid_data->height * 4;
+		if(!vid_object->deleted && frame < vid_data->n_frames && !check_segfault(thread, thread->vid_data_wait_addr, frame_size))
+			write_main_mem(thread, thread->vid_data_wait_addr, get_vid_data_frame(vid_data, frame), frame_size);
+	}
+	if(thread->video_stream_wait) {	// append a frame to a video stream that was full
+		video_stream_t* stream = video_streams[thread->video_stream_wait-1];
+		if(stream && !video_stream_has_room(stream)) return;
+		thread->video_stream_wait = 0;
+		if(stream) append_video_stream_frame(thread, stream, thread->video_stream_wait_addr);	// unless the stream was closed meanwhile
+	}
 	thread->end_cyc = 0;	// end_cyc is not set at beginning of cycle
 	// set the threads created by this thread in last cycle to come alive
 	for(uint32_t i = 0; i < thread->n_created_threads; i++)
@@ -5979,6 +8427,11 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 void window_size_callback(GLFWwindow* window, int width, int height) {
 	window_width = width;
 	window_height = height;
+}
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+	framebuffer_width = width;
+	framebuffer_height = height;
 	glViewport(0,0,width,height);
 }
 
@@ -6005,49 +8458,188 @@ uint8_t validate_root() {
 }
 
 char* program_name;
+char** shader_files;			// shader bytecode files given with --translate-shader
+uint32_t n_shader_files;
+int8_t translate_type = -1;		// shader type given with --translate-shader; -1 if the VM runs a program normally
+uint32_t bench_iterations;		// with --bench, how many times each shader file is translated
 uint8_t process_args(int argc, char* argv[]) {
 	uint8_t invalid = 0, show_help = 0;
 	int8_t cur_option = -1;
 	for(uint32_t i = 1; i < argc; i++) {
 		char* arg = argv[i];
 		if(strcmp(arg, "-r") == 0)				cur_option = 0;
+		else if(strcmp(arg, "-c") == 0)			cur_option = 1;
+		else if(strcmp(arg, "--translate-shader") == 0) cur_option = 2;
+		else if(strcmp(arg, "--bench") == 0)	cur_option = 3;
 		else if(strcmp(arg, "-i") == 0)			show_program_info = 1;
 		else if(strcmp(arg, "-h") == 0)			show_help = 1;
 		else if(strcmp(arg, "--help") == 0) 	show_help = 1;
 		else if(strcmp(arg, "--vsync") == 0)	enable_vsync = 1;
 		else if(strcmp(arg, "-v") == 0)			show_about = 1;
 		else if(cur_option == -1) {
-			if(program_name) {	// program file can only be specified once
-				invalid = 1;
-				break;
-			}
-			program_name = arg;
+			shader_files = realloc(shader_files, sizeof(char*)*(n_shader_files+1));
+			shader_files[n_shader_files++] = arg;
 		} else if(cur_option == 0) {
 			root_path = arg;
 			cur_option = -1;
+		} else if(cur_option == 1) {
+			program_cache_path = arg;
+			cur_option = -1;
+		} else if(cur_option == 2) {
+			if(strlen(arg) != 1 || arg[0] < '0' || arg[0] > '3') invalid = 1;
+			translate_type = arg[0] - '0';
+			cur_option = -1;
+		} else if(cur_option == 3) {
+			bench_iterations = strtoul(arg, 0, 10);
+			if(!bench_iterations) invalid = 1;
+			cur_option = -1;
 		}
 	}
-	if(!program_name || argc == 1)
+	if(cur_option != -1) invalid = 1;	// option is missing its value
+	if(translate_type < 0) {
+		if(n_shader_files == 1) program_name = shader_files[0];
+		else if(n_shader_files > 1) invalid = 1;	// program file can only be specified once
+	}
+	if(bench_iterations && translate_type < 0) invalid = 1;
+	if(!n_shader_files || argc == 1)
 		invalid = 1;
 
 	if(invalid || show_help) {
-		if(invalid && !program_name) printf("Invalid usage. Please specify a program file to load.\n");
+		if(invalid && !n_shader_files) printf("Invalid usage. Please specify a program file to load.\n");
 		else if(invalid) printf("Invalid usage.\n");
 		printf("Usage: vm [options] file\n"
+			"       vm --translate-shader <type> [--bench <n>] file...\n"
 			"Options:\n"
 			"   -r <dir>    Set <dir> as the root path directory\n"
+			"   -c <dir>    Cache compiled shader programs in <dir> across sessions\n"
 			"   -i          Show info about the loaded program\n"
 			"   -h, --help  Show this menu\n"
 			"   --vsync     Enable VSync\n"
 			"   -v          Show info about the VM\n"
+			"   --translate-shader <type>\n"
+			"               Print the GLSL for shader bytecode files without running a program\n"
+			"               (type 0 = vertex, 1 = pixel, 2 = compute, 3 = ray tracing)\n"
+			"   --bench <n> Translate the shader files n times and report throughput\n"
 		);
 		if(invalid) return 0;
 	}
+	if(translate_type >= 0) return 1;	// headless shader translation uses no paths
 
 	if(!validate_root()) return 0;
+	if(program_cache_path) {
+		struct stat stat_buf;
+		if(stat(program_cache_path, &stat_buf) != 0 || !S_ISDIR(stat_buf.st_mode)) {
+			printf("Error: shader cache path (%s) is not a path to an existing directory\n", program_cache_path);
+			return 0;
+		}
+	}
 	return 1;
 }
 
+// free the arrays build_shader allocated in shader data
+void free_shader_data(shader_data_t* data) {
+	free(data->sets);
+	free(data->bindings);
+	free(data->set_binding_types);
+	free(data->locations);
+	free(data->vertex_output_ids);
+	free(data->vertex_output_types);
+	free(data->vertex_output_modes);
+	free(data->pixel_input_ids);
+	free(data->pixel_input_types);
+	for(uint32_t i = 0; i < data->n_defs; i++) {
+		func_def_t* f = data->defs[i].func_def;
+		if(!f) continue;
+		free(f->param_ids);
+		free(f->param_elcounts);
+		free(f->param_types);
+		free(f);
+	}
+	free(data->defs);
+	memset(data, 0, sizeof(shader_data_t));
+}
+
+// --translate-shader: translate shader bytecode files (e.g. the _shaderN files from asm -s) without a GL context
+// prints the GLSL of each file, or with --bench, translates all of the files bench_iterations times and reports throughput
+// pixel shaders are translated without a vertex shader, so their inputs are not matched against vertex outputs
+// returns the process exit status; 1 if any file can't be read or fails to translate
+int translate_shader_files() {
+	uint8_t* srcs[n_shader_files];
+	uint32_t sizes[n_shader_files];
+	int status = 1;
+	memset(srcs, 0, sizeof(srcs));
+	for(uint32_t i = 0; i < n_shader_files; i++) {
+		FILE* file = fopen(shader_files[i], "rb");
+		if(!file) { printf("error opening shader file \"%s\"\n", shader_files[i]); goto done; }
+		fseek(file, 0, SEEK_END);
+		sizes[i] = ftell(file);
+		fseek(file, 0, 0);
+		srcs[i] = malloc(sizes[i] ? sizes[i] : 1);
+		uint8_t read = fread(srcs[i], 1, sizes[i], file) == sizes[i];
+		fclose(file);
+		if(!read) { printf("error reading shader file \"%s\"\n", shader_files[i]); goto done; }
+	}
+
+	if(!bench_iterations) {
+		status = 0;
+		for(uint32_t i = 0; i < n_shader_files; i++) {
+			shader_t shader = {0};
+			shader_data_t data = {0};
+			data.no_vertex_shader = 1;
+			if(build_shader(srcs[i], sizes[i], translate_type, &shader, &data)) {
+				printf("error: shader file \"%s\" failed to translate\n", shader_files[i]);
+				free_shader_data(&data);
+				status = 1;
+				continue;
+			}
+			if(n_shader_files > 1) printf("// %s\n", shader_files[i]);
+			printf("%s", shader.src);
+			free(shader.src);
+			free_shader_data(&data);
+		}
+		goto done;
+	}
+
+	uint64_t bytecode_bytes = 0, glsl_bytes = 0;
+	uint32_t max_glsl_size = 0;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(uint32_t it = 0; it < bench_iterations; it++)
+		for(uint32_t i = 0; i < n_shader_files; i++) {
+			shader_t shader = {0};
+			shader_data_t data = {0};
+			data.no_vertex_shader = 1;
+			if(build_shader(srcs[i], sizes[i], translate_type, &shader, &data)) {
+				printf("error: shader file \"%s\" failed to translate\n", shader_files[i]);
+				free_shader_data(&data);
+				goto done;
+			}
+			bytecode_bytes += sizes[i];
+			glsl_bytes += shader.size;
+			if(shader.size > max_glsl_size) max_glsl_size = shader.size;
+			free(shader.src);
+			free_shader_data(&data);
+		}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	if(seconds <= 0) seconds = 1e-9;
+	uint64_t n_translated = (uint64_t)bench_iterations*n_shader_files;
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("translated %llu shaders (%u files x %u) in %.3f ms\n", (unsigned long long)n_translated, n_shader_files, bench_iterations, seconds*1000);
+	printf("%.1f shaders/s, %.3f us/shader\n", n_translated/seconds, seconds*1e6/n_translated);
+	printf("%.2f MB/s of bytecode in, %.2f MB/s of GLSL out\n", bytecode_bytes/seconds/1e6, glsl_bytes/seconds/1e6);
+	printf("largest GLSL output: %u bytes\n", max_glsl_size);
+#ifdef __APPLE__
+	usage.ru_maxrss /= 1024;	// reported in bytes on MacOS, KiB elsewhere
+#endif
+	printf("peak resident set size: %ld KiB\n", usage.ru_maxrss);
+	status = 0;
+done:
+	for(uint32_t i = 0; i < n_shader_files; i++) free(srcs[i]);
+	return status;
+}
+
 int main(int argc, char* argv[]) {
 	if(!process_args(argc, argv)) return 1;
 
@@ -6064,6 +8656,8 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
+	if(translate_type >= 0) return translate_shader_files();	// headless; no window or GL context is created
+
 	init_funcs();
 	init_threads(); // create thread 0
 
@@ -6080,12 +8674,52 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 	glfwMakeContextCurrent(window);
+	gl_state_invalidate(); // the initial GL state is not shadowed
+	GLint gl_major = 0, gl_minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &gl_major);
+	glGetIntegerv(GL_MINOR_VERSION, &gl_minor);
+	gl_sampler_objects = gl_major > 3 || (gl_major == 3 && gl_minor >= 3) || glfwExtensionSupported("GL_ARB_sampler_objects");
+	GLint n_binary_formats = 0;
+	if(gl_major > 4 || (gl_major == 4 && gl_minor >= 1) || glfwExtensionSupported("GL_ARB_get_program_binary"))
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_binary_formats);
+	gl_program_binaries = n_binary_formats > 0;
+	gl_parallel_shader_compile = glfwExtensionSupported("GL_KHR_parallel_shader_compile") || glfwExtensionSupported("GL_ARB_parallel_shader_compile");
+	gl_driver_key = 0xCBF29CE484222325ull;
+	GLenum driver_strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for(uint32_t i = 0; i < 3; i++)
+		for(const GLubyte* c = glGetString(driver_strings[i]); c && *c; c++) gl_driver_key = (gl_driver_key ^ *c) * 0x100000001B3ull;
+	gl_sync_objects = gl_major > 3 || (gl_major == 3 && gl_minor >= 2) || glfwExtensionSupported("GL_ARB_sync");
+	gl_texture_storage = gl_major > 4 || (gl_major == 4 && gl_minor >= 2) || glfwExtensionSupported("GL_ARB_texture_storage");
+	gl_compressed_formats = 0x18;	// BC4 + BC5 (RGTC) are core since GL 3.0
+	if(glfwExtensionSupported("GL_EXT_texture_compression_s3tc")) gl_compressed_formats |= 0x7;	// BC1-3
+	if(gl_major > 4 || (gl_major == 4 && gl_minor >= 2) || glfwExtensionSupported("GL_ARB_texture_compression_bptc")) gl_compressed_formats |= 0x20;	// BC7
+	if(gl_major > 4 || (gl_major == 4 && gl_minor >= 3) || glfwExtensionSupported("GL_ARB_ES3_compatibility")) gl_compressed_formats |= 0xC0;	// ETC2
+	gl_compute = gl_major > 4 || (gl_major == 4 && gl_minor >= 3)
+		|| (glfwExtensionSupported("GL_ARB_compute_shader") && glfwExtensionSupported("GL_ARB_shader_storage_buffer_object"));
+	if(gl_compute) {	// the hardware information reports the GL work-group limits (never below the minimums in the defaults)
+		GLint limit = 0;
+		for(uint32_t i = 0; i < 3; i++) {
+			glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, i, &limit);
+			if(limit > max_local_work_size[i]) max_local_work_size[i] = limit;
+			glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, i, &limit);
+			if(limit > max_global_work_size[i]) max_global_work_size[i] = limit;
+		}
+		glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &limit);
+		if(limit > max_local_work_size[3]) max_local_work_size[3] = limit;
+		glGetIntegerv(GL_MAX_COMPUTE_SHADER_STORAGE_BLOCKS, &limit);
+		max_number_sbos = limit;
+	}
+	update_hwinfo(); // get GL limits (max texture size, max UBOs, work-group sizes) before any pipelines are created
 
 	glfwSetCursorPos(window, 0, 0);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetCursorPosCallback(window,cursor_pos_callback);
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetWindowSizeCallback(window, window_size_callback);
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	int32_t fb_width, fb_height;
+	glfwGetFramebufferSize(window, &fb_width, &fb_height);
+	framebuffer_size_callback(window, fb_width, fb_height);
 	glfwSetScrollCallback(window, scroll_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 
@@ -6132,10 +8766,15 @@ int main(int argc, char* argv[]) {
 			}
 			exec_cycle(&threads[i]);	// execute a cycle for this thread
 		}
+		update_pending_pipelines();
+		update_image_decode_jobs();
+		update_display_captures();
 
 		if(gl_finish) { glFinish(); gl_finish = 0; }
 		if(gl_swap) {
+			read_display_captures();
 			glfwSwapBuffers(window);
+			n_swaps++;
 #if SLEEP_AT_SWAP
 			struct timespec ts;
 			ts.tv_sec = 0;
@@ -6147,6 +8786,11 @@ int main(int argc, char* argv[]) {
 			if(end_t - start_t >= .5) {
 				sprintf(title_str, "%s - %d FPS", WINDOW_TITLE, frame_count*2);
 				glfwSetWindowTitle(window, title_str);
+#if SHOW_GL_STATE_STATS
+				printf("GL state changes: %llu issued, %llu skipped\n", (unsigned long long)gl_calls_issued, (unsigned long long)gl_calls_skipped);
+				gl_calls_issued = 0;
+				gl_calls_skipped = 0;
+#endif
 				start_t = glfwGetTime();
 				frame_count = 0;
 			} else frame_count++;
@@ -6160,6 +8804,7 @@ int main(int argc, char* argv[]) {
 		}
 		tick++;
 	}
+	finish_video_streams();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;